@@ -49,6 +49,8 @@
 // You can set it to nil to completely disable caching.
 // When you ask for data ignoring cache the loader does not check
 // if data is in cache but loaded data is saved in the cache.
+// Subclasses may store data in the cache in their own format (see -cacheDataForData:),
+// so delegates of such loaders should use prepared values rather than passed data.
 
 @interface BADataLoader : NSObject
 
@@ -56,6 +58,7 @@
 @property(nonatomic, readonly) NSURLResponse *response;
 @property(nonatomic, readonly) NSHTTPURLResponse *HTTPResponse;
 @property(nonatomic, retain) BAPersistentCache *cache;
+@property(nonatomic, assign) BOOL mapsCachedData; // read cached data with memory mapping; default is NO
 @property(nonatomic, readonly) NSUInteger expectedBytesCount;
 @property(nonatomic, readonly) NSUInteger receivedBytesCount;
 @property(nonatomic, readonly) float progress; // 0..1
@@ -88,5 +91,14 @@
 - (void)resetConnection;
 // If returns YES then received data is cached, otherwise received data is considered invalid and not cached.
 - (BOOL)prepareData:(NSData *)data;
+// Called for data read from cache; default calls prepareData:.
+// If returns NO then cached data is discarded and loaded again.
+- (BOOL)prepareCachedData:(NSData *)data;
+// Data which is actually saved in cache after prepareData: has succeeded; default returns data as is.
+- (NSData *)cacheDataForData:(NSData *)data;
+// Called for every chunk of data received from network before it's appended to received data.
+- (void)prepareDataChunk:(NSData *)chunk;
+// Data received from network so far; it's nil when loader is not loading.
+- (NSData *)receivedData;
 
 @end
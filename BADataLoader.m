@@ -48,6 +48,7 @@
     NSURLConnection *_currentConnection;
 	id<BADataLoaderDelegate> _delegate;
 	NSMutableDictionary *_userInfo;
+	BOOL _mapsCachedData;
 }
 
 @synthesize request = _request;
@@ -57,6 +58,7 @@
 @synthesize expectedBytesCount = _expectedBytesCount;
 @synthesize delegate = _delegate;
 @synthesize dataEncoding = _dataEncoding;
+@synthesize mapsCachedData = _mapsCachedData;
 
 - (id)initWithRequest:(NSURLRequest *)request {
 	if ((self = [super init])) {
@@ -97,6 +99,17 @@
 	return YES;
 }
 
+- (BOOL)prepareCachedData:(NSData *)data {
+	return [self prepareData:data];
+}
+
+- (NSData *)cacheDataForData:(NSData *)data {
+	return data;
+}
+
+- (void)prepareDataChunk:(NSData *)chunk {
+}
+
 - (void)loadIgnoreCache:(NSNumber *)ignoreCacheWrapper {
 	BOOL ignoreCache = [ignoreCacheWrapper boolValue];
 	[self resetConnection];
@@ -104,11 +117,14 @@
 		NSData *cachedData = nil;
 		if (!ignoreCache && self.cache) {
 			NSString *key = [_request.URL absoluteString];
-			cachedData = [self.cache dataForKey:key];
+			cachedData = _mapsCachedData ? [self.cache mappedDataForKey:key] : [self.cache dataForKey:key];
+			if (cachedData && ![self prepareCachedData:cachedData]) {
+				[self.cache clearDataForKey:key];
+				cachedData = nil;
+			}
 		}
 		if (cachedData) {
 			//NSLog(@"#> %@", [_request URL]);
-			[self prepareData:cachedData];
 			if (_delegate) {
 				[_delegate loader:self didFinishLoadingData:cachedData fromCache:YES];
 			}
@@ -181,6 +197,7 @@
 }
 
 - (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data {
+	[self prepareDataChunk:data];
     [_receivedData appendData:data];
 	if (_delegate && [_delegate respondsToSelector:@selector(loaderDidReceiveData:)]) {
 		[_delegate loaderDidReceiveData:self];
@@ -202,7 +219,10 @@
 - (void)connectionDidFinishLoading:(NSURLConnection *)connection {
 	[BANetwork finishLoadingURL:_request.URL];
 	if ([self prepareData:self.receivedData] && self.cache) {
-		[self.cache setData:self.receivedData forKey:[_request.URL absoluteString]];
+		NSData *cacheData = [self cacheDataForData:self.receivedData];
+		if (cacheData) {
+			[self.cache setData:cacheData forKey:[_request.URL absoluteString]];
+		}
 	}
 	if (_delegate) {
 		[_delegate loader:self didFinishLoadingData:self.receivedData fromCache:NO];
@@ -27,6 +27,7 @@
  */
 
 #import "BAGroupedPageControl.h"
+#import "BARasterCache.h"
 
 #define kUnitSize 6.0
 #define kArrowWidth 10.0
@@ -237,18 +238,42 @@
 	}
 }
 
-- (void)drawArrowAtLocation:(CGPoint)p {
-	CGContextRef ctx = UIGraphicsGetCurrentContext();
-	const CGFloat arrowWing = (kArrowHeight - kArrowTrunkHeight) / 2;
-	CGContextMoveToPoint(ctx, p.x, p.y + (CGFloat)kArrowHeight / 2);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth / 2, p.y);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth / 2, p.y + arrowWing);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth, p.y + arrowWing);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth, p.y + kArrowHeight - arrowWing);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth / 2, p.y + kArrowHeight - arrowWing);
-	CGContextAddLineToPoint(ctx, p.x + (CGFloat)kArrowWidth / 2, p.y + kArrowHeight);
-	CGContextClosePath(ctx);
-	CGContextFillPath(ctx);
+- (void)drawArrowAtLocation:(CGPoint)p color:(UIColor *)color {
+	NSString *colorKey = [BARasterCache keyForColor:color.CGColor];
+	NSString *key = colorKey ? [@"BAGroupedPageControl arrow " stringByAppendingString:colorKey] : nil;
+	[[BARasterCache sharedCache] drawImageForKey:key
+										  inRect:CGRectMake(p.x, p.y, kArrowWidth, kArrowHeight)
+										   scale:0
+									  usingBlock:^(CGContextRef ctx, CGSize size) {
+		const CGFloat arrowWing = (kArrowHeight - kArrowTrunkHeight) / 2;
+		CGContextMoveToPoint(ctx, 0, (CGFloat)kArrowHeight / 2);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth / 2, 0);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth / 2, arrowWing);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth, arrowWing);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth, kArrowHeight - arrowWing);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth / 2, kArrowHeight - arrowWing);
+		CGContextAddLineToPoint(ctx, (CGFloat)kArrowWidth / 2, kArrowHeight);
+		CGContextClosePath(ctx);
+		CGContextSetFillColorWithColor(ctx, color.CGColor);
+		CGContextFillPath(ctx);
+	}];
+}
+
+- (void)drawUnitAtLocation:(CGPoint)p mode:(BAGroupedPageControlMode)mode color:(UIColor *)color {
+	NSString *colorKey = [BARasterCache keyForColor:color.CGColor];
+	NSString *key = colorKey ? [NSString stringWithFormat:@"BAGroupedPageControl unit %d %@", mode, colorKey] : nil;
+	[[BARasterCache sharedCache] drawImageForKey:key
+										  inRect:CGRectMake(p.x, p.y, kUnitSize, kUnitSize)
+										   scale:0
+									  usingBlock:^(CGContextRef ctx, CGSize size) {
+		if (mode == BAGroupedPageControlModeDots) {
+			CGContextAddEllipseInRect(ctx, CGRectMake(0, 0, kUnitSize, kUnitSize));
+		} else if (mode == BAGroupedPageControlModeBlocks) {
+			CGContextAddRect(ctx, CGRectMake(0, 0, kUnitSize, kUnitSize));
+		}
+		CGContextSetFillColorWithColor(ctx, color.CGColor);
+		CGContextFillPath(ctx);
+	}];
 }
 
 - (void)drawRect:(CGRect)rect {
@@ -278,8 +303,7 @@
 	NSUInteger pageOffset;
 	if (self.numberOfGroups > 1) {
 		if (self.displayedGroup > 0) {
-			[inactiveColor set];
-			[self drawArrowAtLocation:CGPointMake(left, arrowTop)];
+			[self drawArrowAtLocation:CGPointMake(left, arrowTop) color:inactiveColor];
 		}
 		left += kArrowWidth + kUnitSpacing;
 		pageCount = [self pagesInGroup:self.displayedGroup];
@@ -290,22 +314,15 @@
 	}
 	for (NSInteger relativePage = 0; relativePage < pageCount; relativePage++) {
 		NSInteger page = pageOffset + relativePage;
-		(page == _displayedPage) ? [activeColor set] : [inactiveColor set];
-		if (mode == BAGroupedPageControlModeDots) {
-			CGContextAddEllipseInRect(ctx, CGRectMake(left + relativePage * (kUnitSize + kUnitSpacing), unitTop,
-													  kUnitSize, kUnitSize));
-		} else if (mode == BAGroupedPageControlModeBlocks) {
-			CGContextAddRect(ctx, CGRectMake(left + relativePage * (kUnitSize + kUnitSpacing), unitTop,
-											 kUnitSize, kUnitSize));
-		}
-		CGContextFillPath(ctx);
+		[self drawUnitAtLocation:CGPointMake(left + relativePage * (kUnitSize + kUnitSpacing), unitTop)
+							mode:mode
+						   color:((page == _displayedPage) ? activeColor : inactiveColor)];
 	}
 	if (self.numberOfGroups > 1 && (self.displayedGroup < self.numberOfGroups - 1)) {
 		left += (kUnitSize + kUnitSpacing) * pageCount + kUnitSpacing;
-		[inactiveColor set];
 		CGContextTranslateCTM(ctx, left * 2, 0);
 		CGContextScaleCTM(ctx, -1, 1);
-		[self drawArrowAtLocation:CGPointMake(left, arrowTop)];
+		[self drawArrowAtLocation:CGPointMake(left, arrowTop) color:inactiveColor];
 	}
 }
 
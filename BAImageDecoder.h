@@ -0,0 +1,95 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <UIKit/UIKit.h>
+#import "BAPersistentCache.h"
+
+// Decodes images on a pool of worker threads
+// 
+// UIImage created from data is decompressed lazily when it's drawn for the first time
+// which happens on the main thread. Decoder forces decompression into a bitmap of the
+// native pixel format so images are ready to draw, and keeps them in a memory cache.
+// Completion blocks are called on the main thread and are not called for cancelled operations.
+// 
+// Images could be decoded straight to the size they are displayed at. Target size is in points
+// and is interpreted according to content mode the same way image view does it; aspect fit, aspect
+// fill and scale to fill modes are downsampled, other modes are decoded at full resolution.
+// Images are never upsampled. JPEG data is subsampled by the codec while decoding, so a full
+// resolution bitmap is never created. Decoded variants of different sizes are cached separately.
+
+typedef void (^BAImageDecoderCompletion)(UIImage *image);
+
+@interface BAImageDecoder : NSObject
+
+@property(nonatomic, assign) NSUInteger memoryCacheLimit; // in bytes of decoded bitmaps
+// Images downsampled from persistent cache data are written back as thumbnail variants, YES by default
+@property(nonatomic, assign) BOOL storesThumbnails;
+
++ (BAImageDecoder *)sharedDecoder;
+
++ (UIImage *)decodedImageWithImage:(UIImage *)image; // could be called on any thread
++ (UIImage *)decodedImageWithData:(NSData *)data;
+// Pass zero size to decode at full resolution and zero scale to use scale of the main screen.
++ (UIImage *)decodedImageWithImage:(UIImage *)image size:(CGSize)size contentMode:(UIViewContentMode)contentMode scale:(CGFloat)scale;
++ (UIImage *)decodedImageWithData:(NSData *)data size:(CGSize)size contentMode:(UIViewContentMode)contentMode scale:(CGFloat)scale;
+
+// Variant of the size in terms of persistent cache, nil when image is not downsampled for the size.
++ (NSString *)variantForSize:(CGSize)size contentMode:(UIViewContentMode)contentMode;
+// Memory cache key of the variant decoded to the size; key is returned as is for zero size.
++ (NSString *)keyForKey:(NSString *)key size:(CGSize)size contentMode:(UIViewContentMode)contentMode;
+
+- (UIImage *)cachedImageForKey:(NSString *)key;
+- (UIImage *)cachedImageForKey:(NSString *)key size:(CGSize)size contentMode:(UIViewContentMode)contentMode;
+- (void)setCachedImage:(UIImage *)image forKey:(NSString *)key; // image should be decoded
+- (void)removeCachedImages;
+
+// Results are put into the memory cache if key is not nil.
+- (NSOperation *)decodeImage:(UIImage *)image forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion;
+- (NSOperation *)decodeImageData:(NSData *)data forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion;
+// Reads data from the persistent cache on a worker thread; image is nil if there is no data.
+- (NSOperation *)decodeImageFromCache:(BAPersistentCache *)cache forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion;
+
+// Decode to size for the main screen; results are cached under keys of the size variants.
+// Reading from persistent cache prefers stored thumbnail of the size over original data.
+- (NSOperation *)decodeImage:(UIImage *)image
+					  forKey:(NSString *)key
+						size:(CGSize)size
+				 contentMode:(UIViewContentMode)contentMode
+				  completion:(BAImageDecoderCompletion)completion;
+- (NSOperation *)decodeImageData:(NSData *)data
+						  forKey:(NSString *)key
+							size:(CGSize)size
+					 contentMode:(UIViewContentMode)contentMode
+					  completion:(BAImageDecoderCompletion)completion;
+- (NSOperation *)decodeImageFromCache:(BAPersistentCache *)cache
+							   forKey:(NSString *)key
+								 size:(CGSize)size
+						  contentMode:(UIViewContentMode)contentMode
+						   completion:(BAImageDecoderCompletion)completion;
+
+@end
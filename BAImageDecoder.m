@@ -0,0 +1,378 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <ImageIO/ImageIO.h>
+#import "BAImageDecoder.h"
+
+#define kBAImageDecoderDefaultMemoryCacheLimit (32 * 1024 * 1024)
+#define kBAImageDecoderMaxConcurrentOperations 2
+
+@implementation BAImageDecoder {
+@private
+	NSOperationQueue *_queue;
+	NSCache *_memoryCache;
+	BOOL _storesThumbnails;
+}
+
+@synthesize storesThumbnails = _storesThumbnails;
+
++ (BAImageDecoder *)sharedDecoder {
+	static BAImageDecoder *decoder;
+	if (!decoder) {
+		decoder = [[BAImageDecoder alloc] init];
+	}
+	return decoder;
+}
+
+- (id)init {
+	if ((self = [super init])) {
+		_queue = [[NSOperationQueue alloc] init];
+		[_queue setMaxConcurrentOperationCount:kBAImageDecoderMaxConcurrentOperations];
+		_memoryCache = [[NSCache alloc] init];
+		[_memoryCache setTotalCostLimit:kBAImageDecoderDefaultMemoryCacheLimit];
+		_storesThumbnails = YES;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_queue cancelAllOperations];
+	[_queue release];
+	[_memoryCache release];
+	[super dealloc];
+}
+
+- (NSUInteger)memoryCacheLimit {
+	return [_memoryCache totalCostLimit];
+}
+
+- (void)setMemoryCacheLimit:(NSUInteger)memoryCacheLimit {
+	[_memoryCache setTotalCostLimit:memoryCacheLimit];
+}
+
+static CGImageRef BAImageDecoderCreateBitmapImage(CGImageRef imageRef, size_t width, size_t height) {
+	const CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(imageRef);
+	const BOOL hasAlpha = !(alphaInfo == kCGImageAlphaNone ||
+							alphaInfo == kCGImageAlphaNoneSkipFirst ||
+							alphaInfo == kCGImageAlphaNoneSkipLast);
+	// native format for iOS; no conversion is needed when it's drawn
+	const CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Little |
+	(hasAlpha ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst);
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+	CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, bitmapInfo);
+	CGColorSpaceRelease(colorSpace);
+	if (!context) {
+		return NULL;
+	}
+	CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+	CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+	CGImageRef decodedImageRef = CGBitmapContextCreateImage(context);
+	CGContextRelease(context);
+	return decodedImageRef;
+}
+
+static BOOL BAImageDecoderDownsamplesContentMode(UIViewContentMode contentMode) {
+	return contentMode == UIViewContentModeScaleToFill ||
+	contentMode == UIViewContentModeScaleAspectFit ||
+	contentMode == UIViewContentModeScaleAspectFill;
+}
+
+// Returns factor to scale image of the pixel size by to display it at the target pixel size; never above 1.
+static CGFloat BAImageDecoderScaleFactor(CGSize pixelSize, CGSize targetPixelSize, UIViewContentMode contentMode) {
+	if (pixelSize.width <= 0 || pixelSize.height <= 0 || targetPixelSize.width <= 0 || targetPixelSize.height <= 0 ||
+		!BAImageDecoderDownsamplesContentMode(contentMode)) {
+		return 1;
+	}
+	const CGFloat widthFactor = targetPixelSize.width / pixelSize.width;
+	const CGFloat heightFactor = targetPixelSize.height / pixelSize.height;
+	// scale to fill stretches image, so neither dimension should be sampled below target
+	const CGFloat factor = (contentMode == UIViewContentModeScaleAspectFit) ? MIN(widthFactor, heightFactor) : MAX(widthFactor, heightFactor);
+	return MIN(factor, 1);
+}
+
+static CGFloat BAImageDecoderResolvedScale(CGFloat scale) {
+	return scale > 0 ? scale : [UIScreen mainScreen].scale;
+}
+
++ (UIImage *)decodedImageWithImage:(UIImage *)image {
+	CGImageRef imageRef = image.CGImage;
+	if (!imageRef || image.images) {
+		return image;
+	}
+	const size_t width = CGImageGetWidth(imageRef);
+	const size_t height = CGImageGetHeight(imageRef);
+	if (width == 0 || height == 0) {
+		return image;
+	}
+	CGImageRef decodedImageRef = BAImageDecoderCreateBitmapImage(imageRef, width, height);
+	if (!decodedImageRef) {
+		return image;
+	}
+	UIImage *decodedImage = [UIImage imageWithCGImage:decodedImageRef scale:image.scale orientation:image.imageOrientation];
+	CGImageRelease(decodedImageRef);
+	return decodedImage;
+}
+
++ (UIImage *)decodedImageWithData:(NSData *)data {
+	if (!data) {
+		return nil;
+	}
+	UIImage *image = [[[UIImage alloc] initWithData:data] autorelease];
+	return image ? [self decodedImageWithImage:image] : nil;
+}
+
++ (UIImage *)decodedImageWithImage:(UIImage *)image size:(CGSize)size contentMode:(UIViewContentMode)contentMode scale:(CGFloat)scale {
+	CGImageRef imageRef = image.CGImage;
+	if (!imageRef || image.images) {
+		return image;
+	}
+	scale = BAImageDecoderResolvedScale(scale);
+	const size_t width = CGImageGetWidth(imageRef);
+	const size_t height = CGImageGetHeight(imageRef);
+	CGSize pixelSize = CGSizeMake(width, height);
+	switch (image.imageOrientation) {
+		case UIImageOrientationLeft:
+		case UIImageOrientationRight:
+		case UIImageOrientationLeftMirrored:
+		case UIImageOrientationRightMirrored:
+			pixelSize = CGSizeMake(height, width);
+			break;
+		default:
+			break;
+	}
+	const CGFloat factor = BAImageDecoderScaleFactor(pixelSize, CGSizeMake(size.width * scale, size.height * scale), contentMode);
+	if (factor >= 1) {
+		return [self decodedImageWithImage:image];
+	}
+	// bitmap keeps raw orientation, image applies it when drawn
+	CGImageRef decodedImageRef = BAImageDecoderCreateBitmapImage(imageRef,
+																 MAX(1, (size_t)roundf(width * factor)),
+																 MAX(1, (size_t)roundf(height * factor)));
+	if (!decodedImageRef) {
+		return [self decodedImageWithImage:image];
+	}
+	UIImage *decodedImage = [UIImage imageWithCGImage:decodedImageRef scale:scale orientation:image.imageOrientation];
+	CGImageRelease(decodedImageRef);
+	return decodedImage;
+}
+
++ (UIImage *)decodedImageWithData:(NSData *)data size:(CGSize)size contentMode:(UIViewContentMode)contentMode scale:(CGFloat)scale {
+	return [self decodedImageWithData:data size:size contentMode:contentMode scale:scale downsampled:NULL];
+}
+
++ (UIImage *)decodedImageWithData:(NSData *)data scale:(CGFloat)scale {
+	UIImage *image = data ? [[[UIImage alloc] initWithData:data] autorelease] : nil;
+	if (!image.CGImage) {
+		return image;
+	}
+	image = [UIImage imageWithCGImage:image.CGImage scale:BAImageDecoderResolvedScale(scale) orientation:image.imageOrientation];
+	return [self decodedImageWithImage:image];
+}
+
++ (UIImage *)decodedImageWithData:(NSData *)data
+							 size:(CGSize)size
+					  contentMode:(UIViewContentMode)contentMode
+							scale:(CGFloat)scale
+					  downsampled:(BOOL *)downsampled
+{
+	if (downsampled) {
+		*downsampled = NO;
+	}
+	if (!data) {
+		return nil;
+	}
+	if (CGSizeEqualToSize(size, CGSizeZero) || !BAImageDecoderDownsamplesContentMode(contentMode)) {
+		return [self decodedImageWithData:data];
+	}
+	scale = BAImageDecoderResolvedScale(scale);
+	CGImageSourceRef source = CGImageSourceCreateWithData((CFDataRef)data, NULL);
+	if (!source) {
+		return nil;
+	}
+	// read dimensions from the header without decoding
+	CGSize pixelSize = CGSizeZero;
+	CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+	if (properties) {
+		NSNumber *pixelWidth = (NSNumber *)CFDictionaryGetValue(properties, kCGImagePropertyPixelWidth);
+		NSNumber *pixelHeight = (NSNumber *)CFDictionaryGetValue(properties, kCGImagePropertyPixelHeight);
+		NSNumber *orientation = (NSNumber *)CFDictionaryGetValue(properties, kCGImagePropertyOrientation);
+		pixelSize = CGSizeMake([pixelWidth floatValue], [pixelHeight floatValue]);
+		if ([orientation intValue] >= 5) { // EXIF orientations rotated by 90 degrees
+			pixelSize = CGSizeMake(pixelSize.height, pixelSize.width);
+		}
+		CFRelease(properties);
+	}
+	const CGFloat factor = BAImageDecoderScaleFactor(pixelSize, CGSizeMake(size.width * scale, size.height * scale), contentMode);
+	if (factor >= 1) {
+		CFRelease(source);
+		return [self decodedImageWithData:data];
+	}
+	const NSUInteger maxPixelSize = ceilf(MAX(pixelSize.width, pixelSize.height) * factor);
+	NSDictionary *options = [NSDictionary dictionaryWithObjectsAndKeys:
+							 (id)kCFBooleanTrue, (id)kCGImageSourceCreateThumbnailFromImageAlways,
+							 (id)kCFBooleanTrue, (id)kCGImageSourceCreateThumbnailWithTransform,
+							 [NSNumber numberWithUnsignedInteger:MAX(maxPixelSize, 1)], (id)kCGImageSourceThumbnailMaxPixelSize,
+							 nil];
+	CGImageRef thumbnailRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (CFDictionaryRef)options);
+	CFRelease(source);
+	if (!thumbnailRef) {
+		return nil;
+	}
+	UIImage *image = [UIImage imageWithCGImage:thumbnailRef scale:scale orientation:UIImageOrientationUp];
+	CGImageRelease(thumbnailRef);
+	if (downsampled) {
+		*downsampled = YES;
+	}
+	return [self decodedImageWithImage:image];
+}
+
++ (NSString *)variantForSize:(CGSize)size contentMode:(UIViewContentMode)contentMode {
+	if (CGSizeEqualToSize(size, CGSizeZero) || !BAImageDecoderDownsamplesContentMode(contentMode)) {
+		return nil;
+	}
+	return [NSString stringWithFormat:@"%gx%g-%d", size.width, size.height, (int)contentMode];
+}
+
++ (NSString *)keyForKey:(NSString *)key size:(CGSize)size contentMode:(UIViewContentMode)contentMode {
+	return key ? [BAPersistentCache keyForKey:key variant:[self variantForSize:size contentMode:contentMode]] : nil;
+}
+
+- (UIImage *)cachedImageForKey:(NSString *)key {
+	return key ? [_memoryCache objectForKey:key] : nil;
+}
+
+- (UIImage *)cachedImageForKey:(NSString *)key size:(CGSize)size contentMode:(UIViewContentMode)contentMode {
+	return [self cachedImageForKey:[BAImageDecoder keyForKey:key size:size contentMode:contentMode]];
+}
+
+- (void)setCachedImage:(UIImage *)image forKey:(NSString *)key {
+	if (!image || !key) {
+		return;
+	}
+	const CGFloat scale = image.scale;
+	const NSUInteger cost = image.size.width * scale * image.size.height * scale * 4;
+	[_memoryCache setObject:image forKey:key cost:cost];
+}
+
+- (void)removeCachedImages {
+	[_memoryCache removeAllObjects];
+}
+
+- (NSOperation *)decodeForKey:(NSString *)key
+				   usingBlock:(UIImage *(^)(void))block
+				   completion:(BAImageDecoderCompletion)completion
+{
+	NSBlockOperation *operation = [[[NSBlockOperation alloc] init] autorelease];
+	__block NSBlockOperation *blockOperation = operation; // not retained to avoid cycle
+	key = [[key copy] autorelease];
+	[operation addExecutionBlock:^{
+		if ([blockOperation isCancelled]) {
+			return;
+		}
+		UIImage *image = block();
+		if (image && key) {
+			[self setCachedImage:image forKey:key];
+		}
+		NSOperation *finishedOperation = blockOperation; // retained by the block below
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if (![finishedOperation isCancelled] && completion) {
+				completion(image);
+			}
+		});
+	}];
+	[_queue addOperation:operation];
+	return operation;
+}
+
+- (NSOperation *)decodeImage:(UIImage *)image forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion {
+	return [self decodeImage:image forKey:key size:CGSizeZero contentMode:UIViewContentModeScaleToFill completion:completion];
+}
+
+- (NSOperation *)decodeImageData:(NSData *)data forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion {
+	return [self decodeImageData:data forKey:key size:CGSizeZero contentMode:UIViewContentModeScaleToFill completion:completion];
+}
+
+- (NSOperation *)decodeImageFromCache:(BAPersistentCache *)cache forKey:(NSString *)key completion:(BAImageDecoderCompletion)completion {
+	return [self decodeImageFromCache:cache forKey:key size:CGSizeZero contentMode:UIViewContentModeScaleToFill completion:completion];
+}
+
+- (NSOperation *)decodeImage:(UIImage *)image
+					  forKey:(NSString *)key
+						size:(CGSize)size
+				 contentMode:(UIViewContentMode)contentMode
+				  completion:(BAImageDecoderCompletion)completion
+{
+	const CGFloat scale = [UIScreen mainScreen].scale;
+	return [self decodeForKey:[BAImageDecoder keyForKey:key size:size contentMode:contentMode] usingBlock:^UIImage *{
+		return [BAImageDecoder decodedImageWithImage:image size:size contentMode:contentMode scale:scale];
+	} completion:completion];
+}
+
+- (NSOperation *)decodeImageData:(NSData *)data
+						  forKey:(NSString *)key
+							size:(CGSize)size
+					 contentMode:(UIViewContentMode)contentMode
+					  completion:(BAImageDecoderCompletion)completion
+{
+	const CGFloat scale = [UIScreen mainScreen].scale;
+	return [self decodeForKey:[BAImageDecoder keyForKey:key size:size contentMode:contentMode] usingBlock:^UIImage *{
+		return [BAImageDecoder decodedImageWithData:data size:size contentMode:contentMode scale:scale];
+	} completion:completion];
+}
+
+- (NSOperation *)decodeImageFromCache:(BAPersistentCache *)cache
+							   forKey:(NSString *)key
+								 size:(CGSize)size
+						  contentMode:(UIViewContentMode)contentMode
+						   completion:(BAImageDecoderCompletion)completion
+{
+	const CGFloat scale = [UIScreen mainScreen].scale;
+	const BOOL storesThumbnails = self.storesThumbnails;
+	key = [[key copy] autorelease];
+	return [self decodeForKey:[BAImageDecoder keyForKey:key size:size contentMode:contentMode] usingBlock:^UIImage *{
+		NSString *variant = [BAImageDecoder variantForSize:size contentMode:contentMode];
+		if (variant) {
+			UIImage *thumbnail = [BAImageDecoder decodedImageWithData:[cache dataForKey:key variant:variant] scale:scale];
+			if (thumbnail) {
+				return thumbnail;
+			}
+		}
+		BOOL downsampled = NO;
+		UIImage *image = [BAImageDecoder decodedImageWithData:[cache dataForKey:key]
+														 size:size
+												  contentMode:contentMode
+														scale:scale
+												  downsampled:&downsampled];
+		if (image && downsampled && storesThumbnails) {
+			[cache setImage:image forKey:key variant:variant];
+		}
+		return image;
+	} completion:completion];
+}
+
+@end
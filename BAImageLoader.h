@@ -29,8 +29,30 @@
 #import <UIKit/UIKit.h>
 #import "BADataLoader.h"
 
+@class BAImageLoader;
+
+@protocol BAImageLoaderDelegate <BADataLoaderDelegate>
+
+@optional
+- (void)loader:(BAImageLoader *)loader didUpdatePartialImage:(UIImage *)partialImage;
+
+@end
+
+// Progressive loading
+// 
+// Progressive loader decodes partially received images as data arrives, so progressive JPEGs
+// and interlaced PNGs are shown scan by scan and baseline images top to bottom. Partial images
+// are decoded on a background thread no more often than update interval, and delegate gets
+// only the latest one. Partial images are not cached.
+
 @interface BAImageLoader : BADataLoader
 
 @property(nonatomic, readonly) UIImage *image;
+@property(nonatomic, assign) BOOL progressive; // default is NO
+@property(nonatomic, assign) NSTimeInterval progressiveUpdateInterval; // 0.2 sec by default
+// Partial images are downsampled to this size according to content mode when it's not zero
+@property(nonatomic, assign) CGSize partialImageSize;
+@property(nonatomic, assign) UIViewContentMode partialImageContentMode;
+@property(nonatomic, readonly) UIImage *partialImage;
 
 @end
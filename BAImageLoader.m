@@ -1,5 +1,5 @@
 /*
- Copyright 2011 Dmitry Stadnik. All rights reserved.
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
  
  Redistribution and use in source and binary forms, with or without modification, are
  permitted provided that the following conditions are met:
@@ -26,18 +26,204 @@
  or implied, of Dmitry Stadnik.
  */
 
+#import <ImageIO/ImageIO.h>
 #import "BAImageLoader.h"
+#import "BAImageDecoder.h"
 
-@implementation BAImageLoader
+#define kBAImageLoaderDefaultProgressiveUpdateInterval 0.2
+#define kBAImageLoaderMaxConcurrentPartialDecodes 2
+#define kBAImageLoaderMinPartialBufferCapacity (64 * 1024)
+
+@implementation BAImageLoader {
+@private
+	UIImage *_image;
+	BOOL _progressive;
+	NSTimeInterval _progressiveUpdateInterval;
+	CGSize _partialImageSize;
+	UIViewContentMode _partialImageContentMode;
+	UIImage *_partialImage;
+	CGImageSourceRef _incrementalSource;
+	CFAbsoluteTime _partialImageUpdateTime;
+	BOOL _partialImageUpdateScheduled;
+	BOOL _partialImageDecoding;
+	NSUInteger _partialImageBytesCount;
+	CFMutableDataRef _partialImageData; // fixed capacity, so bytes handed to the source never move
+	CFIndex _partialImageCapacity;
+	NSMutableArray *_partialImageBuffers; // buffers referenced by the source, outgrown ones included
+}
 
 @synthesize image = _image;
+@synthesize progressive = _progressive;
+@synthesize progressiveUpdateInterval = _progressiveUpdateInterval;
+@synthesize partialImageSize = _partialImageSize;
+@synthesize partialImageContentMode = _partialImageContentMode;
+@synthesize partialImage = _partialImage;
+
++ (NSOperationQueue *)partialDecodingQueue {
+	static NSOperationQueue *queue;
+	if (!queue) {
+		queue = [[NSOperationQueue alloc] init];
+		[queue setMaxConcurrentOperationCount:kBAImageLoaderMaxConcurrentPartialDecodes];
+	}
+	return queue;
+}
+
+- (id)initWithRequest:(NSURLRequest *)request {
+	if ((self = [super initWithRequest:request])) {
+		_progressiveUpdateInterval = kBAImageLoaderDefaultProgressiveUpdateInterval;
+		_partialImageContentMode = UIViewContentModeScaleToFill;
+	}
+	return self;
+}
 
 - (void)dealloc {
 	[_image release];
-	[super dealloc];
+	[_partialImage release];
+	[super dealloc]; // calls resetConnection which releases incremental source
+}
+
+- (void)resetIncrementalSource {
+	if (_partialImageUpdateScheduled) {
+		[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(updatePartialImage) object:nil];
+		_partialImageUpdateScheduled = NO;
+	}
+	if (_incrementalSource) {
+		CFRelease(_incrementalSource);
+		_incrementalSource = NULL;
+	}
+	// decoding operation keeps its own reference to buffers
+	[_partialImageBuffers release];
+	_partialImageBuffers = nil;
+	_partialImageData = NULL;
+	_partialImageCapacity = 0;
+	_partialImageUpdateTime = 0;
+}
+
+- (void)resetConnection {
+	[self resetIncrementalSource];
+	[super resetConnection];
+}
+
+// Chunks are appended to a buffer of fixed capacity, so the decoder gets received bytes without
+// copying them. Outgrown buffer is copied once into a twice larger one.
+- (void)appendPartialImageChunk:(NSData *)chunk {
+	if (_partialImageData && [[self receivedData] length] < (NSUInteger)CFDataGetLength(_partialImageData)) {
+		// received data was reset by a new response
+		[self resetIncrementalSource];
+	}
+	const CFIndex length = _partialImageData ? CFDataGetLength(_partialImageData) : 0;
+	const CFIndex chunkLength = [chunk length];
+	if (!_partialImageData || length + chunkLength > _partialImageCapacity) {
+		CFIndex capacity = MAX(MAX(_partialImageCapacity * 2, (CFIndex)self.expectedBytesCount), kBAImageLoaderMinPartialBufferCapacity);
+		capacity = MAX(capacity, length + chunkLength);
+		CFMutableDataRef data = CFDataCreateMutable(NULL, capacity);
+		if (_partialImageData) {
+			CFDataAppendBytes(data, CFDataGetBytePtr(_partialImageData), length);
+		}
+		if (!_partialImageBuffers) {
+			_partialImageBuffers = [[NSMutableArray alloc] init];
+		}
+		[_partialImageBuffers addObject:(id)data];
+		CFRelease(data);
+		_partialImageData = data;
+		_partialImageCapacity = capacity;
+	}
+	CFDataAppendBytes(_partialImageData, [chunk bytes], chunkLength);
+}
+
+- (void)prepareDataChunk:(NSData *)chunk {
+	[super prepareDataChunk:chunk];
+	if (_progressive) {
+		[self appendPartialImageChunk:chunk];
+		// chunk is appended after this call so update is deferred; it also coalesces chunks
+		[self schedulePartialImageUpdate];
+	}
+}
+
+- (void)schedulePartialImageUpdate {
+	if (_partialImageUpdateScheduled) {
+		return;
+	}
+	const NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - _partialImageUpdateTime;
+	_partialImageUpdateScheduled = YES;
+	[self performSelector:@selector(updatePartialImage)
+			   withObject:nil
+			   afterDelay:MAX(0, _progressiveUpdateInterval - elapsed)];
+}
+
+- (void)updatePartialImage {
+	_partialImageUpdateScheduled = NO;
+	const NSUInteger length = _partialImageData ? CFDataGetLength(_partialImageData) : 0;
+	if (_partialImageDecoding || length == 0) {
+		// decoded image arriving later reschedules update
+		return;
+	}
+	if (!_incrementalSource) {
+		_incrementalSource = CGImageSourceCreateIncremental(NULL);
+	}
+	_partialImageDecoding = YES;
+	_partialImageUpdateTime = CFAbsoluteTimeGetCurrent();
+	_partialImageBytesCount = length;
+
+	// Source could be reset on main thread while decoding, so operation keeps its own reference
+	CGImageSourceRef source = (CGImageSourceRef)CFRetain(_incrementalSource);
+	// received bytes are not copied, buffers are released after the source
+	NSArray *buffers = [_partialImageBuffers retain];
+	CFDataRef partialData = CFDataCreateWithBytesNoCopy(NULL, CFDataGetBytePtr(_partialImageData), length, kCFAllocatorNull);
+	const CGSize size = _partialImageSize;
+	const UIViewContentMode contentMode = _partialImageContentMode;
+	const CGFloat scale = [UIScreen mainScreen].scale;
+	[[[self class] partialDecodingQueue] addOperationWithBlock:^{
+		UIImage *partialImage = nil;
+		CGImageSourceUpdateData(source, partialData, false);
+		const CGImageSourceStatus status = CGImageSourceGetStatusAtIndex(source, 0);
+		if (status == kCGImageStatusIncomplete || status == kCGImageStatusComplete) {
+			CGImageRef imageRef = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+			if (imageRef) {
+				partialImage = [UIImage imageWithCGImage:imageRef];
+				CGImageRelease(imageRef);
+				partialImage = CGSizeEqualToSize(size, CGSizeZero) ?
+				[BAImageDecoder decodedImageWithImage:partialImage] :
+				[BAImageDecoder decodedImageWithImage:partialImage size:size contentMode:contentMode scale:scale];
+			}
+		}
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[self didDecodePartialImage:partialImage fromSource:source];
+			// source could reference the data until released
+			CFRelease(source);
+			CFRelease(partialData);
+			[buffers release];
+		});
+	}];
+}
+
+- (void)didDecodePartialImage:(UIImage *)partialImage fromSource:(CGImageSourceRef)source {
+	_partialImageDecoding = NO;
+	if (source != _incrementalSource) {
+		// loading has finished or was cancelled, or data of a new response is being received
+		if (_partialImageData && CFDataGetLength(_partialImageData) > 0) {
+			[self schedulePartialImageUpdate];
+		}
+		return;
+	}
+	if (partialImage) {
+		[_partialImage release];
+		_partialImage = [partialImage retain];
+		id<BAImageLoaderDelegate> delegate = (id<BAImageLoaderDelegate>)self.delegate;
+		if (delegate && [delegate respondsToSelector:@selector(loader:didUpdatePartialImage:)]) {
+			[delegate loader:self didUpdatePartialImage:partialImage];
+		}
+	}
+	if (_partialImageData && (NSUInteger)CFDataGetLength(_partialImageData) > _partialImageBytesCount) {
+		// more data has arrived while decoding
+		[self schedulePartialImageUpdate];
+	}
 }
 
 - (BOOL)prepareData:(NSData *)data {
+	[self resetIncrementalSource];
+	[_partialImage release];
+	_partialImage = nil;
 	[_image release];
 	_image = [[UIImage alloc] initWithData:data];
 	return !!_image;
@@ -0,0 +1,48 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Compact binary form of parsed JSON used for caching
+// 
+// Layout (all integers are little endian):
+// 
+//   header   "BAJB", version, 3 reserved bytes, keys count, keys offset, values offset, root offset
+//   keys     offsets of all distinct object keys followed by length-prefixed UTF-8 bytes
+//   values   tagged values; containers store offsets of their elements and key indexes
+// 
+// Reading does not tokenize anything and every object key is created only once.
+
+@interface BAJSONBinary : NSObject
+
++ (BOOL)isBinaryData:(NSData *)data;
+// Accepts values returned by JSON parsers: dictionaries, arrays, strings, numbers and nulls.
++ (NSData *)dataWithJSONValue:(id)JSONValue;
++ (id)JSONValueWithData:(NSData *)data error:(NSError **)error;
+
+@end
@@ -0,0 +1,397 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BAJSONBinary.h"
+
+#define kBAJSONBinaryVersion 1
+#define kBAJSONBinaryHeaderSize 24
+#define kBAJSONBinaryMaxDepth 512
+
+static const uint8_t BAJSONBinaryMagic[4] = { 'B', 'A', 'J', 'B' };
+
+typedef enum {
+	BAJSONBinaryTagNull = 0,
+	BAJSONBinaryTagFalse,
+	BAJSONBinaryTagTrue,
+	BAJSONBinaryTagInteger, // int64
+	BAJSONBinaryTagDouble, // IEEE 754 bits
+	BAJSONBinaryTagString, // length, bytes
+	BAJSONBinaryTagArray, // count, element offsets
+	BAJSONBinaryTagObject // count, (key index, value offset) pairs
+} BAJSONBinaryTag;
+
+
+#pragma mark -
+#pragma mark writing
+
+typedef struct {
+	NSMutableData *values;
+	NSMutableDictionary *keyIndexes; // NSString -> NSNumber
+	NSMutableArray *keys;
+} BAJSONBinaryWriter;
+
+static inline void BAJSONBinaryAppendUInt8(NSMutableData *data, uint8_t value) {
+	[data appendBytes:&value length:1];
+}
+
+static inline void BAJSONBinaryAppendUInt32(NSMutableData *data, uint32_t value) {
+	value = CFSwapInt32HostToLittle(value);
+	[data appendBytes:&value length:4];
+}
+
+static inline void BAJSONBinaryAppendUInt64(NSMutableData *data, uint64_t value) {
+	value = CFSwapInt64HostToLittle(value);
+	[data appendBytes:&value length:8];
+}
+
+static uint32_t BAJSONBinaryKeyIndex(BAJSONBinaryWriter *writer, NSString *key) {
+	NSNumber *index = [writer->keyIndexes objectForKey:key];
+	if (index) {
+		return [index unsignedIntValue];
+	}
+	uint32_t newIndex = (uint32_t)[writer->keys count];
+	[writer->keys addObject:key];
+	[writer->keyIndexes setObject:[NSNumber numberWithUnsignedInt:newIndex] forKey:key];
+	return newIndex;
+}
+
+// Children are written before their containers so containers could refer to them by offsets.
+static BOOL BAJSONBinaryWriteValue(BAJSONBinaryWriter *writer, id value, uint32_t *offset, NSUInteger depth) {
+	if (depth > kBAJSONBinaryMaxDepth) {
+		return NO;
+	}
+	NSMutableData *values = writer->values;
+	if ([value isKindOfClass:[NSDictionary class]]) {
+		NSDictionary *dictionary = value;
+		const NSUInteger count = [dictionary count];
+		uint32_t *pairs = malloc(MAX(count, 1) * 2 * sizeof(uint32_t));
+		NSUInteger i = 0;
+		for (id key in dictionary) {
+			if (![key isKindOfClass:[NSString class]] ||
+				!BAJSONBinaryWriteValue(writer, [dictionary objectForKey:key], &pairs[i * 2 + 1], depth + 1))
+			{
+				free(pairs);
+				return NO;
+			}
+			pairs[i * 2] = BAJSONBinaryKeyIndex(writer, key);
+			i++;
+		}
+		*offset = (uint32_t)[values length];
+		BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagObject);
+		BAJSONBinaryAppendUInt32(values, (uint32_t)count);
+		for (i = 0; i < count * 2; i++) {
+			BAJSONBinaryAppendUInt32(values, pairs[i]);
+		}
+		free(pairs);
+	} else if ([value isKindOfClass:[NSArray class]]) {
+		NSArray *array = value;
+		const NSUInteger count = [array count];
+		uint32_t *offsets = malloc(MAX(count, 1) * sizeof(uint32_t));
+		NSUInteger i = 0;
+		for (id element in array) {
+			if (!BAJSONBinaryWriteValue(writer, element, &offsets[i++], depth + 1)) {
+				free(offsets);
+				return NO;
+			}
+		}
+		*offset = (uint32_t)[values length];
+		BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagArray);
+		BAJSONBinaryAppendUInt32(values, (uint32_t)count);
+		for (i = 0; i < count; i++) {
+			BAJSONBinaryAppendUInt32(values, offsets[i]);
+		}
+		free(offsets);
+	} else if ([value isKindOfClass:[NSString class]]) {
+		NSData *bytes = [value dataUsingEncoding:NSUTF8StringEncoding];
+		*offset = (uint32_t)[values length];
+		BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagString);
+		BAJSONBinaryAppendUInt32(values, (uint32_t)[bytes length]);
+		[values appendData:bytes];
+	} else if ([value isKindOfClass:[NSNumber class]]) {
+		*offset = (uint32_t)[values length];
+		if (CFGetTypeID(value) == CFBooleanGetTypeID()) {
+			BAJSONBinaryAppendUInt8(values, [value boolValue] ? BAJSONBinaryTagTrue : BAJSONBinaryTagFalse);
+		} else if (CFNumberIsFloatType((CFNumberRef)value)) {
+			double d = [value doubleValue];
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagDouble);
+			BAJSONBinaryAppendUInt64(values, bits);
+		} else {
+			BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagInteger);
+			BAJSONBinaryAppendUInt64(values, (uint64_t)[value longLongValue]);
+		}
+	} else if ([value isKindOfClass:[NSNull class]]) {
+		*offset = (uint32_t)[values length];
+		BAJSONBinaryAppendUInt8(values, BAJSONBinaryTagNull);
+	} else {
+		return NO;
+	}
+	return YES;
+}
+
+
+#pragma mark -
+#pragma mark reading
+
+typedef struct {
+	const uint8_t *values;
+	size_t valuesLength;
+	NSString **keys;
+	uint32_t keysCount;
+} BAJSONBinaryReader;
+
+static inline BOOL BAJSONBinaryReadUInt32(const uint8_t *bytes, size_t length, size_t offset, uint32_t *value) {
+	if (offset > length || length - offset < 4) {
+		return NO;
+	}
+	uint32_t v;
+	memcpy(&v, bytes + offset, 4);
+	*value = CFSwapInt32LittleToHost(v);
+	return YES;
+}
+
+static inline BOOL BAJSONBinaryReadUInt64(const uint8_t *bytes, size_t length, size_t offset, uint64_t *value) {
+	if (offset > length || length - offset < 8) {
+		return NO;
+	}
+	uint64_t v;
+	memcpy(&v, bytes + offset, 8);
+	*value = CFSwapInt64LittleToHost(v);
+	return YES;
+}
+
+// Returns retained value
+static id BAJSONBinaryNewValue(BAJSONBinaryReader *reader, uint32_t offset, NSUInteger depth) {
+	const uint8_t *values = reader->values;
+	const size_t length = reader->valuesLength;
+	if (depth > kBAJSONBinaryMaxDepth || offset >= length) {
+		return nil;
+	}
+	switch (values[offset]) {
+		case BAJSONBinaryTagNull:
+			return [[NSNull null] retain];
+		case BAJSONBinaryTagFalse:
+			return [[NSNumber alloc] initWithBool:NO];
+		case BAJSONBinaryTagTrue:
+			return [[NSNumber alloc] initWithBool:YES];
+		case BAJSONBinaryTagInteger: {
+			uint64_t bits;
+			if (!BAJSONBinaryReadUInt64(values, length, offset + 1, &bits)) {
+				return nil;
+			}
+			return [[NSNumber alloc] initWithLongLong:(long long)bits];
+		}
+		case BAJSONBinaryTagDouble: {
+			uint64_t bits;
+			if (!BAJSONBinaryReadUInt64(values, length, offset + 1, &bits)) {
+				return nil;
+			}
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			return [[NSNumber alloc] initWithDouble:d];
+		}
+		case BAJSONBinaryTagString: {
+			uint32_t stringLength;
+			if (!BAJSONBinaryReadUInt32(values, length, offset + 1, &stringLength) ||
+				length - (offset + 5) < stringLength)
+			{
+				return nil;
+			}
+			return [[NSString alloc] initWithBytes:values + offset + 5 length:stringLength encoding:NSUTF8StringEncoding];
+		}
+		case BAJSONBinaryTagArray: {
+			uint32_t count;
+			if (!BAJSONBinaryReadUInt32(values, length, offset + 1, &count) ||
+				(length - (offset + 5)) / 4 < count)
+			{
+				return nil;
+			}
+			id *objects = malloc(MAX(count, 1) * sizeof(id));
+			uint32_t i;
+			for (i = 0; i < count; i++) {
+				uint32_t elementOffset;
+				BAJSONBinaryReadUInt32(values, length, offset + 5 + i * 4, &elementOffset);
+				objects[i] = BAJSONBinaryNewValue(reader, elementOffset, depth + 1);
+				if (!objects[i]) {
+					break;
+				}
+			}
+			NSArray *array = (i == count) ? [[NSArray alloc] initWithObjects:objects count:count] : nil;
+			for (uint32_t j = 0; j < i; j++) {
+				[objects[j] release];
+			}
+			free(objects);
+			return array;
+		}
+		case BAJSONBinaryTagObject: {
+			uint32_t count;
+			if (!BAJSONBinaryReadUInt32(values, length, offset + 1, &count) ||
+				(length - (offset + 5)) / 8 < count)
+			{
+				return nil;
+			}
+			id *objects = malloc(MAX(count, 1) * sizeof(id));
+			id *keys = malloc(MAX(count, 1) * sizeof(id));
+			uint32_t i;
+			for (i = 0; i < count; i++) {
+				uint32_t keyIndex, valueOffset;
+				BAJSONBinaryReadUInt32(values, length, offset + 5 + i * 8, &keyIndex);
+				BAJSONBinaryReadUInt32(values, length, offset + 9 + i * 8, &valueOffset);
+				if (keyIndex >= reader->keysCount) {
+					break;
+				}
+				keys[i] = reader->keys[keyIndex];
+				objects[i] = BAJSONBinaryNewValue(reader, valueOffset, depth + 1);
+				if (!objects[i]) {
+					break;
+				}
+			}
+			NSDictionary *dictionary = (i == count) ? [[NSDictionary alloc] initWithObjects:objects forKeys:keys count:count] : nil;
+			for (uint32_t j = 0; j < i; j++) {
+				[objects[j] release];
+			}
+			free(objects);
+			free(keys);
+			return dictionary;
+		}
+	}
+	return nil;
+}
+
+
+@implementation BAJSONBinary
+
++ (BOOL)isBinaryData:(NSData *)data {
+	return [data length] >= kBAJSONBinaryHeaderSize && memcmp([data bytes], BAJSONBinaryMagic, 4) == 0;
+}
+
++ (NSData *)dataWithJSONValue:(id)JSONValue {
+	if (!JSONValue) {
+		return nil;
+	}
+	BAJSONBinaryWriter writer;
+	writer.values = [NSMutableData data];
+	writer.keyIndexes = [NSMutableDictionary dictionary];
+	writer.keys = [NSMutableArray array];
+	uint32_t rootOffset;
+	if (!BAJSONBinaryWriteValue(&writer, JSONValue, &rootOffset, 0)) {
+		return nil;
+	}
+
+	NSMutableData *keysData = [NSMutableData data];
+	const uint32_t keysCount = (uint32_t)[writer.keys count];
+	uint32_t keyOffset = keysCount * 4;
+	NSMutableArray *keysBytes = [NSMutableArray arrayWithCapacity:keysCount];
+	for (NSString *key in writer.keys) {
+		NSData *keyBytes = [key dataUsingEncoding:NSUTF8StringEncoding];
+		[keysBytes addObject:keyBytes];
+		BAJSONBinaryAppendUInt32(keysData, keyOffset);
+		keyOffset += 4 + (uint32_t)[keyBytes length];
+	}
+	for (NSData *keyBytes in keysBytes) {
+		BAJSONBinaryAppendUInt32(keysData, (uint32_t)[keyBytes length]);
+		[keysData appendData:keyBytes];
+	}
+
+	NSMutableData *data = [NSMutableData dataWithCapacity:kBAJSONBinaryHeaderSize + [keysData length] + [writer.values length]];
+	[data appendBytes:BAJSONBinaryMagic length:4];
+	BAJSONBinaryAppendUInt8(data, kBAJSONBinaryVersion);
+	BAJSONBinaryAppendUInt8(data, 0);
+	BAJSONBinaryAppendUInt8(data, 0);
+	BAJSONBinaryAppendUInt8(data, 0);
+	BAJSONBinaryAppendUInt32(data, keysCount);
+	BAJSONBinaryAppendUInt32(data, kBAJSONBinaryHeaderSize);
+	BAJSONBinaryAppendUInt32(data, kBAJSONBinaryHeaderSize + (uint32_t)[keysData length]);
+	BAJSONBinaryAppendUInt32(data, rootOffset);
+	[data appendData:keysData];
+	[data appendData:writer.values];
+	return data;
+}
+
++ (NSError *)errorWithDescription:(NSString *)description {
+	return [NSError errorWithDomain:@"BaseAppKit"
+							   code:0
+						   userInfo:[NSDictionary dictionaryWithObject:description
+																forKey:NSLocalizedDescriptionKey]];
+}
+
++ (id)JSONValueWithData:(NSData *)data error:(NSError **)error {
+	if (![self isBinaryData:data]) {
+		if (error) {
+			*error = [self errorWithDescription:@"Not a binary JSON data"];
+		}
+		return nil;
+	}
+	const uint8_t *bytes = [data bytes];
+	const size_t length = [data length];
+	uint32_t keysCount, keysOffset, valuesOffset, rootOffset;
+	BAJSONBinaryReadUInt32(bytes, length, 8, &keysCount);
+	BAJSONBinaryReadUInt32(bytes, length, 12, &keysOffset);
+	BAJSONBinaryReadUInt32(bytes, length, 16, &valuesOffset);
+	BAJSONBinaryReadUInt32(bytes, length, 20, &rootOffset);
+	if (bytes[4] != kBAJSONBinaryVersion || keysOffset > valuesOffset || valuesOffset > length ||
+		(valuesOffset - keysOffset) / 4 < keysCount)
+	{
+		if (error) {
+			*error = [self errorWithDescription:@"Unsupported or corrupted binary JSON data"];
+		}
+		return nil;
+	}
+
+	// every key is created once and shared by all objects
+	BAJSONBinaryReader reader;
+	reader.values = bytes + valuesOffset;
+	reader.valuesLength = length - valuesOffset;
+	reader.keysCount = keysCount;
+	reader.keys = calloc(MAX(keysCount, 1), sizeof(NSString *));
+	const uint8_t *keys = bytes + keysOffset;
+	const size_t keysLength = valuesOffset - keysOffset;
+	BOOL ok = YES;
+	for (uint32_t i = 0; i < keysCount && ok; i++) {
+		uint32_t keyOffset, keyLength;
+		ok = BAJSONBinaryReadUInt32(keys, keysLength, i * 4, &keyOffset) &&
+			BAJSONBinaryReadUInt32(keys, keysLength, keyOffset, &keyLength) &&
+			keysLength - (keyOffset + 4) >= keyLength;
+		if (ok) {
+			reader.keys[i] = [[NSString alloc] initWithBytes:keys + keyOffset + 4 length:keyLength encoding:NSUTF8StringEncoding];
+			ok = !!reader.keys[i];
+		}
+	}
+	id JSONValue = ok ? BAJSONBinaryNewValue(&reader, rootOffset, 0) : nil;
+	for (uint32_t i = 0; i < keysCount; i++) {
+		[reader.keys[i] release];
+	}
+	free(reader.keys);
+	if (!JSONValue && error) {
+		*error = [self errorWithDescription:@"Corrupted binary JSON data"];
+	}
+	return [JSONValue autorelease];
+}
+
+@end
@@ -0,0 +1,107 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Schema driven JSON decoding
+// 
+// Instead of parsing into dictionaries and reading values back with BAJSONLoader helpers
+// a model declares its fields once and the decoder stores values right into C structs
+// or object ivars while scanning the JSON bytes. Numeric fields are coerced the same way as
+// +[BAJSONLoader intFromJSONValue:forKey:] and friends do, strings are converted to numbers.
+// Unlike +[BAJSONLoader stringFromJSONValue:forKey:] string fields take numbers as well.
+// Nulls and values of incompatible types leave the field untouched. Ivar fields should have
+// the C type of their field type, otherwise the decoder raises.
+// 
+// typedef struct {
+//     NSInteger identifier;
+//     NSString *name;
+//     double rating;
+// } Item;
+// 
+// static const BAJSONField ItemFields[] = {
+//     BAJSONStructField(Item, identifier, "id", BAJSONFieldTypeInteger),
+//     BAJSONStructField(Item, name, "name", BAJSONFieldTypeString),
+//     BAJSONStructField(Item, rating, "rating", BAJSONFieldTypeDouble)
+// };
+
+typedef enum {
+	BAJSONFieldTypeBool = 0, // BOOL
+	BAJSONFieldTypeInt,      // int
+	BAJSONFieldTypeInteger,  // NSInteger
+	BAJSONFieldTypeLongLong, // long long
+	BAJSONFieldTypeFloat,    // float
+	BAJSONFieldTypeDouble,   // double
+	BAJSONFieldTypeString    // NSString *; retained by the record
+} BAJSONFieldType;
+
+typedef struct {
+	const char *key;
+	BAJSONFieldType type;
+	size_t offset;
+	const char *ivarName; // if set then offset is taken from the ivar of the decoded class
+} BAJSONField;
+
+#define BAJSONStructField(STRUCT, MEMBER, KEY, TYPE) { (KEY), (TYPE), offsetof(STRUCT, MEMBER), NULL }
+#define BAJSONIvarField(IVAR, KEY, TYPE) { (KEY), (TYPE), 0, (IVAR) }
+#define BAJSONFieldsCount(FIELDS) (sizeof(FIELDS) / sizeof(BAJSONField))
+
+
+@protocol BAJSONDecodable <NSObject>
+
+// Fields should be declared with BAJSONIvarField.
++ (const BAJSONField *)JSONFieldsCount:(NSUInteger *)count;
+
+@end
+
+
+@interface BAJSONDecoder : NSObject
+
+@property(nonatomic, readonly) Class modelClass; // nil for struct decoders
+@property(nonatomic, readonly) size_t recordSize; // 0 for class decoders
+
+// Decoder filling structs of the given size.
+- (id)initWithFields:(const BAJSONField *)fields count:(NSUInteger)count recordSize:(size_t)recordSize;
+// Decoder creating instances of the class; decoders are shared per class.
++ (BAJSONDecoder *)decoderForClass:(Class)modelClass;
+
+// Decodes top-level JSON object into the record; absent fields keep their values.
+- (BOOL)decodeData:(NSData *)data intoRecord:(void *)record error:(NSError **)error;
+
+// Decodes JSON array of objects into a contiguous block of zeroed records which should be
+// freed with freeRecords:count:. If key is nil the array should be the top-level value,
+// otherwise it is looked up in the top-level object.
+- (void *)decodeRecordsFromData:(NSData *)data atKey:(NSString *)key count:(NSUInteger *)count error:(NSError **)error;
+- (void)releaseRecord:(void *)record; // releases strings and clears their fields
+- (void)freeRecords:(void *)records count:(NSUInteger)count;
+
+// Class decoders only.
+- (id)decodeObjectFromData:(NSData *)data error:(NSError **)error;
+- (NSArray *)decodeObjectsFromData:(NSData *)data atKey:(NSString *)key error:(NSError **)error;
+
+@end
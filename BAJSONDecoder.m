@@ -0,0 +1,494 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BAJSONDecoder.h"
+#import "BAJSONScanner.h"
+#import <objc/runtime.h>
+
+typedef struct {
+	const char *key;
+	size_t keyLength;
+	BAJSONFieldType type;
+	size_t offset;
+} BAJSONDecoderField;
+
+static inline const BAJSONDecoderField *BAJSONDecoderFindField(const BAJSONDecoderField *fields, NSUInteger count,
+															   const uint8_t *key, size_t keyLength, NSUInteger *hint)
+{
+	// fields usually come in the same order in every object so start right after the last match
+	NSUInteger index = *hint;
+	for (NSUInteger i = 0; i < count; i++, index++) {
+		if (index >= count) {
+			index = 0;
+		}
+		const BAJSONDecoderField *field = &fields[index];
+		if (field->keyLength == keyLength && memcmp(field->key, key, keyLength) == 0) {
+			*hint = index + 1;
+			return field;
+		}
+	}
+	return NULL;
+}
+
+static void BAJSONDecoderStoreNumber(uint8_t *slot, BAJSONFieldType type, BOOL integer, long long integerValue, double doubleValue) {
+	switch (type) {
+		case BAJSONFieldTypeBool:
+			*(BOOL *)slot = integer ? (integerValue != 0) : (doubleValue != 0);
+			break;
+		case BAJSONFieldTypeInt:
+			*(int *)slot = integer ? (int)integerValue : (int)doubleValue;
+			break;
+		case BAJSONFieldTypeInteger:
+			*(NSInteger *)slot = integer ? (NSInteger)integerValue : (NSInteger)doubleValue;
+			break;
+		case BAJSONFieldTypeLongLong:
+			*(long long *)slot = integer ? integerValue : (long long)doubleValue;
+			break;
+		case BAJSONFieldTypeFloat:
+			*(float *)slot = integer ? (float)integerValue : (float)doubleValue;
+			break;
+		case BAJSONFieldTypeDouble:
+			*(double *)slot = integer ? (double)integerValue : doubleValue;
+			break;
+		case BAJSONFieldTypeString:
+			break;
+	}
+}
+
+static void BAJSONDecoderStoreString(uint8_t *slot, const uint8_t *bytes, size_t length) {
+	NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+	if (!string) {
+		return;
+	}
+	NSString **field = (NSString **)slot;
+	[*field release];
+	*field = string;
+}
+
+// Mimics NSString boolValue
+static BOOL BAJSONDecoderBoolFromText(const char *text) {
+	while (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r') {
+		text++;
+	}
+	if (*text == 'Y' || *text == 'y' || *text == 'T' || *text == 't') {
+		return YES;
+	}
+	if (*text == '+' || *text == '-') {
+		text++;
+	}
+	while (*text == '0') {
+		text++;
+	}
+	return *text >= '1' && *text <= '9';
+}
+
+static void BAJSONDecoderStoreText(uint8_t *slot, BAJSONFieldType type, const uint8_t *bytes, size_t length) {
+	char text[64];
+	length = MIN(length, sizeof(text) - 1);
+	memcpy(text, bytes, length);
+	text[length] = 0;
+	switch (type) {
+		case BAJSONFieldTypeBool:
+			*(BOOL *)slot = BAJSONDecoderBoolFromText(text);
+			break;
+		case BAJSONFieldTypeInt: {
+			// NSString intValue saturates at int bounds
+			long long value = strtoll(text, NULL, 10);
+			*(int *)slot = (int)MAX(INT_MIN, MIN(INT_MAX, value));
+			break;
+		}
+		case BAJSONFieldTypeInteger: {
+			long long value = strtoll(text, NULL, 10);
+			*(NSInteger *)slot = (NSInteger)MAX(NSIntegerMin, MIN(NSIntegerMax, value));
+			break;
+		}
+		case BAJSONFieldTypeLongLong:
+			*(long long *)slot = strtoll(text, NULL, 10);
+			break;
+		case BAJSONFieldTypeFloat:
+			*(float *)slot = strtof(text, NULL);
+			break;
+		case BAJSONFieldTypeDouble:
+			*(double *)slot = strtod(text, NULL);
+			break;
+		case BAJSONFieldTypeString:
+			break;
+	}
+}
+
+static BOOL BAJSONDecoderDecodeValue(BAJSONScanner *scanner, const BAJSONDecoderField *field, uint8_t *record) {
+	uint8_t *slot = record + field->offset;
+	BAJSONValueType valueType = BAJSONScannerPeek(scanner);
+	switch (valueType) {
+		case BAJSONValueTypeNumber: {
+			const uint8_t *text = scanner->p;
+			if (!BAJSONScannerScanNumber(scanner)) {
+				return NO;
+			}
+			if (field->type == BAJSONFieldTypeString) {
+				BAJSONDecoderStoreString(slot, text, scanner->p - text);
+			} else {
+				BAJSONDecoderStoreNumber(slot, field->type, scanner->integer, scanner->integerValue, scanner->doubleValue);
+			}
+			return YES;
+		}
+		case BAJSONValueTypeString:
+			if (!BAJSONScannerScanString(scanner)) {
+				return NO;
+			}
+			if (field->type == BAJSONFieldTypeString) {
+				BAJSONDecoderStoreString(slot, scanner->string, scanner->stringLength);
+			} else {
+				BAJSONDecoderStoreText(slot, field->type, scanner->string, scanner->stringLength);
+			}
+			return YES;
+		case BAJSONValueTypeTrue:
+		case BAJSONValueTypeFalse:
+			if (!BAJSONScannerScanLiteral(scanner, valueType)) {
+				return NO;
+			}
+			if (field->type != BAJSONFieldTypeString) {
+				BAJSONDecoderStoreNumber(slot, field->type, YES, (valueType == BAJSONValueTypeTrue), 0);
+			}
+			return YES;
+		case BAJSONValueTypeNull:
+			return BAJSONScannerScanLiteral(scanner, valueType);
+		default:
+			return BAJSONScannerSkipValue(scanner);
+	}
+}
+
+static BOOL BAJSONDecoderDecodeObject(BAJSONScanner *scanner, const BAJSONDecoderField *fields, NSUInteger count, uint8_t *record) {
+	if (!BAJSONScannerExpect(scanner, '{')) {
+		return NO;
+	}
+	if (BAJSONScannerSkip(scanner, '}')) {
+		return YES;
+	}
+	NSUInteger hint = 0;
+	do {
+		if (!BAJSONScannerScanString(scanner) || !BAJSONScannerExpect(scanner, ':')) {
+			return NO;
+		}
+		// key may live in the scanner buffer so match it before scanning the value
+		const BAJSONDecoderField *field = BAJSONDecoderFindField(fields, count, scanner->string, scanner->stringLength, &hint);
+		if (field) {
+			if (!BAJSONDecoderDecodeValue(scanner, field, record)) {
+				return NO;
+			}
+		} else {
+			if (!BAJSONScannerSkipValue(scanner)) {
+				return NO;
+			}
+		}
+	} while (BAJSONScannerSkip(scanner, ','));
+	return BAJSONScannerExpect(scanner, '}');
+}
+
+// Positions scanner at the value for the key in the top-level object.
+static BOOL BAJSONDecoderSeekKey(BAJSONScanner *scanner, NSString *key, BOOL *found) {
+	*found = NO;
+	if (!key) {
+		*found = YES;
+		return YES;
+	}
+	const char *keyBytes = [key UTF8String];
+	const size_t keyLength = strlen(keyBytes);
+	if (!BAJSONScannerExpect(scanner, '{')) {
+		return NO;
+	}
+	if (BAJSONScannerSkip(scanner, '}')) {
+		return YES;
+	}
+	do {
+		if (!BAJSONScannerScanString(scanner) || !BAJSONScannerExpect(scanner, ':')) {
+			return NO;
+		}
+		if (scanner->stringLength == keyLength && memcmp(scanner->string, keyBytes, keyLength) == 0) {
+			*found = YES;
+			return YES;
+		}
+		if (!BAJSONScannerSkipValue(scanner)) {
+			return NO;
+		}
+	} while (BAJSONScannerSkip(scanner, ','));
+	return BAJSONScannerExpect(scanner, '}');
+}
+
+static BOOL BAJSONDecoderTypeMatchesEncoding(BAJSONFieldType type, const char *encoding) {
+	if (!encoding) {
+		return NO;
+	}
+	switch (type) {
+		case BAJSONFieldTypeBool:
+			return strcmp(encoding, @encode(BOOL)) == 0;
+		case BAJSONFieldTypeInt:
+			return strcmp(encoding, @encode(int)) == 0;
+		case BAJSONFieldTypeInteger:
+			return strcmp(encoding, @encode(NSInteger)) == 0;
+		case BAJSONFieldTypeLongLong:
+			return strcmp(encoding, @encode(long long)) == 0;
+		case BAJSONFieldTypeFloat:
+			return strcmp(encoding, @encode(float)) == 0;
+		case BAJSONFieldTypeDouble:
+			return strcmp(encoding, @encode(double)) == 0;
+		case BAJSONFieldTypeString:
+			return encoding[0] == '@'; // id or @"NSString"
+	}
+	return NO;
+}
+
+static NSError *BAJSONDecoderEmptyDataError(void) {
+	return [NSError errorWithDomain:@"BaseAppKit"
+							   code:0
+						   userInfo:[NSDictionary dictionaryWithObject:@"No JSON data"
+																forKey:NSLocalizedDescriptionKey]];
+}
+
+
+@implementation BAJSONDecoder {
+@private
+	Class _modelClass;
+	size_t _recordSize;
+	BAJSONDecoderField *_fields;
+	NSUInteger _fieldsCount;
+}
+
+@synthesize modelClass = _modelClass;
+@synthesize recordSize = _recordSize;
+
+- (id)initWithFields:(const BAJSONField *)fields count:(NSUInteger)count modelClass:(Class)modelClass recordSize:(size_t)recordSize {
+	if ((self = [super init])) {
+		_modelClass = modelClass;
+		_recordSize = recordSize;
+		_fieldsCount = count;
+		_fields = calloc(MAX(count, 1), sizeof(BAJSONDecoderField));
+		for (NSUInteger i = 0; i < count; i++) {
+			_fields[i].key = fields[i].key;
+			_fields[i].keyLength = strlen(fields[i].key);
+			_fields[i].type = fields[i].type;
+			_fields[i].offset = fields[i].offset;
+			if (fields[i].ivarName) {
+				Ivar ivar = modelClass ? class_getInstanceVariable(modelClass, fields[i].ivarName) : NULL;
+				if (!ivar) {
+					[NSException raise:@"BAJSONDecoderError" format:@"Unknown ivar %s for key %s", fields[i].ivarName, fields[i].key];
+				}
+				if (!BAJSONDecoderTypeMatchesEncoding(fields[i].type, ivar_getTypeEncoding(ivar))) {
+					[NSException raise:@"BAJSONDecoderError" format:@"Type %s of ivar %s does not match field type for key %s",
+					 ivar_getTypeEncoding(ivar), fields[i].ivarName, fields[i].key];
+				}
+				_fields[i].offset = ivar_getOffset(ivar);
+			}
+		}
+	}
+	return self;
+}
+
+- (id)initWithFields:(const BAJSONField *)fields count:(NSUInteger)count recordSize:(size_t)recordSize {
+	return [self initWithFields:fields count:count modelClass:nil recordSize:recordSize];
+}
+
+- (void)dealloc {
+	free(_fields);
+	[super dealloc];
+}
+
++ (BAJSONDecoder *)decoderForClass:(Class)modelClass {
+	static NSMutableDictionary *decoders;
+	@synchronized(self) {
+		if (!decoders) {
+			decoders = [[NSMutableDictionary alloc] init];
+		}
+		NSString *className = NSStringFromClass(modelClass);
+		BAJSONDecoder *decoder = [decoders objectForKey:className];
+		if (!decoder) {
+			NSUInteger count = 0;
+			const BAJSONField *fields = [(id<BAJSONDecodable>)modelClass JSONFieldsCount:&count];
+			decoder = [[[BAJSONDecoder alloc] initWithFields:fields count:count modelClass:modelClass recordSize:0] autorelease];
+			[decoders setObject:decoder forKey:className];
+		}
+		return decoder;
+	}
+}
+
+- (BOOL)decodeData:(NSData *)data intoRecord:(void *)record error:(NSError **)error {
+	if (!data || [data length] == 0) {
+		if (error) {
+			*error = BAJSONDecoderEmptyDataError();
+		}
+		return NO;
+	}
+	BAJSONScanner scanner;
+	BAJSONScannerInit(&scanner, [data bytes], [data length]);
+	BOOL ok = BAJSONDecoderDecodeObject(&scanner, _fields, _fieldsCount, record);
+	if (ok && !BAJSONScannerAtEnd(&scanner)) {
+		scanner.error = "Unexpected data after JSON value";
+		ok = NO;
+	}
+	if (!ok && error) {
+		*error = BAJSONScannerError(&scanner);
+	}
+	BAJSONScannerDestroy(&scanner);
+	return ok;
+}
+
+- (void)releaseRecord:(void *)record {
+	for (NSUInteger i = 0; i < _fieldsCount; i++) {
+		if (_fields[i].type == BAJSONFieldTypeString) {
+			NSString **field = (NSString **)((uint8_t *)record + _fields[i].offset);
+			[*field release];
+			*field = nil;
+		}
+	}
+}
+
+- (void)freeRecords:(void *)records count:(NSUInteger)count {
+	for (NSUInteger i = 0; i < count; i++) {
+		[self releaseRecord:(uint8_t *)records + i * _recordSize];
+	}
+	free(records);
+}
+
+// Decodes array elements calling the block with the storage for each element.
+- (BOOL)decodeArrayWithScanner:(BAJSONScanner *)scanner usingBlock:(uint8_t *(^)(NSUInteger index))block {
+	if (!BAJSONScannerExpect(scanner, '[')) {
+		return NO;
+	}
+	if (BAJSONScannerSkip(scanner, ']')) {
+		return YES;
+	}
+	NSUInteger index = 0;
+	do {
+		uint8_t *record = block(index++);
+		if (!record) {
+			scanner->error = "Out of memory";
+			return NO;
+		}
+		if (!BAJSONDecoderDecodeObject(scanner, _fields, _fieldsCount, record)) {
+			return NO;
+		}
+	} while (BAJSONScannerSkip(scanner, ','));
+	return BAJSONScannerExpect(scanner, ']');
+}
+
+- (void *)decodeRecordsFromData:(NSData *)data atKey:(NSString *)key count:(NSUInteger *)count error:(NSError **)error {
+	*count = 0;
+	if (_recordSize == 0) {
+		return NULL;
+	}
+	if (!data || [data length] == 0) {
+		if (error) {
+			*error = BAJSONDecoderEmptyDataError();
+		}
+		return NULL;
+	}
+	BAJSONScanner scanner;
+	BAJSONScannerInit(&scanner, [data bytes], [data length]);
+	__block uint8_t *records = NULL;
+	__block NSUInteger capacity = 0;
+	__block NSUInteger decodedCount = 0;
+	const size_t recordSize = _recordSize;
+	BOOL found = NO;
+	BOOL ok = BAJSONDecoderSeekKey(&scanner, key, &found);
+	if (ok && found) {
+		ok = [self decodeArrayWithScanner:&scanner usingBlock:^uint8_t *(NSUInteger index) {
+			if (index >= capacity) {
+				NSUInteger newCapacity = MAX(16, capacity * 2);
+				uint8_t *newRecords = realloc(records, newCapacity * recordSize);
+				if (!newRecords) {
+					return NULL;
+				}
+				memset(newRecords + capacity * recordSize, 0, (newCapacity - capacity) * recordSize);
+				records = newRecords;
+				capacity = newCapacity;
+			}
+			decodedCount = index + 1;
+			return records + index * recordSize;
+		}];
+		if (ok && !key && !BAJSONScannerAtEnd(&scanner)) {
+			scanner.error = "Unexpected data after JSON value";
+			ok = NO;
+		}
+	}
+	if (!ok) {
+		if (error) {
+			*error = BAJSONScannerError(&scanner);
+		}
+		[self freeRecords:records count:decodedCount];
+		records = NULL;
+		decodedCount = 0;
+	}
+	BAJSONScannerDestroy(&scanner);
+	*count = decodedCount;
+	return records;
+}
+
+- (id)decodeObjectFromData:(NSData *)data error:(NSError **)error {
+	if (!_modelClass) {
+		return nil;
+	}
+	id object = [[[_modelClass alloc] init] autorelease];
+	return [self decodeData:data intoRecord:(uint8_t *)object error:error] ? object : nil;
+}
+
+- (NSArray *)decodeObjectsFromData:(NSData *)data atKey:(NSString *)key error:(NSError **)error {
+	if (!_modelClass) {
+		return nil;
+	}
+	if (!data || [data length] == 0) {
+		if (error) {
+			*error = BAJSONDecoderEmptyDataError();
+		}
+		return nil;
+	}
+	BAJSONScanner scanner;
+	BAJSONScannerInit(&scanner, [data bytes], [data length]);
+	NSMutableArray *objects = [NSMutableArray array];
+	const Class modelClass = _modelClass;
+	BOOL found = NO;
+	BOOL ok = BAJSONDecoderSeekKey(&scanner, key, &found);
+	if (ok && found) {
+		ok = [self decodeArrayWithScanner:&scanner usingBlock:^uint8_t *(NSUInteger index) {
+			id object = [[modelClass alloc] init];
+			[objects addObject:object];
+			[object release];
+			return (uint8_t *)object;
+		}];
+		if (ok && !key && !BAJSONScannerAtEnd(&scanner)) {
+			scanner.error = "Unexpected data after JSON value";
+			ok = NO;
+		}
+	}
+	if (!ok && error) {
+		*error = BAJSONScannerError(&scanner);
+	}
+	BAJSONScannerDestroy(&scanner);
+	return (ok && found) ? objects : nil;
+}
+
+@end
@@ -27,12 +27,21 @@
 */
 
 #import "BADataLoader.h"
+#import "BAJSONStringTable.h"
 
 @interface BAJSONLoader : BADataLoader
 
 @property(nonatomic, readonly) id JSONValue;
+// If set then data is parsed with built-in parser which interns keys through the table.
+// The same table can be shared by loaders used on one thread.
+@property(nonatomic, retain) BAJSONStringTable *stringTable;
+// If set then parsed values are cached in compact binary form (see BAJSONBinary) which
+// is loaded without parsing; text cached earlier is still accepted. Default is NO.
+@property(nonatomic, assign) BOOL cachesBinaryJSON;
 
 + (id)parseJSONData:(NSData *)data error:(NSError **)error;
+// Used by loaders with string table; falls back to the method above if a subclass overrides only that one
++ (id)parseJSONData:(NSData *)data stringTable:(BAJSONStringTable *)stringTable error:(NSError **)error;
 
 + (NSString *)stringFromJSONValue:(NSDictionary *)JSONValue forKey:(NSString *)key;
 + (NSArray *)arrayFromJSONValue:(NSDictionary *)JSONValue forKey:(NSString *)key;
@@ -28,10 +28,18 @@
 
 #import "BAJSONLoader.h"
 #import "BARuntime.h"
+#import "BAJSONBinary.h"
 
 @implementation BAJSONLoader
 
 @synthesize JSONValue = _JSONValue;
+@synthesize stringTable = _stringTable;
+@synthesize cachesBinaryJSON = _cachesBinaryJSON;
+
+- (void)dealloc {
+	[_stringTable release];
+	[super dealloc];
+}
 
 - (void)resetConnection {
 	[super resetConnection];
@@ -50,17 +58,52 @@
 //	NSLog(@"%@", text);
 
 	NSError *error = nil;
-	_JSONValue = [[[self class] parseJSONData:data error:&error] retain];
+	if (_stringTable) {
+		_JSONValue = [[[self class] parseJSONData:data stringTable:_stringTable error:&error] retain];
+	} else {
+		_JSONValue = [[[self class] parseJSONData:data error:&error] retain];
+	}
 	if (error) {
 		NSLog(@"Error parsing JSON from %@: %@", [self.request URL], error);
 	}
 	return !error;
 }
 
+- (BOOL)prepareCachedData:(NSData *)data {
+	if (!_cachesBinaryJSON || ![BAJSONBinary isBinaryData:data]) {
+		return [self prepareData:data];
+	}
+	[_JSONValue release];
+	NSError *error = nil;
+	_JSONValue = [[BAJSONBinary JSONValueWithData:data error:&error] retain];
+	if (error) {
+		NSLog(@"Error reading cached JSON for %@: %@", [self.request URL], error);
+	}
+	return !!_JSONValue;
+}
+
+- (NSData *)cacheDataForData:(NSData *)data {
+	if (_cachesBinaryJSON && _JSONValue) {
+		NSData *binaryData = [BAJSONBinary dataWithJSONValue:_JSONValue];
+		if (binaryData) {
+			return binaryData;
+		}
+	}
+	return data;
+}
+
 + (id)parseJSONData:(NSData *)data error:(NSError **)error {
 	return [BARuntime parseJSONData:data error:error];
 }
 
++ (id)parseJSONData:(NSData *)data stringTable:(BAJSONStringTable *)stringTable error:(NSError **)error {
+	const SEL selector = @selector(parseJSONData:error:);
+	if (!stringTable || [self methodForSelector:selector] != [BAJSONLoader methodForSelector:selector]) {
+		return [self parseJSONData:data error:error];
+	}
+	return [BARuntime parseJSONData:data stringTable:stringTable error:error];
+}
+
 + (NSString *)stringFromJSONValue:(NSDictionary *)JSONValue forKey:(NSString *)key {
 	id value = [JSONValue objectForKey:key];
 	if (value && [value isKindOfClass:[NSString class]]) {
@@ -0,0 +1,81 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Low level pull scanner working directly on UTF-8 JSON bytes.
+// 
+// It does not build any Foundation objects, so decoders on top of it can store values
+// wherever they want. Strings without escapes are reported as spans into the input,
+// otherwise they are unescaped into the scanner's own reusable buffer.
+
+typedef enum {
+	BAJSONValueTypeNone = 0, // malformed input or end of input
+	BAJSONValueTypeObject,
+	BAJSONValueTypeArray,
+	BAJSONValueTypeString,
+	BAJSONValueTypeNumber,
+	BAJSONValueTypeTrue,
+	BAJSONValueTypeFalse,
+	BAJSONValueTypeNull
+} BAJSONValueType;
+
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	const uint8_t *start;
+	// last scanned string; points either into the input or into the buffer
+	const uint8_t *string;
+	size_t stringLength;
+	// last scanned number
+	BOOL integer;
+	long long integerValue;
+	double doubleValue;
+	// scratch space for unescaped strings
+	uint8_t *buffer;
+	size_t bufferCapacity;
+	const char *error;
+} BAJSONScanner;
+
+void BAJSONScannerInit(BAJSONScanner *scanner, const void *bytes, size_t length);
+void BAJSONScannerDestroy(BAJSONScanner *scanner);
+
+// Skips whitespace and returns the type of the next value without consuming it.
+BAJSONValueType BAJSONScannerPeek(BAJSONScanner *scanner);
+// Skips whitespace and consumes the character if it is next; never fails.
+BOOL BAJSONScannerSkip(BAJSONScanner *scanner, char c);
+// Same as skip but records an error if the character is not next.
+BOOL BAJSONScannerExpect(BAJSONScanner *scanner, char c);
+BOOL BAJSONScannerScanString(BAJSONScanner *scanner);
+BOOL BAJSONScannerScanNumber(BAJSONScanner *scanner);
+BOOL BAJSONScannerScanLiteral(BAJSONScanner *scanner, BAJSONValueType type);
+BOOL BAJSONScannerSkipValue(BAJSONScanner *scanner);
+BOOL BAJSONScannerAtEnd(BAJSONScanner *scanner);
+
+// Returns nil if no error was recorded.
+NSError *BAJSONScannerError(BAJSONScanner *scanner);
@@ -0,0 +1,412 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BAJSONScanner.h"
+
+#define kBAJSONScannerMaxDepth 512
+
+static BOOL BAJSONScannerSkipValueAtDepth(BAJSONScanner *scanner, NSUInteger depth);
+
+void BAJSONScannerInit(BAJSONScanner *scanner, const void *bytes, size_t length) {
+	memset(scanner, 0, sizeof(BAJSONScanner));
+	scanner->start = bytes;
+	scanner->p = bytes;
+	scanner->end = scanner->p + length;
+	// skip UTF-8 BOM
+	if (length >= 3 && scanner->p[0] == 0xEF && scanner->p[1] == 0xBB && scanner->p[2] == 0xBF) {
+		scanner->p += 3;
+	}
+}
+
+void BAJSONScannerDestroy(BAJSONScanner *scanner) {
+	free(scanner->buffer);
+	scanner->buffer = NULL;
+	scanner->bufferCapacity = 0;
+}
+
+static inline BOOL BAJSONScannerFail(BAJSONScanner *scanner, const char *error) {
+	if (!scanner->error) {
+		scanner->error = error;
+	}
+	return NO;
+}
+
+static inline void BAJSONScannerSkipSpace(BAJSONScanner *scanner) {
+	const uint8_t *p = scanner->p;
+	const uint8_t *end = scanner->end;
+	while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+		p++;
+	}
+	scanner->p = p;
+}
+
+BAJSONValueType BAJSONScannerPeek(BAJSONScanner *scanner) {
+	BAJSONScannerSkipSpace(scanner);
+	if (scanner->error || scanner->p >= scanner->end) {
+		return BAJSONValueTypeNone;
+	}
+	switch (*scanner->p) {
+		case '{': return BAJSONValueTypeObject;
+		case '[': return BAJSONValueTypeArray;
+		case '"': return BAJSONValueTypeString;
+		case 't': return BAJSONValueTypeTrue;
+		case 'f': return BAJSONValueTypeFalse;
+		case 'n': return BAJSONValueTypeNull;
+		case '-':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			return BAJSONValueTypeNumber;
+	}
+	return BAJSONValueTypeNone;
+}
+
+BOOL BAJSONScannerSkip(BAJSONScanner *scanner, char c) {
+	BAJSONScannerSkipSpace(scanner);
+	if (scanner->p < scanner->end && *scanner->p == c) {
+		scanner->p++;
+		return YES;
+	}
+	return NO;
+}
+
+BOOL BAJSONScannerExpect(BAJSONScanner *scanner, char c) {
+	if (BAJSONScannerSkip(scanner, c)) {
+		return YES;
+	}
+	switch (c) {
+		case '{': return BAJSONScannerFail(scanner, "Expected object");
+		case '[': return BAJSONScannerFail(scanner, "Expected array");
+		case ':': return BAJSONScannerFail(scanner, "Expected ':' after object key");
+		case '}': return BAJSONScannerFail(scanner, "Expected ',' or '}' in object");
+		case ']': return BAJSONScannerFail(scanner, "Expected ',' or ']' in array");
+	}
+	return BAJSONScannerFail(scanner, "Unexpected character");
+}
+
+BOOL BAJSONScannerAtEnd(BAJSONScanner *scanner) {
+	BAJSONScannerSkipSpace(scanner);
+	return scanner->p >= scanner->end;
+}
+
+static BOOL BAJSONScannerReserve(BAJSONScanner *scanner, size_t capacity) {
+	if (capacity <= scanner->bufferCapacity) {
+		return YES;
+	}
+	size_t newCapacity = MAX(capacity, MAX(64, scanner->bufferCapacity * 2));
+	uint8_t *buffer = realloc(scanner->buffer, newCapacity);
+	if (!buffer) {
+		return BAJSONScannerFail(scanner, "Out of memory");
+	}
+	scanner->buffer = buffer;
+	scanner->bufferCapacity = newCapacity;
+	return YES;
+}
+
+static inline int BAJSONHexDigit(uint8_t c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static BOOL BAJSONScannerScanHex4(BAJSONScanner *scanner, const uint8_t **pp, uint32_t *value) {
+	const uint8_t *p = *pp;
+	if (scanner->end - p < 4) {
+		return BAJSONScannerFail(scanner, "Truncated unicode escape");
+	}
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++) {
+		int d = BAJSONHexDigit(p[i]);
+		if (d < 0) {
+			return BAJSONScannerFail(scanner, "Invalid unicode escape");
+		}
+		v = (v << 4) | d;
+	}
+	*pp = p + 4;
+	*value = v;
+	return YES;
+}
+
+static size_t BAJSONEncodeUTF8(uint32_t c, uint8_t *out) {
+	if (c < 0x80) {
+		out[0] = c;
+		return 1;
+	} else if (c < 0x800) {
+		out[0] = 0xC0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3F);
+		return 2;
+	} else if (c < 0x10000) {
+		out[0] = 0xE0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3F);
+		out[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (c >> 18);
+	out[1] = 0x80 | ((c >> 12) & 0x3F);
+	out[2] = 0x80 | ((c >> 6) & 0x3F);
+	out[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+BOOL BAJSONScannerScanString(BAJSONScanner *scanner) {
+	BAJSONScannerSkipSpace(scanner);
+	const uint8_t *p = scanner->p;
+	const uint8_t *end = scanner->end;
+	if (p >= end || *p != '"') {
+		return BAJSONScannerFail(scanner, "Expected string");
+	}
+	p++;
+	// fast path: no escapes, report the span in the input
+	const uint8_t *s = p;
+	while (p < end && *p != '"' && *p != '\\' && *p >= 0x20) {
+		p++;
+	}
+	if (p >= end) {
+		return BAJSONScannerFail(scanner, "Unterminated string");
+	}
+	if (*p == '"') {
+		scanner->string = s;
+		scanner->stringLength = p - s;
+		scanner->p = p + 1;
+		return YES;
+	}
+	// slow path: unescape into the buffer; output is never longer than input
+	size_t length = p - s;
+	if (!BAJSONScannerReserve(scanner, (end - s))) {
+		return NO;
+	}
+	uint8_t *out = scanner->buffer;
+	memcpy(out, s, length);
+	while (p < end) {
+		uint8_t c = *p++;
+		if (c == '"') {
+			scanner->string = scanner->buffer;
+			scanner->stringLength = length;
+			scanner->p = p;
+			return YES;
+		} else if (c < 0x20) {
+			return BAJSONScannerFail(scanner, "Control character in string");
+		} else if (c != '\\') {
+			out[length++] = c;
+			continue;
+		}
+		if (p >= end) {
+			break;
+		}
+		c = *p++;
+		switch (c) {
+			case '"': out[length++] = '"'; break;
+			case '\\': out[length++] = '\\'; break;
+			case '/': out[length++] = '/'; break;
+			case 'b': out[length++] = '\b'; break;
+			case 'f': out[length++] = '\f'; break;
+			case 'n': out[length++] = '\n'; break;
+			case 'r': out[length++] = '\r'; break;
+			case 't': out[length++] = '\t'; break;
+			case 'u': {
+				uint32_t u;
+				if (!BAJSONScannerScanHex4(scanner, &p, &u)) {
+					return NO;
+				}
+				if (u >= 0xD800 && u <= 0xDBFF) {
+					uint32_t low;
+					if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+						return BAJSONScannerFail(scanner, "Unpaired surrogate in string");
+					}
+					p += 2;
+					if (!BAJSONScannerScanHex4(scanner, &p, &low)) {
+						return NO;
+					}
+					if (low < 0xDC00 || low > 0xDFFF) {
+						return BAJSONScannerFail(scanner, "Unpaired surrogate in string");
+					}
+					u = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+				} else if (u >= 0xDC00 && u <= 0xDFFF) {
+					return BAJSONScannerFail(scanner, "Unpaired surrogate in string");
+				}
+				// \uXXXX takes 6 input bytes and at most 3 output bytes, pairs 12 and 4
+				length += BAJSONEncodeUTF8(u, out + length);
+				break;
+			}
+			default:
+				return BAJSONScannerFail(scanner, "Invalid escape in string");
+		}
+	}
+	return BAJSONScannerFail(scanner, "Unterminated string");
+}
+
+BOOL BAJSONScannerScanNumber(BAJSONScanner *scanner) {
+	BAJSONScannerSkipSpace(scanner);
+	const uint8_t *p = scanner->p;
+	const uint8_t *end = scanner->end;
+	const uint8_t *s = p;
+	BOOL negative = NO;
+	if (p < end && *p == '-') {
+		negative = YES;
+		p++;
+	}
+	if (p >= end || *p < '0' || *p > '9') {
+		return BAJSONScannerFail(scanner, "Invalid number");
+	}
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	if (*p == '0') {
+		p++;
+	} else {
+		while (p < end && *p >= '0' && *p <= '9') {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits++;
+			p++;
+		}
+	}
+	BOOL integer = YES;
+	if (p < end && *p == '.') {
+		integer = NO;
+		p++;
+		if (p >= end || *p < '0' || *p > '9') {
+			return BAJSONScannerFail(scanner, "Invalid number");
+		}
+		while (p < end && *p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		integer = NO;
+		p++;
+		if (p < end && (*p == '+' || *p == '-')) {
+			p++;
+		}
+		if (p >= end || *p < '0' || *p > '9') {
+			return BAJSONScannerFail(scanner, "Invalid number");
+		}
+		while (p < end && *p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+	scanner->p = p;
+	// 18 digits always fit into long long
+	if (integer && digits <= 18) {
+		scanner->integer = YES;
+		scanner->integerValue = negative ? -(long long)mantissa : (long long)mantissa;
+		scanner->doubleValue = (double)scanner->integerValue;
+		return YES;
+	}
+	char text[64];
+	size_t length = p - s;
+	char *t = (length < sizeof(text)) ? text : malloc(length + 1);
+	if (!t) {
+		return BAJSONScannerFail(scanner, "Out of memory");
+	}
+	memcpy(t, s, length);
+	t[length] = 0;
+	scanner->integer = NO;
+	scanner->doubleValue = strtod(t, NULL);
+	scanner->integerValue = (long long)scanner->doubleValue;
+	if (t != text) {
+		free(t);
+	}
+	return YES;
+}
+
+BOOL BAJSONScannerScanLiteral(BAJSONScanner *scanner, BAJSONValueType type) {
+	BAJSONScannerSkipSpace(scanner);
+	const char *literal;
+	size_t length;
+	switch (type) {
+		case BAJSONValueTypeTrue: literal = "true"; length = 4; break;
+		case BAJSONValueTypeFalse: literal = "false"; length = 5; break;
+		case BAJSONValueTypeNull: literal = "null"; length = 4; break;
+		default: return BAJSONScannerFail(scanner, "Invalid literal");
+	}
+	if ((size_t)(scanner->end - scanner->p) < length || memcmp(scanner->p, literal, length) != 0) {
+		return BAJSONScannerFail(scanner, "Invalid literal");
+	}
+	scanner->p += length;
+	return YES;
+}
+
+static BOOL BAJSONScannerSkipValueAtDepth(BAJSONScanner *scanner, NSUInteger depth) {
+	if (depth > kBAJSONScannerMaxDepth) {
+		return BAJSONScannerFail(scanner, "Nesting is too deep");
+	}
+	BAJSONValueType type = BAJSONScannerPeek(scanner);
+	switch (type) {
+		case BAJSONValueTypeObject:
+			scanner->p++;
+			if (BAJSONScannerSkip(scanner, '}')) {
+				return YES;
+			}
+			do {
+				if (!BAJSONScannerScanString(scanner) ||
+					!BAJSONScannerExpect(scanner, ':') ||
+					!BAJSONScannerSkipValueAtDepth(scanner, depth + 1))
+				{
+					return NO;
+				}
+			} while (BAJSONScannerSkip(scanner, ','));
+			return BAJSONScannerExpect(scanner, '}');
+		case BAJSONValueTypeArray:
+			scanner->p++;
+			if (BAJSONScannerSkip(scanner, ']')) {
+				return YES;
+			}
+			do {
+				if (!BAJSONScannerSkipValueAtDepth(scanner, depth + 1)) {
+					return NO;
+				}
+			} while (BAJSONScannerSkip(scanner, ','));
+			return BAJSONScannerExpect(scanner, ']');
+		case BAJSONValueTypeString:
+			return BAJSONScannerScanString(scanner);
+		case BAJSONValueTypeNumber:
+			return BAJSONScannerScanNumber(scanner);
+		case BAJSONValueTypeTrue:
+		case BAJSONValueTypeFalse:
+		case BAJSONValueTypeNull:
+			return BAJSONScannerScanLiteral(scanner, type);
+		case BAJSONValueTypeNone:
+			break;
+	}
+	return BAJSONScannerFail(scanner, (scanner->p >= scanner->end) ? "Unexpected end of data" : "Unexpected character");
+}
+
+BOOL BAJSONScannerSkipValue(BAJSONScanner *scanner) {
+	return BAJSONScannerSkipValueAtDepth(scanner, 0);
+}
+
+NSError *BAJSONScannerError(BAJSONScanner *scanner) {
+	if (!scanner->error) {
+		return nil;
+	}
+	NSString *description = [NSString stringWithFormat:@"%s at offset %lu",
+							 scanner->error, (unsigned long)(scanner->p - scanner->start)];
+	return [NSError errorWithDomain:@"BaseAppKit"
+							   code:0
+						   userInfo:[NSDictionary dictionaryWithObject:description
+																forKey:NSLocalizedDescriptionKey]];
+}
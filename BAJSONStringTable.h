@@ -0,0 +1,54 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Bounded table of immutable strings shared between JSON parses.
+// 
+// Object keys are always looked up in the table so every "id" or "name" in a response
+// is the same NSString instance. Short string values are interned too if maxValueLength
+// is set. Once the table is full new strings are created as usual but not added.
+// Tables are not thread safe, use one per loader or per parse.
+
+@interface BAJSONStringTable : NSObject
+
+@property(nonatomic, readonly) NSUInteger capacity;
+@property(nonatomic, assign) NSUInteger maxValueLength; // in UTF-8 bytes; default is 0 which disables values interning
+@property(nonatomic, readonly) NSUInteger count;
+@property(nonatomic, readonly) NSUInteger lookupsCount; // strings requested from the table
+@property(nonatomic, readonly) NSUInteger hitsCount; // strings returned without allocation
+
+- (id)initWithCapacity:(NSUInteger)capacity; // default is 1024
+
+// Both return nil for invalid UTF-8.
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length;
+- (NSString *)newStringWithBytes:(const void *)bytes length:(NSUInteger)length; // retained
+- (void)removeAllStrings;
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,140 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BAJSONStringTable.h"
+
+#define kBAJSONStringTableDefaultCapacity 1024
+
+typedef struct {
+	NSUInteger hash;
+	NSUInteger length;
+	uint8_t *bytes;
+	NSString *string;
+} BAJSONStringTableEntry;
+
+static inline NSUInteger BAJSONStringTableHash(const uint8_t *bytes, NSUInteger length) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (NSUInteger i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+@implementation BAJSONStringTable {
+@private
+	BAJSONStringTableEntry *_entries;
+	NSUInteger _mask; // number of slots minus one
+	NSUInteger _capacity;
+	NSUInteger _maxValueLength;
+	NSUInteger _count;
+	NSUInteger _lookupsCount;
+	NSUInteger _hitsCount;
+}
+
+@synthesize capacity = _capacity;
+@synthesize maxValueLength = _maxValueLength;
+@synthesize count = _count;
+@synthesize lookupsCount = _lookupsCount;
+@synthesize hitsCount = _hitsCount;
+
+- (id)initWithCapacity:(NSUInteger)capacity {
+	if ((self = [super init])) {
+		_capacity = MAX(capacity, 1);
+		// keep load factor at most 1/2
+		NSUInteger slots = 2;
+		while (slots < _capacity * 2) {
+			slots *= 2;
+		}
+		_mask = slots - 1;
+		_entries = calloc(slots, sizeof(BAJSONStringTableEntry));
+	}
+	return self;
+}
+
+- (id)init {
+	return [self initWithCapacity:kBAJSONStringTableDefaultCapacity];
+}
+
+- (void)dealloc {
+	[self removeAllStrings];
+	free(_entries);
+	[super dealloc];
+}
+
+- (NSString *)newStringWithBytes:(const void *)bytes length:(NSUInteger)length {
+	_lookupsCount++;
+	const NSUInteger hash = BAJSONStringTableHash(bytes, length);
+	NSUInteger slot = hash & _mask;
+	while (_entries[slot].string) {
+		BAJSONStringTableEntry *entry = &_entries[slot];
+		if (entry->hash == hash && entry->length == length && memcmp(entry->bytes, bytes, length) == 0) {
+			_hitsCount++;
+			return [entry->string retain];
+		}
+		slot = (slot + 1) & _mask;
+	}
+	NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+	if (string && _count < _capacity) {
+		uint8_t *entryBytes = malloc(MAX(length, 1));
+		if (entryBytes) {
+			memcpy(entryBytes, bytes, length);
+			BAJSONStringTableEntry *entry = &_entries[slot];
+			entry->hash = hash;
+			entry->length = length;
+			entry->bytes = entryBytes;
+			entry->string = [string retain];
+			_count++;
+		}
+	}
+	return string;
+}
+
+- (NSString *)stringWithBytes:(const void *)bytes length:(NSUInteger)length {
+	return [[self newStringWithBytes:bytes length:length] autorelease];
+}
+
+- (void)removeAllStrings {
+	for (NSUInteger slot = 0; slot <= _mask; slot++) {
+		BAJSONStringTableEntry *entry = &_entries[slot];
+		if (entry->string) {
+			[entry->string release];
+			free(entry->bytes);
+			memset(entry, 0, sizeof(BAJSONStringTableEntry));
+		}
+	}
+	_count = 0;
+}
+
+- (void)resetStatistics {
+	_lookupsCount = 0;
+	_hitsCount = 0;
+}
+
+@end
@@ -46,4 +46,12 @@ typedef enum {
 - (void)sizeToFitInWidth;
 - (void)sizeToFitInWidthMaxHeight:(CGFloat)maxHeight;
 
+// Size of label text with insets measured without a label; could be called from any thread
++ (CGSize)sizeOfText:(NSString *)text
+			withFont:(UIFont *)font
+   constrainedToSize:(CGSize)size
+	   numberOfLines:(NSInteger)numberOfLines
+	   lineBreakMode:(UILineBreakMode)lineBreakMode
+		  textInsets:(UIEdgeInsets)textInsets;
+
 @end
@@ -27,6 +27,7 @@
  */
 
 #import "BALabel.h"
+#import "BATextMeasurer.h"
 
 CGPathRef CGPathCreateRoundBezel(CGRect bounds, CGFloat lineWidth);
 
@@ -59,10 +60,6 @@ CGPathRef CGPathCreateRoundBezel(CGRect bounds, CGFloat lineWidth) {
 	BALabelBezel _bezel;
 	CGFloat _bezelLineWidth;
 	UIColor *_bezelColor;
-	
-	CGFloat _fitMaxWidth;
-	CGFloat _fitMaxHeight;
-	int _fit;
 }
 
 - (void)dealloc {
@@ -133,10 +130,6 @@ CGPathRef CGPathCreateRoundBezel(CGRect bounds, CGFloat lineWidth) {
 
 - (CGRect)textRectForBounds:(CGRect)bounds limitedToNumberOfLines:(NSInteger)numberOfLines {
 	CGRect r = bounds;
-	if (_fit > 0) {
-		r.size.width = _fitMaxWidth;
-		r.size.height = _fitMaxHeight;
-	}
 	const CGFloat wd = self.textInsets.left + self.textInsets.right;
 	const CGFloat hd = self.textInsets.top + self.textInsets.bottom;
 	r.size.width -= wd;
@@ -204,18 +197,36 @@ CGPathRef CGPathCreateRoundBezel(CGRect bounds, CGFloat lineWidth) {
 
 - (void)sizeToFitInWidthMaxHeight:(CGFloat)maxHeight {
 	const CGFloat w = self.bounds.size.width;
-
-	_fit++;
-	_fitMaxWidth = w;
-	_fitMaxHeight = maxHeight;
 	
-	CGSize s = [self sizeThatFits:CGSizeMake(w, maxHeight)];
-	
-	_fit--;
+	CGSize s = [BALabel sizeOfText:self.text
+						  withFont:self.font
+				 constrainedToSize:CGSizeMake(w, maxHeight)
+					 numberOfLines:self.numberOfLines
+					 lineBreakMode:self.lineBreakMode
+						textInsets:self.textInsets];
 	
 	CGRect frame = self.frame;
 	frame.size.height = s.height;
 	self.frame = frame;
 }
 
++ (CGSize)sizeOfText:(NSString *)text
+			withFont:(UIFont *)font
+   constrainedToSize:(CGSize)size
+	   numberOfLines:(NSInteger)numberOfLines
+	   lineBreakMode:(UILineBreakMode)lineBreakMode
+		  textInsets:(UIEdgeInsets)textInsets
+{
+	const CGFloat wd = textInsets.left + textInsets.right;
+	const CGFloat hd = textInsets.top + textInsets.bottom;
+	CGSize s = [[BATextMeasurer sharedMeasurer] sizeOfText:text
+												  withFont:font
+										 constrainedToSize:CGSizeMake(size.width - wd, size.height - hd)
+											 numberOfLines:numberOfLines
+											 lineBreakMode:lineBreakMode];
+	s.width += wd;
+	s.height += hd;
+	return s;
+}
+
 @end
@@ -0,0 +1,280 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#include <math.h>
+#include "BAMeshLayout.h"
+
+static BAMeshFloat BAMeshExtrapolatedSpread(long cellsCount, BAMeshSize rowSize, BAMeshFloat maxWidth) {
+	if (cellsCount < 2 || rowSize.width == 0) {
+		return 0;
+	}
+	const BAMeshFloat avgCellWidth = rowSize.width / cellsCount;
+	const int availableCellsCount = (maxWidth - rowSize.width) / avgCellWidth;
+	return (maxWidth - rowSize.width - avgCellWidth * availableCellsCount) / (cellsCount + availableCellsCount - 1);
+}
+
+static void BAMeshLayoutRow(BAMeshSectionLayout *layout,
+							long firstCell,
+							long cellsCount,
+							BAMeshSize rowSize,
+							BAMeshFloat left,
+							BAMeshFloat maxWidth)
+{
+	if (cellsCount == 0) {
+		return;
+	}
+	BAMeshRowLayout rowLayout = layout->rowLayout;
+	const int lastRow = (layout->numberOfCells == firstCell + cellsCount);
+	if (!lastRow && (rowLayout == BAMeshRowLayoutSpreadCenter ||
+					 rowLayout == BAMeshRowLayoutSpreadLeft ||
+					 rowLayout == BAMeshRowLayoutSpreadRight))
+	{
+		rowLayout = BAMeshRowLayoutSpread;
+	}
+	BAMeshFloat d; // horizontal interval
+	BAMeshFloat x;
+	BAMeshFloat w = 0; // cell width for fill layout
+	switch (rowLayout) {
+		case BAMeshRowLayoutSpreadCenter:
+			d = BAMeshExtrapolatedSpread(cellsCount, rowSize, maxWidth);
+			x = (maxWidth - rowSize.width) / 2;
+			break;
+		case BAMeshRowLayoutSpreadLeft:
+			d = BAMeshExtrapolatedSpread(cellsCount, rowSize, maxWidth);
+			x = 0;
+			break;
+		case BAMeshRowLayoutSpreadRight:
+			d = BAMeshExtrapolatedSpread(cellsCount, rowSize, maxWidth);
+			x = maxWidth - rowSize.width - d * (cellsCount - 1);
+			break;
+		case BAMeshRowLayoutCenter:
+			d = 0;
+			x = (maxWidth - rowSize.width) / 2;
+			break;
+		case BAMeshRowLayoutLeft:
+			d = 0;
+			x = 0;
+			break;
+		case BAMeshRowLayoutRight:
+			d = 0;
+			x = maxWidth - rowSize.width;
+			break;
+		case BAMeshRowLayoutFill:
+			d = 0;
+			x = 0;
+			w = maxWidth / cellsCount;
+			break;
+		case BAMeshRowLayoutSpread:
+		default:
+			if (cellsCount > 1) {
+				d = (maxWidth - rowSize.width) / (cellsCount - 1);
+			} else {
+				d = 0;
+			}
+			x = 0;
+			break;
+	}
+	x += left;
+	for (long cell = firstCell; cell < firstCell + cellsCount; cell++) {
+		BAMeshRect cellFrame = layout->cellFrames[cell];
+		cellFrame.x = rint(x);
+		if (rowLayout == BAMeshRowLayoutFill) {
+			cellFrame.width = rint(w);
+			x += w + d;
+		} else {
+			x += cellFrame.width + d;
+		}
+		const BAMeshCellAlignment cellAlignment = layout->cellAlignments ? layout->cellAlignments[cell] : layout->alignment;
+		// we assume here that cells are aligned at the top of the row
+		switch (cellAlignment) {
+			case BAMeshCellAlignmentTop:
+				// nothing to do
+				break;
+			case BAMeshCellAlignmentCenter:
+				cellFrame.y += rint((rowSize.height - cellFrame.height) / 2);
+				break;
+			case BAMeshCellAlignmentBottom:
+				cellFrame.y += rint(rowSize.height - cellFrame.height);
+				break;
+			case BAMeshCellAlignmentFill:
+				cellFrame.height = rowSize.height;
+				break;
+		}
+		layout->cellFrames[cell] = cellFrame;
+	}
+}
+
+static void BAMeshAddRow(BAMeshSectionLayout *layout, long firstCell, BAMeshFloat top, BAMeshFloat bottom) {
+	layout->rowFirstCells[layout->numberOfRows] = firstCell;
+	layout->rowTops[layout->numberOfRows] = top;
+	layout->rowBottoms[layout->numberOfRows] = bottom;
+	layout->numberOfRows++;
+}
+
+void BAMeshLayoutSectionFromRow(BAMeshSectionLayout *layout, BAMeshFloat width, long firstRow) {
+	const BAMeshInsets rowsInsets = layout->rowsInsets;
+	const BAMeshFloat maxRowsWidth = width - (rowsInsets.left + rowsInsets.right);
+	if (firstRow < 0 || firstRow >= layout->numberOfRows) {
+		firstRow = (firstRow > 0 && layout->numberOfRows > 0) ? layout->numberOfRows - 1 : 0;
+	}
+	long firstRowCell = 0;
+	BAMeshFloat y = layout->headerHeight + rowsInsets.top;
+	if (firstRow > 0) {
+		firstRowCell = layout->rowFirstCells[firstRow];
+		y = layout->rowBottoms[firstRow - 1];
+	}
+	layout->numberOfRows = firstRow;
+	BAMeshFloat x = 0;
+	BAMeshFloat rowHeight = 0;
+	for (long cell = firstRowCell; cell < layout->numberOfCells; cell++) {
+		const BAMeshSize cellSize = layout->cellSizes[cell];
+		if (cell > firstRowCell && (x + cellSize.width) > maxRowsWidth) {
+			BAMeshLayoutRow(layout, firstRowCell, cell - firstRowCell, (BAMeshSize){ x, rowHeight }, rowsInsets.left, maxRowsWidth);
+			BAMeshAddRow(layout, firstRowCell, y, y + rowHeight);
+			y += rowHeight;
+			x = 0;
+			rowHeight = 0;
+			firstRowCell = cell;
+		}
+		layout->cellFrames[cell] = (BAMeshRect){ x, y, cellSize.width, cellSize.height };
+		x += cellSize.width;
+		if (cellSize.height > rowHeight) {
+			rowHeight = cellSize.height;
+		}
+	}
+	if (layout->numberOfCells > firstRowCell) {
+		BAMeshLayoutRow(layout, firstRowCell, layout->numberOfCells - firstRowCell, (BAMeshSize){ x, rowHeight }, rowsInsets.left, maxRowsWidth);
+		BAMeshAddRow(layout, firstRowCell, y, y + rowHeight);
+	}
+	y += rowHeight;
+	layout->totalHeight = y + rowsInsets.bottom + layout->footerHeight;
+}
+
+void BAMeshLayoutSection(BAMeshSectionLayout *layout, BAMeshFloat width) {
+	BAMeshLayoutSectionFromRow(layout, width, 0);
+}
+
+long BAMeshLayoutRowForChangedCell(const BAMeshSectionLayout *layout, long cell) {
+	const long precedingCell = (cell < layout->numberOfCells ? cell : layout->numberOfCells) - 1;
+	if (precedingCell < 0 || layout->numberOfRows == 0) {
+		return 0;
+	}
+	// last row starting at or before the preceding cell
+	long low = 0;
+	long high = layout->numberOfRows;
+	while (low < high) {
+		const long mid = (low + high) / 2;
+		if (layout->rowFirstCells[mid] > precedingCell) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low > 0 ? low - 1 : 0;
+}
+
+BAMeshFloat BAMeshLayoutSections(BAMeshSectionLayout *sections, long numberOfSections, BAMeshFloat width, BAMeshFloat top) {
+	BAMeshFloat y = top;
+	for (long section = 0; section < numberOfSections; section++) {
+		BAMeshLayoutSection(&sections[section], width);
+		sections[section].y = y;
+		y += sections[section].totalHeight;
+	}
+	return y - top;
+}
+
+void BAMeshLayoutRowsInRange(const BAMeshSectionLayout *layout, BAMeshFloat minY, BAMeshFloat maxY, long *firstRow, long *rowsCount) {
+	minY -= layout->y;
+	maxY -= layout->y;
+	// first row which ends below min y
+	long low = 0;
+	long high = layout->numberOfRows;
+	while (low < high) {
+		const long mid = (low + high) / 2;
+		if (layout->rowBottoms[mid] > minY) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	*firstRow = low;
+	// first row which starts at or below max y
+	high = layout->numberOfRows;
+	while (low < high) {
+		const long mid = (low + high) / 2;
+		if (layout->rowTops[mid] >= maxY) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	*rowsCount = low - *firstRow;
+}
+
+void BAMeshLayoutCellsInRows(const BAMeshSectionLayout *layout, long firstRow, long rowsCount, long *firstCell, long *cellsCount) {
+	if (rowsCount <= 0 || firstRow < 0 || firstRow >= layout->numberOfRows) {
+		*firstCell = 0;
+		*cellsCount = 0;
+		return;
+	}
+	const long endRow = firstRow + rowsCount;
+	*firstCell = layout->rowFirstCells[firstRow];
+	*cellsCount = ((endRow < layout->numberOfRows) ? layout->rowFirstCells[endRow] : layout->numberOfCells) - *firstCell;
+}
+
+long BAMeshLayoutCellAtPoint(const BAMeshSectionLayout *layout, BAMeshFloat x, BAMeshFloat y) {
+	long row;
+	long rowsCount;
+	BAMeshLayoutRowsInRange(layout, y, y, &row, &rowsCount);
+	if (row >= layout->numberOfRows || layout->rowTops[row] + layout->y > y) {
+		return -1;
+	}
+	// cells go from left to right within a row, find the last one starting at or before x
+	long firstCell;
+	long cellsCount;
+	BAMeshLayoutCellsInRows(layout, row, 1, &firstCell, &cellsCount);
+	long low = firstCell;
+	long high = firstCell + cellsCount;
+	while (low < high) {
+		const long mid = (low + high) / 2;
+		if (layout->cellFrames[mid].x > x) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	// rounded frames of neighbours could overlap by a point, the previous cell is checked as well
+	for (long cell = low - 1; cell >= firstCell && cell >= low - 2; cell--) {
+		const BAMeshRect frame = layout->cellFrames[cell];
+		const BAMeshFloat cellY = frame.y + layout->y;
+		if (x >= frame.x && x < frame.x + frame.width && y >= cellY && y < cellY + frame.height) {
+			return cell;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,134 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#ifndef BAMESHLAYOUT_H
+#define BAMESHLAYOUT_H
+
+#include <stddef.h>
+
+// Layout engine of BAMeshView working on plain arrays.
+// 
+// It does not depend on UIKit or Foundation, so it builds with any C compiler and could be
+// used for benchmarks and tests outside of application. Cells are packed into rows from left
+// to right and rows go from top to bottom. Frames of cells and rows are relative to the top
+// of their section and section offsets are relative to the top of the mesh.
+
+#if defined(__APPLE__)
+#include <CoreGraphics/CGBase.h>
+typedef CGFloat BAMeshFloat;
+#else
+typedef double BAMeshFloat;
+#endif
+
+typedef struct {
+	BAMeshFloat x;
+	BAMeshFloat y;
+	BAMeshFloat width;
+	BAMeshFloat height;
+} BAMeshRect;
+
+typedef struct {
+	BAMeshFloat width;
+	BAMeshFloat height;
+} BAMeshSize;
+
+typedef struct {
+	BAMeshFloat top;
+	BAMeshFloat left;
+	BAMeshFloat bottom;
+	BAMeshFloat right;
+} BAMeshInsets;
+
+// Note about spread logic:
+// 
+// By default all cells in a row are distributed evenly along the row. But the last row could be treated
+// differently because it could contain fewer cells and (especially for meshes with a fixed cell size)
+// it makes sense to use the same horizontal spacing as for the rows above.
+// 
+// So layouts BAMeshRowLayoutSpread[Center|Left|Right] treat the last row in a special way: first average
+// cell width for the last row is calculated. Then we calculate how many average cells would fit in the row.
+// Next based on this estimate we calculate horizontal spacing which is used to separate the existing cells.
+// This should give us better layout for the last row and if all cells have a fixed size then horizontal
+// spacing will be exactly the same for all rows.
+
+typedef enum {
+	BAMeshRowLayoutSpread = 0, // default; distribute cells evenly in rows
+	BAMeshRowLayoutSpreadCenter, // spread with the last row centered
+	BAMeshRowLayoutSpreadLeft, // spread with the last row aligned to the left side
+	BAMeshRowLayoutSpreadRight, // spread with the last row aligned to the right side
+	BAMeshRowLayoutCenter, // all cells are packed and centered within row
+	BAMeshRowLayoutLeft, // all cells are packed at the left side
+	BAMeshRowLayoutRight, // all cells are packed at the right side
+	BAMeshRowLayoutFill // all cells are made equal width to cover the whole row
+} BAMeshRowLayout;
+
+typedef enum {
+	BAMeshCellAlignmentCenter = 0, // default; cell is centered vertically within row
+	BAMeshCellAlignmentTop, // cell is at row's top
+	BAMeshCellAlignmentBottom, // cell is at row's bottom
+	BAMeshCellAlignmentFill // cell height is made equal to the row height
+} BAMeshCellAlignment;
+
+// Layout of a section. Inputs are set by caller, outputs are arrays owned by caller with
+// capacity for all cells (there is at least one cell in a row).
+typedef struct {
+	// input
+	long numberOfCells;
+	const BAMeshSize *cellSizes;
+	const BAMeshCellAlignment *cellAlignments; // could be NULL, then alignment is used for all cells
+	BAMeshCellAlignment alignment;
+	BAMeshRowLayout rowLayout;
+	BAMeshInsets rowsInsets;
+	BAMeshFloat headerHeight;
+	BAMeshFloat footerHeight;
+	// output
+	BAMeshRect *cellFrames;
+	long numberOfRows;
+	long *rowFirstCells;
+	BAMeshFloat *rowTops;
+	BAMeshFloat *rowBottoms;
+	BAMeshFloat totalHeight; // includes header, insets and footer
+	BAMeshFloat y; // set by BAMeshLayoutSections
+} BAMeshSectionLayout;
+
+// Lays out rows starting from the row; rows above it are kept as they are. Pass 0 to lay out
+// the whole section.
+void BAMeshLayoutSectionFromRow(BAMeshSectionLayout *layout, BAMeshFloat width, long firstRow);
+void BAMeshLayoutSection(BAMeshSectionLayout *layout, BAMeshFloat width);
+// Row from which layout should be updated when cells from the cell on are changed. The row
+// before changed cells is included because it could take cells from the next one.
+long BAMeshLayoutRowForChangedCell(const BAMeshSectionLayout *layout, long cell);
+// Lays out all sections and sets their offsets; returns total height of sections.
+BAMeshFloat BAMeshLayoutSections(BAMeshSectionLayout *sections, long numberOfSections, BAMeshFloat width, BAMeshFloat top);
+
+// Queries over laid out section; y coordinates are relative to the mesh.
+void BAMeshLayoutRowsInRange(const BAMeshSectionLayout *layout, BAMeshFloat minY, BAMeshFloat maxY, long *firstRow, long *rowsCount);
+void BAMeshLayoutCellsInRows(const BAMeshSectionLayout *layout, long firstRow, long rowsCount, long *firstCell, long *cellsCount);
+long BAMeshLayoutCellAtPoint(const BAMeshSectionLayout *layout, BAMeshFloat x, BAMeshFloat y); // -1 if none
+
+#endif
@@ -28,6 +28,8 @@
 
 #import <UIKit/UIKit.h>
 #import "BAMeshViewCell.h"
+#import "BAMeshLayout.h"
+#import "BAViewsCache.h"
 
 
 // Support column in index paths
@@ -56,41 +58,29 @@
 
 - (NSInteger)numberOfSectionsInMeshView:(BAMeshView *)meshView; // Default is 1 if not implemented
 
+// Prefetching
+// 
+// Cells which are about to come into view within prefetch distance in the direction of scrolling
+// are reported in advance so data source could warm caches and start loading images for them.
+// When index paths leave the prefetch window before being displayed prefetching is cancelled.
+// Index paths which come into view are not cancelled. All prefetching is cancelled on reload.
+
+- (void)meshView:(BAMeshView *)meshView prefetchCellsAtIndexPaths:(NSArray *)indexPaths;
+- (void)meshView:(BAMeshView *)meshView cancelPrefetchingCellsAtIndexPaths:(NSArray *)indexPaths;
+
+// Render models
+// 
+// When implemented render models of prefetched cells are prepared on a background queue and set
+// to cells returned by meshView:cellAtIndexPath: as they come into view. Models of cells which were
+// not prefetched are prepared on the main thread. Should be thread safe and return immutable objects.
+
+- (id)meshView:(BAMeshView *)meshView renderModelForCellAtIndexPath:(NSIndexPath *)indexPath;
+
 @end
 
 #pragma mark -
 #pragma mark delagate
 
-// Note about spread logic:
-// 
-// By default all cells in a row are distributed evenly along the row. But the last row could be treated
-// differently because it could contain fewer cells and (especially for meshes with a fixed cell size)
-// it makes sense to use the same horizontal spacing as for the rows above.
-// 
-// So layouts BAMeshRowLayoutSpread[Center|Left|Right] treat the last row in a special way: first average
-// cell width for the last row is calculated. Then we calculate how many average cells would fit in the row.
-// Next based on this estimate we calculate horizontal spacing which is used to separate the existing cells.
-// This should give us better layout for the last row and if all cells have a fixed size then horizontal
-// spacing will be exactly the same for all rows.
-
-typedef enum {
-	BAMeshRowLayoutSpread = 0, // default; distribute cells evenly in rows
-	BAMeshRowLayoutSpreadCenter, // spread with the last row centered
-	BAMeshRowLayoutSpreadLeft, // spread with the last row aligned to the left side
-	BAMeshRowLayoutSpreadRight, // spread with the last row aligned to the right side
-	BAMeshRowLayoutCenter, // all cells are packed and centered within row
-	BAMeshRowLayoutLeft, // all cells are packed at the left side
-	BAMeshRowLayoutRight, // all cells are packed at the right side
-	BAMeshRowLayoutFill // all cells are made equal width to cover the whole row
-} BAMeshRowLayout;
-
-typedef enum {
-	BAMeshCellAlignmentCenter = 0, // default; cell is centered vertically within row
-	BAMeshCellAlignmentTop, // cell is at row's top
-	BAMeshCellAlignmentBottom, // cell is at row's bottom
-	BAMeshCellAlignmentFill // cell height is made equal to the row height
-} BAMeshCellAlignment;
-
 @protocol BAMeshViewDelegate <NSObject, UIScrollViewDelegate>
 
 @optional
@@ -101,6 +91,16 @@ typedef enum {
 - (BAMeshRowLayout)meshView:(BAMeshView *)meshView rowsLayoutInSection:(NSInteger)section;
 - (BAMeshCellAlignment)meshView:(BAMeshView *)meshView alignmentForCellAtIndexPath:(NSIndexPath *)indexPath;
 
+// Bulk layout queries
+// 
+// Layout of large sections avoids a call and an index path per cell when these are implemented.
+// When all cells of a section share size and alignment return YES from the first method, otherwise
+// the second one is called with arrays of range.length elements prefilled with default values.
+// Both take precedence over per cell methods above.
+
+- (BOOL)meshView:(BAMeshView *)meshView getUniformSize:(CGSize *)size alignment:(BAMeshCellAlignment *)alignment ofCellsInSection:(NSInteger)section;
+- (void)meshView:(BAMeshView *)meshView getSizes:(CGSize *)sizes alignments:(BAMeshCellAlignment *)alignments ofCellsInRange:(NSRange)range inSection:(NSInteger)section;
+
 // Headers & Footers
 
 - (CGFloat)meshView:(BAMeshView *)meshView heightForHeaderInSection:(NSInteger)section;
@@ -133,10 +133,22 @@ typedef enum {
 @property(nonatomic) CGFloat sectionFooterHeight;    // will return the default value (0) if unset
 @property(nonatomic, retain) UIView *meshHeaderView; // accessory view for above row content. default is nil. not to be confused with section header
 @property(nonatomic, retain) UIView *meshFooterView; // accessory view below content. default is nil. not to be confused with section footer
+@property(nonatomic) CGFloat prefetchDistance;       // in screens ahead of visible content. default is 1, 0 disables prefetching
+@property(nonatomic) BOOL concurrentLayout;          // pack rows of sections concurrently. sizes are still queried on the main thread. default is NO
 
 // Data
+// 
+// Layout is cached between passes, cell sizes are cached until cells are reloaded and when width
+// changes only rows are packed again. Updates relayout only rows from the first changed cell in
+// changed sections and move sections below. Data source should be updated before calling them.
 
 - (void)reloadData;
+- (void)insertSections:(NSIndexSet *)sections;
+- (void)deleteSections:(NSIndexSet *)sections;
+- (void)reloadSections:(NSIndexSet *)sections;
+- (void)insertCellsAtIndexPaths:(NSArray *)indexPaths; // index paths after update
+- (void)deleteCellsAtIndexPaths:(NSArray *)indexPaths; // index paths before update
+- (void)reloadCellsAtIndexPaths:(NSArray *)indexPaths;
 
 // Info
 
@@ -168,4 +180,8 @@ typedef enum {
 
 - (id)dequeueReusableCellWithIdentifier:(NSString *)identifier;  // Used by the delegate to acquire an already allocated cell, in lieu of allocating a new one.
 
+// Reusable cells are kept by identifier, up to 50 of each by default. The cache could be used
+// to change capacity for an identifier, prewarm cells before the first scroll and read hit rate.
+@property(nonatomic, readonly) BAViewsCache *reusableCellsCache;
+
 @end
@@ -29,9 +29,20 @@
 #import "BAMeshView.h"
 #import "BAScrollViewProxyDelegate.h"
 #import "BAMeshViewCell+Owner.h"
+#import "BARenderModelQueue.h"
 
-// assume slightly over 2 * 1024 / 44 which is two rows
+// assume slightly over 2 * 1024 / 44 which is two rows of cells of one type
 #define kMaxReusableCellsCount 50
+#define kDefaultPrefetchDistance 1
+// packing fewer cells is faster than dispatching them to other threads
+#define kMinConcurrentLayoutCellsCount 2000
+
+// Setting frame is not free even if it does not change
+static inline void BAMeshSetViewFrame(UIView *view, CGRect frame) {
+	if (!CGRectEqualToRect(view.frame, frame)) {
+		view.frame = frame;
+	}
+}
 
 @implementation NSIndexPath (BAMeshView)
 
@@ -52,77 +63,280 @@
 
 
 // Layout data for a section
+// 
+// Wraps section layout of the layout engine and owns its arrays. Frames and rows are kept
+// relative to the top of the section, so moving section is just a change of its y. Cell sizes
+// and alignments are cached and rows from the first invalid cell are laid out again.
 
 @interface BAMeshSectionData : NSObject
 
 @property CGFloat y;
 @property CGFloat headerHeight;
 @property CGFloat footerHeight;
-@property CGFloat totalHeight;
+@property UIEdgeInsets rowsInsets;
+@property BAMeshRowLayout rowLayout;
+@property(readonly) CGFloat totalHeight;
 @property NSInteger numberOfCells;
+@property(readonly) NSInteger numberOfRows;
+@property BOOL needsAttributes; // header, footer, insets and row layout should be queried
+@property(readonly) NSInteger firstInvalidCell; // NSNotFound when layout is valid
 
 - (CGRect)cellFrame:(NSInteger)cell;
-- (void)setFrame:(CGRect)frame forCell:(NSInteger)cell;
 - (NSInteger)cellAtPoint:(CGPoint)p;
 
+// Layout
+- (BOOL)hasSizeForCell:(NSInteger)cell;
+- (NSRange)cellsWithUnknownSizesFromCell:(NSInteger)cell; // first run of them
+- (void)setSize:(CGSize)size alignment:(BAMeshCellAlignment)alignment forCell:(NSInteger)cell;
+- (void)setSize:(CGSize)size alignment:(BAMeshCellAlignment)alignment forCells:(NSRange)cells;
+- (void)setSizes:(const CGSize *)sizes alignments:(const BAMeshCellAlignment *)alignments forCells:(NSRange)cells;
+- (void)invalidateLayoutFromCell:(NSInteger)cell;
+- (void)invalidateSizeForCell:(NSInteger)cell;
+- (void)insertCells:(NSRange)cells; // with unknown sizes
+- (void)removeCell:(NSInteger)cell;
+- (void)layoutWithWidth:(CGFloat)width; // all sizes from the first invalid cell should be known
+
+// Rows make a spatial index of cells
+- (NSRange)rowsFromY:(CGFloat)minY toY:(CGFloat)maxY;
+- (NSRange)cellsInRows:(NSRange)rows;
+- (NSRange)cellsInRect:(CGRect)rect; // cells of rows intersecting the rect, not all of them intersect it
+
 @end
 
 @implementation BAMeshSectionData {
 @private
-	NSInteger _numberOfCells;
-	CGRect *_cellFrames;
+	BAMeshSectionLayout _layout;
+	NSInteger _capacity;
+	BAMeshSize *_cellSizes;
+	BAMeshCellAlignment *_cellAlignments;
+	NSInteger _firstInvalidCell;
+	BOOL _needsAttributes;
 }
 
-@synthesize y = _y;
-@synthesize headerHeight = _headerHeight;
-@synthesize footerHeight = _footerHeight;
-@synthesize totalHeight = _totalHeight;
+@synthesize needsAttributes = _needsAttributes;
+@synthesize firstInvalidCell = _firstInvalidCell;
+
+- (id)init {
+	if ((self = [super init])) {
+		_firstInvalidCell = 0;
+		_needsAttributes = YES;
+	}
+	return self;
+}
 
 - (void)dealloc {
-	free(_cellFrames);
+	free(_cellSizes);
+	free(_cellAlignments);
+	free(_layout.cellFrames);
+	free(_layout.rowFirstCells);
+	free(_layout.rowTops);
+	free(_layout.rowBottoms);
     [super dealloc];
 }
 
+- (void)reserveCapacity:(NSInteger)capacity {
+	if (capacity <= _capacity) {
+		return;
+	}
+	capacity = MAX(capacity, _capacity * 2);
+	_cellSizes = realloc(_cellSizes, capacity * sizeof(BAMeshSize));
+	_cellAlignments = realloc(_cellAlignments, capacity * sizeof(BAMeshCellAlignment));
+	_layout.cellSizes = _cellSizes;
+	_layout.cellAlignments = _cellAlignments;
+	_layout.cellFrames = realloc(_layout.cellFrames, capacity * sizeof(BAMeshRect));
+	// there is at least one cell in a row
+	_layout.rowFirstCells = realloc(_layout.rowFirstCells, capacity * sizeof(long));
+	_layout.rowTops = realloc(_layout.rowTops, capacity * sizeof(BAMeshFloat));
+	_layout.rowBottoms = realloc(_layout.rowBottoms, capacity * sizeof(BAMeshFloat));
+	_capacity = capacity;
+}
+
+- (CGFloat)y {
+	return _layout.y;
+}
+
+- (void)setY:(CGFloat)y {
+	_layout.y = y;
+}
+
+- (CGFloat)headerHeight {
+	return _layout.headerHeight;
+}
+
+- (void)setHeaderHeight:(CGFloat)headerHeight {
+	_layout.headerHeight = headerHeight;
+}
+
+- (CGFloat)footerHeight {
+	return _layout.footerHeight;
+}
+
+- (void)setFooterHeight:(CGFloat)footerHeight {
+	_layout.footerHeight = footerHeight;
+}
+
+- (UIEdgeInsets)rowsInsets {
+	return UIEdgeInsetsMake(_layout.rowsInsets.top, _layout.rowsInsets.left, _layout.rowsInsets.bottom, _layout.rowsInsets.right);
+}
+
+- (void)setRowsInsets:(UIEdgeInsets)rowsInsets {
+	_layout.rowsInsets = (BAMeshInsets){ rowsInsets.top, rowsInsets.left, rowsInsets.bottom, rowsInsets.right };
+}
+
+- (BAMeshRowLayout)rowLayout {
+	return _layout.rowLayout;
+}
+
+- (void)setRowLayout:(BAMeshRowLayout)rowLayout {
+	_layout.rowLayout = rowLayout;
+}
+
+- (CGFloat)totalHeight {
+	return _layout.totalHeight;
+}
+
 - (NSInteger)numberOfCells {
-	return _numberOfCells;
+	return _layout.numberOfCells;
 }
 
 - (void)setNumberOfCells:(NSInteger)numberOfCells {
-	if (_numberOfCells == numberOfCells) {
+	if (_layout.numberOfCells == numberOfCells) {
 		return;
 	}
-	_numberOfCells = numberOfCells;
-	free(_cellFrames);
-	if (numberOfCells > 0) {
-		_cellFrames = calloc(numberOfCells, sizeof(CGRect));
+	if (numberOfCells > _layout.numberOfCells) {
+		[self insertCells:NSMakeRange(_layout.numberOfCells, numberOfCells - _layout.numberOfCells)];
 	} else {
-		_cellFrames = NULL;
+		_layout.numberOfCells = MAX(numberOfCells, 0);
+		[self invalidateLayoutFromCell:_layout.numberOfCells];
 	}
 }
 
+- (NSInteger)numberOfRows {
+	return _layout.numberOfRows;
+}
+
 - (CGRect)cellFrame:(NSInteger)cell {
-	if (cell < 0 || cell >= _numberOfCells) {
+	if (cell < 0 || cell >= _layout.numberOfCells) {
 		return CGRectZero;
 	}
-	return _cellFrames[cell];
+	const BAMeshRect frame = _layout.cellFrames[cell];
+	return CGRectMake(frame.x, frame.y + _layout.y, frame.width, frame.height);
 }
 
-- (void)setFrame:(CGRect)frame forCell:(NSInteger)cell {
-	if (cell < 0 || cell >= _numberOfCells) {
+- (NSInteger)cellAtPoint:(CGPoint)p {
+	return BAMeshLayoutCellAtPoint(&_layout, p.x, p.y);
+}
+
+- (BOOL)hasSizeForCell:(NSInteger)cell {
+	return cell >= 0 && cell < _layout.numberOfCells && _cellSizes[cell].width >= 0;
+}
+
+- (NSRange)cellsWithUnknownSizesFromCell:(NSInteger)cell {
+	const NSInteger numberOfCells = _layout.numberOfCells;
+	NSInteger first = MAX(cell, 0);
+	while (first < numberOfCells && _cellSizes[first].width >= 0) {
+		first++;
+	}
+	NSInteger last = first;
+	while (last < numberOfCells && _cellSizes[last].width < 0) {
+		last++;
+	}
+	return NSMakeRange(first, last - first);
+}
+
+- (void)setSize:(CGSize)size alignment:(BAMeshCellAlignment)alignment forCell:(NSInteger)cell {
+	if (cell < 0 || cell >= _layout.numberOfCells) {
 		return;
 	}
-	_cellFrames[cell] = frame;
+	_cellSizes[cell] = (BAMeshSize){ size.width, size.height };
+	_cellAlignments[cell] = alignment;
 }
 
-- (NSInteger)cellAtPoint:(CGPoint)p {
-	// TODO: binary search
-	for (NSInteger cell = 0; cell < self.numberOfCells; cell++) {
-		CGRect frame = _cellFrames[cell];
-		if (CGRectContainsPoint(frame, p)) {
-			return cell;
-		}
+- (void)setSize:(CGSize)size alignment:(BAMeshCellAlignment)alignment forCells:(NSRange)cells {
+	const NSInteger end = MIN(NSMaxRange(cells), _layout.numberOfCells);
+	const BAMeshSize cellSize = { size.width, size.height };
+	for (NSInteger cell = cells.location; cell < end; cell++) {
+		_cellSizes[cell] = cellSize;
+		_cellAlignments[cell] = alignment;
+	}
+}
+
+- (void)setSizes:(const CGSize *)sizes alignments:(const BAMeshCellAlignment *)alignments forCells:(NSRange)cells {
+	const NSInteger end = MIN(NSMaxRange(cells), _layout.numberOfCells);
+	for (NSInteger cell = cells.location; cell < end; cell++) {
+		const CGSize size = sizes[cell - cells.location];
+		_cellSizes[cell] = (BAMeshSize){ size.width, size.height };
+	}
+	if (end > cells.location) {
+		memcpy(_cellAlignments + cells.location, alignments, (end - cells.location) * sizeof(BAMeshCellAlignment));
+	}
+}
+
+- (void)invalidateLayoutFromCell:(NSInteger)cell {
+	if (_firstInvalidCell == NSNotFound || cell < _firstInvalidCell) {
+		_firstInvalidCell = MAX(cell, 0);
 	}
-	return -1;
+}
+
+- (void)invalidateSizeForCell:(NSInteger)cell {
+	if (cell < 0 || cell >= _layout.numberOfCells) {
+		return;
+	}
+	_cellSizes[cell].width = -1; // unknown
+	[self invalidateLayoutFromCell:cell];
+}
+
+- (void)insertCells:(NSRange)cells {
+	const NSInteger numberOfCells = _layout.numberOfCells;
+	if (cells.location > numberOfCells || cells.length == 0) {
+		return;
+	}
+	[self reserveCapacity:numberOfCells + cells.length];
+	const NSInteger tailCount = numberOfCells - cells.location;
+	memmove(_cellSizes + cells.location + cells.length, _cellSizes + cells.location, tailCount * sizeof(BAMeshSize));
+	memmove(_cellAlignments + cells.location + cells.length, _cellAlignments + cells.location, tailCount * sizeof(BAMeshCellAlignment));
+	for (NSInteger cell = cells.location; cell < cells.location + cells.length; cell++) {
+		_cellSizes[cell] = (BAMeshSize){ -1, -1 }; // unknown
+	}
+	_layout.numberOfCells += cells.length;
+	[self invalidateLayoutFromCell:cells.location];
+}
+
+- (void)removeCell:(NSInteger)cell {
+	if (cell < 0 || cell >= _layout.numberOfCells) {
+		return;
+	}
+	const NSInteger tailCount = _layout.numberOfCells - cell - 1;
+	memmove(_cellSizes + cell, _cellSizes + cell + 1, tailCount * sizeof(BAMeshSize));
+	memmove(_cellAlignments + cell, _cellAlignments + cell + 1, tailCount * sizeof(BAMeshCellAlignment));
+	_layout.numberOfCells--;
+	[self invalidateLayoutFromCell:cell];
+}
+
+- (void)layoutWithWidth:(CGFloat)width {
+	if (_firstInvalidCell == NSNotFound) {
+		return;
+	}
+	BAMeshLayoutSectionFromRow(&_layout, width, BAMeshLayoutRowForChangedCell(&_layout, _firstInvalidCell));
+	_firstInvalidCell = NSNotFound;
+}
+
+- (NSRange)rowsFromY:(CGFloat)minY toY:(CGFloat)maxY {
+	long firstRow;
+	long rowsCount;
+	BAMeshLayoutRowsInRange(&_layout, minY, maxY, &firstRow, &rowsCount);
+	return NSMakeRange(firstRow, rowsCount);
+}
+
+- (NSRange)cellsInRows:(NSRange)rows {
+	long firstCell;
+	long cellsCount;
+	BAMeshLayoutCellsInRows(&_layout, rows.location, rows.length, &firstCell, &cellsCount);
+	return NSMakeRange(firstCell, cellsCount);
+}
+
+- (NSRange)cellsInRect:(CGRect)rect {
+	return [self cellsInRows:[self rowsFromY:CGRectGetMinY(rect) toY:CGRectGetMaxY(rect)]];
 }
 
 - (NSString *)description {
@@ -148,10 +362,12 @@
 @property(assign) BOOL hasFooter;
 @property(retain) UIView *footerView;
 @property(assign) NSInteger numberOfCells;
+@property(assign) NSRange visibleCells; // all cells with views are in this range
 
 - (BAMeshViewCell *)cellView:(NSInteger)cell;
 - (void)setView:(BAMeshViewCell *)view forCell:(NSInteger)cell;
-- (void)removeViewsWithReusableCells:(NSMutableArray *)reusableCells;
+- (void)setFrame:(CGRect)frame ofCell:(NSInteger)cell; // view frame is set only if changed
+- (void)removeViewsWithReusableCells:(BAViewsCache *)reusableCells;
 
 @end
 
@@ -159,12 +375,14 @@
 @private
 	NSInteger _numberOfCells;
 	BAMeshViewCell **_cellViews;
+	CGRect *_cellFrames; // last frames set to views
 }
 
 @synthesize hasHeader = _hasHeader;
 @synthesize headerView = _headerView;
 @synthesize hasFooter = _hasFooter;
 @synthesize footerView = _footerView;
+@synthesize visibleCells = _visibleCells;
 
 - (void)freeCells {
 	if (!_cellViews) {
@@ -176,11 +394,14 @@
 	}
 	free(_cellViews);
 	_cellViews = NULL;
+	free(_cellFrames);
+	_cellFrames = NULL;
 }
 
 - (void)dealloc {
 	[self removeViewsWithReusableCells:nil];
 	free(_cellViews);
+	free(_cellFrames);
     [super dealloc];
 }
 
@@ -194,8 +415,10 @@
 	}
 	[self freeCells];
 	_numberOfCells = numberOfCells;
+	_visibleCells = NSMakeRange(0, 0);
 	if (numberOfCells > 0) {
 		_cellViews = calloc(numberOfCells, sizeof(BAMeshViewCell *));
+		_cellFrames = malloc(numberOfCells * sizeof(CGRect));
 	}
 }
 
@@ -216,9 +439,18 @@
 	[_cellViews[cell] removeFromSuperview];
 	[_cellViews[cell] release];
 	_cellViews[cell] = [view retain];
+	_cellFrames[cell] = CGRectNull;
+}
+
+- (void)setFrame:(CGRect)frame ofCell:(NSInteger)cell {
+	if (cell < 0 || cell >= _numberOfCells || CGRectEqualToRect(_cellFrames[cell], frame)) {
+		return;
+	}
+	_cellFrames[cell] = frame;
+	_cellViews[cell].frame = frame;
 }
 
-- (void)removeViewsWithReusableCells:(NSMutableArray *)reusableCells {
+- (void)removeViewsWithReusableCells:(BAViewsCache *)reusableCells {
 	if (self.headerView) {
 		[self.headerView removeFromSuperview];
 		self.headerView = nil;
@@ -231,7 +463,7 @@
 		[cellView removeFromSuperview];
 		if (cellView.reuseIdentifier) {
 			[cellView prepareForReuse];
-			[reusableCells addObject:cellView];
+			[reusableCells enqueueReusableView:cellView withIdentifier:cellView.reuseIdentifier];
 		}
 		[cellView release];
 		_cellViews[cell] = nil;
@@ -240,6 +472,7 @@
 		[self.footerView removeFromSuperview];
 		self.footerView = nil;
 	}
+	_visibleCells = NSMakeRange(0, 0);
 }
 
 - (NSString *)description {
@@ -279,15 +512,34 @@
 @end
 
 
-@interface BAMeshView ()
+// Delegate of the tap recognizer, so recognizers of the scroll view keep their own delegate
+@interface BAMeshViewTapDelegate : NSObject <UIGestureRecognizerDelegate>
+
+@property(assign) BAMeshView *meshView;
+
+@end
+
+
+@interface BAMeshView () <BARenderModelQueueDelegate>
 
-- (CGSize)sizeForCell:(NSInteger)cell inSection:(NSInteger)section;
 - (BAMeshRowLayout)rowsLayoutInSection:(NSInteger)section;
-- (BAMeshCellAlignment)alignmentForCellAtIndexPath:(NSIndexPath *)indexPath;
 - (CGFloat)heightForHeaderInSection:(NSInteger)section;
 - (CGFloat)heightForFooterInSection:(NSInteger)section;
 - (void)meshDidScroll;
 - (void)handleTapOnCell:(UIGestureRecognizer *)recognizer;
+- (BAMeshViewCell *)cellViewAtPoint:(CGPoint)point;
+- (BOOL)tapShouldReceiveTouch:(UITouch *)touch;
+
+@end
+
+
+@implementation BAMeshViewTapDelegate
+
+@synthesize meshView = _meshView;
+
+- (BOOL)gestureRecognizer:(UIGestureRecognizer *)gestureRecognizer shouldReceiveTouch:(UITouch *)touch {
+	return [_meshView tapShouldReceiveTouch:touch];
+}
 
 @end
 
@@ -300,14 +552,30 @@
 	CGFloat _meshFooterHeight;
 	NSMutableArray *_sectionData; // all data for layout
 	NSMutableArray *_sectionViews; // description of currently added views
-	NSMutableArray *_reusableCells;
+	BAViewsCache *_reusableCells;
 	UIView *_meshHeaderView;
 	UIView *_meshFooterView;
+	CGFloat _prefetchDistance;
+	BOOL _concurrentLayout;
+	NSMutableSet *_prefetchedIndexPaths; // prefetched but not displayed yet
+	CGRect _prefetchRect;
+	CGFloat _lastContentOffsetY;
+	BOOL _scrollsUp;
+	NSRange _visibleSections; // sections which have views
+	UITapGestureRecognizer *_tapRecognizer; // shared by all cells
+	BAMeshViewTapDelegate *_tapDelegate;
+	BARenderModelQueue *_renderModels; // keyed by NSIndexPath
+	BOOL _needsLayoutUpdate;
+	CGFloat _layoutWidth;
+	CGFloat *_sectionOffsets; // tops of sections followed by bottom of the last one
+	NSInteger _sectionOffsetsCapacity;
 }
 
 @synthesize cellSize = _cellSize;
 @synthesize sectionHeaderHeight = _sectionHeaderHeight;
 @synthesize sectionFooterHeight = _sectionFooterHeight;
+@synthesize prefetchDistance = _prefetchDistance;
+@synthesize concurrentLayout = _concurrentLayout;
 
 - (void)dealloc {
 	[_proxyDelegate release];
@@ -317,11 +585,22 @@
 	[_reusableCells release];
 	[_meshHeaderView release];
 	[_meshFooterView release];
+	[_prefetchedIndexPaths release];
+	_tapRecognizer.delegate = nil;
+	[_tapRecognizer release];
+	_tapDelegate.meshView = nil;
+	[_tapDelegate release];
+	[_renderModels cancelAllRenderModels];
+	_renderModels.delegate = nil;
+	[_renderModels release];
+	free(_sectionOffsets);
     [super dealloc];
 }
 
 - (void)setupMeshView {
 	self.cellSize = CGSizeMake(44, 44);
+	self.prefetchDistance = kDefaultPrefetchDistance;
+	_prefetchRect = CGRectNull;
 //	self.sectionHeaderHeight = 22;
 //	self.sectionFooterHeight = 22;
 	[_proxyDelegate release];
@@ -329,6 +608,13 @@
 	_proxyDelegate.didScrollTarget = self;
 	_proxyDelegate.didScrollAction = @selector(meshDidScroll);
 	[super setDelegate:_proxyDelegate];
+	if (!_tapRecognizer) {
+		_tapDelegate = [[BAMeshViewTapDelegate alloc] init];
+		_tapDelegate.meshView = self;
+		_tapRecognizer = [[UITapGestureRecognizer alloc] initWithTarget:self action:@selector(handleTapOnCell:)];
+		_tapRecognizer.delegate = _tapDelegate;
+		[self addGestureRecognizer:_tapRecognizer];
+	}
 }
 
 - (id)initWithCoder:(NSCoder *)decoder {
@@ -353,6 +639,7 @@
 	if (_dataSource == dataSource) {
 		return;
 	}
+	[self cancelPrefetching];
 	_dataSource = dataSource;
 	[_sectionData release];
 	_sectionData = nil;
@@ -378,6 +665,7 @@
 }
 
 - (void)reloadData {
+	[self cancelPrefetching];
 	[_sectionData release];
 	_sectionData = nil;
 	[_sectionViews release];
@@ -385,133 +673,301 @@
 	[self setNeedsLayout];
 }
 
-- (NSMutableArray *)reusableCells {
-	if (!_reusableCells) {
-		_reusableCells = [[NSMutableArray alloc] init];
+// Incremental updates
+
+- (void)checkNumberOfSections {
+	if ([_sectionData count] != [self numberOfSections] || (_sectionViews && [_sectionViews count] != [self numberOfSections])) {
+		[NSException raise:@"BAMeshViewError" format:@"Number of sections does not match update"];
 	}
-	return _reusableCells;
 }
 
-- (void)compactReusableCells {
-	const int extraCellsCount = [[self reusableCells] count] - kMaxReusableCellsCount;
-	if (extraCellsCount > 0) {
-		[[self reusableCells] removeObjectsInRange:NSMakeRange(0, extraCellsCount)];
+- (void)checkNumberOfCellsInSection:(NSInteger)section {
+	BAMeshSectionData *sectionData = [_sectionData objectAtIndex:section];
+	if (sectionData.numberOfCells != [self numberOfCellsInSection:section]) {
+		[NSException raise:@"BAMeshViewError" format:@"Number of cells in section %d does not match update", section];
 	}
 }
 
-- (id)dequeueReusableCellWithIdentifier:(NSString *)identifier {
-	if (!identifier) {
-		return nil;
+// Cells keep index paths, so views of sections which change their indexes are removed and created again
+- (void)removeViewsOfSectionsFrom:(NSInteger)firstSection {
+	const NSInteger endSection = _visibleSections.location + _visibleSections.length;
+	for (NSInteger section = MAX(firstSection, _visibleSections.location); section < endSection; section++) {
+		BAMeshSectionViews *sectionViews = [_sectionViews objectAtIndex:section];
+		[sectionViews removeViewsWithReusableCells:[self reusableCells]];
 	}
-	for (NSInteger i = 0; i < [[self reusableCells] count]; i++) {
-		BAMeshViewCell *cell = [[self reusableCells] objectAtIndex:i];
-		if ([[cell reuseIdentifier] isEqualToString:identifier]) {
-			[[cell retain] autorelease];
-			[[self reusableCells] removeObjectAtIndex:i];
-			return cell;
+	if (firstSection < endSection) {
+		_visibleSections.length = MAX(firstSection - (NSInteger)_visibleSections.location, 0);
+	}
+}
+
+- (void)removeViewsOfSection:(NSInteger)section {
+	if (!NSLocationInRange(section, _visibleSections)) {
+		return;
+	}
+	BAMeshSectionViews *sectionViews = [_sectionViews objectAtIndex:section];
+	[sectionViews removeViewsWithReusableCells:[self reusableCells]];
+	sectionViews.hasHeader = YES;
+	sectionViews.hasFooter = YES;
+}
+
+- (void)setNeedsLayoutUpdate {
+	[self cancelPrefetching]; // index paths could change
+	_needsLayoutUpdate = YES;
+	[self setNeedsLayout];
+}
+
+- (void)insertSections:(NSIndexSet *)sections {
+	if (!_sectionData || [sections count] == 0) {
+		return;
+	}
+	[self removeViewsOfSectionsFrom:[sections firstIndex]];
+	[sections enumerateIndexesUsingBlock:^(NSUInteger section, BOOL *stop) {
+		[_sectionData insertObject:[self createSectionData:section] atIndex:section];
+		[_sectionViews insertObject:[self createSectionViews:section] atIndex:section];
+	}];
+	[self checkNumberOfSections];
+	[self setNeedsLayoutUpdate];
+}
+
+- (void)deleteSections:(NSIndexSet *)sections {
+	if (!_sectionData || [sections count] == 0) {
+		return;
+	}
+	[self removeViewsOfSectionsFrom:[sections firstIndex]];
+	[_sectionData removeObjectsAtIndexes:sections];
+	[_sectionViews removeObjectsAtIndexes:sections];
+	[self checkNumberOfSections];
+	[self setNeedsLayoutUpdate];
+}
+
+- (void)reloadSections:(NSIndexSet *)sections {
+	if (!_sectionData || [sections count] == 0) {
+		return;
+	}
+	[sections enumerateIndexesUsingBlock:^(NSUInteger section, BOOL *stop) {
+		[self removeViewsOfSection:section];
+		[_sectionData replaceObjectAtIndex:section withObject:[self createSectionData:section]];
+		[_sectionViews replaceObjectAtIndex:section withObject:[self createSectionViews:section]];
+	}];
+	[self setNeedsLayoutUpdate];
+}
+
+- (NSArray *)sortedIndexPaths:(NSArray *)indexPaths ascending:(BOOL)ascending {
+	NSArray *sortedIndexPaths = [indexPaths sortedArrayUsingSelector:@selector(compare:)];
+	return ascending ? sortedIndexPaths : [[sortedIndexPaths reverseObjectEnumerator] allObjects];
+}
+
+// Section views are created again for new number of cells
+- (void)updateCellsInSections:(NSIndexSet *)sections {
+	[sections enumerateIndexesUsingBlock:^(NSUInteger section, BOOL *stop) {
+		[self removeViewsOfSection:section];
+		[self checkNumberOfCellsInSection:section];
+		[_sectionViews replaceObjectAtIndex:section withObject:[self createSectionViews:section]];
+	}];
+	[self setNeedsLayoutUpdate];
+}
+
+- (void)insertCellsAtIndexPaths:(NSArray *)indexPaths {
+	if (!_sectionData || [indexPaths count] == 0) {
+		return;
+	}
+	// index paths are in terms of the updated mesh
+	NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
+	for (NSIndexPath *indexPath in [self sortedIndexPaths:indexPaths ascending:YES]) {
+		BAMeshSectionData *sectionData = [_sectionData objectAtIndex:indexPath.meshSection];
+		[sectionData insertCells:NSMakeRange(indexPath.meshCell, 1)];
+		[sections addIndex:indexPath.meshSection];
+	}
+	[self updateCellsInSections:sections];
+}
+
+- (void)deleteCellsAtIndexPaths:(NSArray *)indexPaths {
+	if (!_sectionData || [indexPaths count] == 0) {
+		return;
+	}
+	// index paths are in terms of the mesh before update
+	NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
+	for (NSIndexPath *indexPath in [self sortedIndexPaths:indexPaths ascending:NO]) {
+		BAMeshSectionData *sectionData = [_sectionData objectAtIndex:indexPath.meshSection];
+		[sectionData removeCell:indexPath.meshCell];
+		[sections addIndex:indexPath.meshSection];
+	}
+	[self updateCellsInSections:sections];
+}
+
+- (void)reloadCellsAtIndexPaths:(NSArray *)indexPaths {
+	if (!_sectionData || [indexPaths count] == 0) {
+		return;
+	}
+	for (NSIndexPath *indexPath in indexPaths) {
+		BAMeshSectionData *sectionData = [_sectionData objectAtIndex:indexPath.meshSection];
+		[sectionData invalidateSizeForCell:indexPath.meshCell];
+		BAMeshSectionViews *sectionViews = [_sectionViews objectAtIndex:indexPath.meshSection];
+		BAMeshViewCell *cellView = [sectionViews cellView:indexPath.meshCell];
+		if (cellView) {
+			[cellView removeFromSuperview];
+			if (cellView.reuseIdentifier) {
+				[cellView prepareForReuse];
+				[[self reusableCells] enqueueReusableView:cellView withIdentifier:cellView.reuseIdentifier];
+			}
+			[sectionViews setView:nil forCell:indexPath.meshCell];
 		}
 	}
-	return nil;
+	[self setNeedsLayoutUpdate];
+}
+
+- (BAViewsCache *)reusableCells {
+	if (!_reusableCells) {
+		_reusableCells = [[BAViewsCache alloc] init];
+		_reusableCells.capacityPerType = kMaxReusableCellsCount;
+	}
+	return _reusableCells;
+}
+
+- (BAViewsCache *)reusableCellsCache {
+	return [self reusableCells];
+}
+
+- (id)dequeueReusableCellWithIdentifier:(NSString *)identifier {
+	return [[self reusableCells] dequeueReusableViewWithIdentifier:identifier];
 }
 
-- (CGFloat)extrapolatedSpreadForRow:(NSRange)cells ofSize:(CGSize)rowSize maxWidth:(CGFloat)maxWidth {
-	if (cells.length < 2 || rowSize.width == 0) {
+- (BAMeshSectionData *)createSectionData:(NSInteger)section {
+	BAMeshSectionData *sectionData = [[[BAMeshSectionData alloc] init] autorelease];
+	sectionData.numberOfCells = [self numberOfCellsInSection:section];
+	return sectionData;
+}
+
+// Queries attributes of the section and sizes and alignments of cells which are unknown.
+// Returns number of cells to lay out
+- (NSInteger)prepareLayoutOfSection:(NSInteger)section data:(BAMeshSectionData *)sectionData {
+	if (sectionData.needsAttributes) {
+		UIEdgeInsets rowsInsets = UIEdgeInsetsZero;
+		if ([self.delegate respondsToSelector:@selector(meshView:rowsInsetsInSection:)]) {
+			rowsInsets = [self.delegate meshView:self rowsInsetsInSection:section];
+		}
+		sectionData.rowsInsets = rowsInsets;
+		sectionData.rowLayout = [self rowsLayoutInSection:section];
+		sectionData.headerHeight = [self heightForHeaderInSection:section];
+		sectionData.footerHeight = [self heightForFooterInSection:section];
+		sectionData.needsAttributes = NO;
+		[sectionData invalidateLayoutFromCell:0];
+	}
+	if (sectionData.firstInvalidCell == NSNotFound) {
 		return 0;
 	}
-	const CGFloat avgCellWidth = rowSize.width / cells.length;
-	const int availableCellsCount = (maxWidth - rowSize.width) / avgCellWidth;
-	return (maxWidth - rowSize.width - avgCellWidth * availableCellsCount) / (cells.length + availableCellsCount - 1);
+	[self querySizesOfSection:section data:sectionData];
+	return MAX(sectionData.numberOfCells - sectionData.firstInvalidCell, 1);
 }
 
-- (void)layoutRow:(NSRange)cells
-		   ofSize:(CGSize)rowSize
-			 left:(CGFloat)left
-		 maxWidth:(CGFloat)maxWidth
-		inSection:(NSInteger)section
-			 data:(BAMeshSectionData *)sectionData
-{
+// Uniform and bulk queries are preferred, index paths are created only for per cell queries
+- (void)querySizesOfSection:(NSInteger)section data:(BAMeshSectionData *)sectionData {
+	NSRange cells = [sectionData cellsWithUnknownSizesFromCell:sectionData.firstInvalidCell];
 	if (cells.length == 0) {
 		return;
 	}
-	BAMeshRowLayout rowLayout = [self rowsLayoutInSection:section];
-	const BOOL lastRow = (sectionData.numberOfCells == cells.location + cells.length);
-	if (!lastRow && (rowLayout == BAMeshRowLayoutSpreadCenter ||
-					 rowLayout == BAMeshRowLayoutSpreadLeft ||
-					 rowLayout == BAMeshRowLayoutSpreadRight))
-	{
-		rowLayout = BAMeshRowLayoutSpread;
-	}
-	CGFloat d; // horizontal interval
-	CGFloat x;
-	CGFloat w = 0; // cell width for fill layout
-	switch (rowLayout) {
-		case BAMeshRowLayoutSpread:
-			if (cells.length > 1) {
-				d = (maxWidth - rowSize.width) / (cells.length - 1);
-			} else {
-				d = 0;
+	id<BAMeshViewDelegate> delegate = self.delegate;
+	const BOOL hasSizes = [delegate respondsToSelector:@selector(meshView:sizeForCellAtIndexPath:)];
+	const BOOL hasAlignments = [delegate respondsToSelector:@selector(meshView:alignmentForCellAtIndexPath:)];
+	const BOOL hasBulk = [delegate respondsToSelector:@selector(meshView:getSizes:alignments:ofCellsInRange:inSection:)];
+	const BOOL hasUniform = [delegate respondsToSelector:@selector(meshView:getUniformSize:alignment:ofCellsInSection:)];
+	const CGSize defaultSize = self.cellSize;
+	const BAMeshCellAlignment defaultAlignment = BAMeshCellAlignmentCenter;
+	CGSize uniformSize = defaultSize;
+	BAMeshCellAlignment uniformAlignment = defaultAlignment;
+	BOOL uniform = NO;
+	if (hasUniform) {
+		uniform = [delegate meshView:self getUniformSize:&uniformSize alignment:&uniformAlignment ofCellsInSection:section];
+		if (!uniform) {
+			// values written by the delegate before it declined are not used
+			uniformSize = defaultSize;
+			uniformAlignment = defaultAlignment;
+		}
+	}
+	if (!uniform && !hasSizes && !hasAlignments && !hasBulk) {
+		uniform = YES; // all cells get default size and alignment
+	}
+	CGSize *sizes = NULL;
+	BAMeshCellAlignment *alignments = NULL;
+	if (!uniform && hasBulk) {
+		const NSInteger capacity = sectionData.numberOfCells - cells.location;
+		sizes = malloc(capacity * sizeof(CGSize));
+		alignments = malloc(capacity * sizeof(BAMeshCellAlignment));
+	}
+	while (cells.length > 0) {
+		if (uniform) {
+			[sectionData setSize:uniformSize alignment:uniformAlignment forCells:cells];
+		} else if (hasBulk) {
+			for (NSUInteger i = 0; i < cells.length; i++) {
+				sizes[i] = defaultSize;
+				alignments[i] = defaultAlignment;
 			}
-			x = 0;
-			break;
-		case BAMeshRowLayoutSpreadCenter:
-			d = [self extrapolatedSpreadForRow:cells ofSize:rowSize maxWidth:maxWidth];
-			x = (maxWidth - rowSize.width) / 2;
-			break;
-		case BAMeshRowLayoutSpreadLeft:
-			d = [self extrapolatedSpreadForRow:cells ofSize:rowSize maxWidth:maxWidth];
-			x = 0;
-			break;
-		case BAMeshRowLayoutSpreadRight:
-			d = [self extrapolatedSpreadForRow:cells ofSize:rowSize maxWidth:maxWidth];
-			x = maxWidth - rowSize.width - d * (cells.length - 1);
-			break;
-		case BAMeshRowLayoutCenter:
-			d = 0;
-			x = (maxWidth - rowSize.width) / 2;
-			break;
-		case BAMeshRowLayoutLeft:
-			d = 0;
-			x = 0;
-			break;
-		case BAMeshRowLayoutRight:
-			d = 0;
-			x = maxWidth - rowSize.width;
-			break;
-		case BAMeshRowLayoutFill:
-			d = 0;
-			x = 0;
-			w = maxWidth / cells.length;
-			break;
-	}
-	x += left;
-	for (NSInteger cell = cells.location; cell < cells.location + cells.length; cell++) {
-		CGRect cellFrame = [sectionData cellFrame:cell];
-		cellFrame.origin.x = rint(x);
-		if (rowLayout == BAMeshRowLayoutFill) {
-			cellFrame.size.width = rint(w);
-			x += w + d;
+			[delegate meshView:self getSizes:sizes alignments:alignments ofCellsInRange:cells inSection:section];
+			[sectionData setSizes:sizes alignments:alignments forCells:cells];
 		} else {
-			x += cellFrame.size.width + d;
+			for (NSInteger cell = cells.location; cell < NSMaxRange(cells); cell++) {
+				NSIndexPath *indexPath = [NSIndexPath indexPathForCell:cell inSection:section];
+				[sectionData setSize:hasSizes ? [delegate meshView:self sizeForCellAtIndexPath:indexPath] : defaultSize
+						   alignment:hasAlignments ? [delegate meshView:self alignmentForCellAtIndexPath:indexPath] : defaultAlignment
+							 forCell:cell];
+			}
+		}
+		cells = [sectionData cellsWithUnknownSizesFromCell:NSMaxRange(cells)];
+	}
+	free(sizes);
+	free(alignments);
+}
+
+- (void)updateLayout {
+	_needsLayoutUpdate = NO;
+	const CGFloat maxWidth = self.bounds.size.width - (self.contentInset.left + self.contentInset.right);
+	if (maxWidth != _layoutWidth) {
+		// cell sizes do not depend on width, only rows are packed again
+		_layoutWidth = maxWidth;
+		for (BAMeshSectionData *sectionData in _sectionData) {
+			[sectionData invalidateLayoutFromCell:0];
 		}
-		BAMeshCellAlignment cellAlignment = [self alignmentForCellAtIndexPath:[NSIndexPath indexPathForCell:cell
-																								  inSection:section]];
-		// we assume here that cells are aligned at the top of the row
-		switch (cellAlignment) {
-			case BAMeshCellAlignmentTop:
-				// nothing to do
-				break;
-			case BAMeshCellAlignmentCenter:
-				cellFrame.origin.y += rint((rowSize.height - cellFrame.size.height) / 2);
-				break;
-			case BAMeshCellAlignmentBottom:
-				cellFrame.origin.y += rint(rowSize.height - cellFrame.size.height);
-				break;
-			case BAMeshCellAlignmentFill:
-				cellFrame.size.height = rowSize.height;
-				break;
+	}
+	// delegate is queried on the main thread
+	const NSInteger numberOfSections = [_sectionData count];
+	NSMutableArray *invalidSectionData = [NSMutableArray arrayWithCapacity:numberOfSections];
+	NSInteger invalidCellsCount = 0;
+	for (NSInteger section = 0; section < numberOfSections; section++) {
+		BAMeshSectionData *sectionData = [_sectionData objectAtIndex:section];
+		const NSInteger count = [self prepareLayoutOfSection:section data:sectionData];
+		if (count > 0) {
+			[invalidSectionData addObject:sectionData];
+			invalidCellsCount += count;
+		}
+	}
+	// rows of sections do not depend on each other, each section owns its layout arrays
+	const NSInteger invalidSectionsCount = [invalidSectionData count];
+	if (_concurrentLayout && invalidSectionsCount > 1 && invalidCellsCount >= kMinConcurrentLayoutCellsCount) {
+		dispatch_apply(invalidSectionsCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t i) {
+			[[invalidSectionData objectAtIndex:i] layoutWithWidth:maxWidth];
+		});
+	} else {
+		for (BAMeshSectionData *sectionData in invalidSectionData) {
+			[sectionData layoutWithWidth:maxWidth];
 		}
-		[sectionData setFrame:cellFrame forCell:cell];
 	}
+	// sections are moved by changing their offsets which is cheap
+	if (numberOfSections + 1 > _sectionOffsetsCapacity) {
+		_sectionOffsetsCapacity = MAX(numberOfSections + 1, _sectionOffsetsCapacity * 2);
+		_sectionOffsets = realloc(_sectionOffsets, _sectionOffsetsCapacity * sizeof(CGFloat));
+	}
+	CGFloat y = _meshHeaderHeight;
+	for (NSInteger section = 0; section < numberOfSections; section++) {
+		BAMeshSectionData *sectionData = [_sectionData objectAtIndex:section];
+		sectionData.y = y;
+		_sectionOffsets[section] = y;
+//		NSLog(@"%@", sectionData);
+		y += sectionData.totalHeight;
+	}
+	_sectionOffsets[numberOfSections] = y;
+	y += _meshFooterHeight;
+	self.contentSize = CGSizeMake(maxWidth, y);
+//	NSLog(@"Content Size %@", NSStringFromCGSize(self.contentSize));
 }
 
 - (NSMutableArray *)sectionData {
@@ -519,177 +975,331 @@
 //		NSLog(@"%s", __func__);
 		const NSInteger numberOfSections = [self numberOfSections];
 		_sectionData = [[NSMutableArray alloc] initWithCapacity:numberOfSections];
-		CGFloat y = _meshHeaderHeight;
-		const CGFloat maxWidth = self.bounds.size.width - (self.contentInset.left + self.contentInset.right);
 		for (NSInteger section = 0; section < numberOfSections; section++) {
-			UIEdgeInsets rowsInsets = UIEdgeInsetsZero;
-			if ([self.delegate respondsToSelector:@selector(meshView:rowsInsetsInSection:)]) {
-				rowsInsets = [self.delegate meshView:self rowsInsetsInSection:section];
-			}
-			BAMeshSectionData *sectionData = [[[BAMeshSectionData alloc] init] autorelease];
-			sectionData.y = y;
-			sectionData.headerHeight = [self heightForHeaderInSection:section];
-			sectionData.footerHeight = [self heightForFooterInSection:section];
-			sectionData.totalHeight = sectionData.headerHeight + rowsInsets.top + rowsInsets.bottom + sectionData.footerHeight;
-			sectionData.numberOfCells = [self numberOfCellsInSection:section];
-			y += sectionData.headerHeight + rowsInsets.top;
-			const CGFloat maxRowsWidth = maxWidth - (rowsInsets.left + rowsInsets.right);
-			CGFloat x = 0;
-			CGFloat rowHeight = 0;
-			NSInteger firstRowCell = 0;
-			for (NSInteger cell = firstRowCell; cell < sectionData.numberOfCells; cell++) {
-				const CGSize cellSize = [self sizeForCell:cell inSection:section];
-				if (cell > firstRowCell && (x + cellSize.width) > maxRowsWidth) {
-					[self layoutRow:NSMakeRange(firstRowCell, cell - firstRowCell)
-							 ofSize:CGSizeMake(x, rowHeight)
-							   left:rowsInsets.left
-						   maxWidth:maxRowsWidth
-						  inSection:section
-							   data:sectionData];
-					y += rowHeight;
-					sectionData.totalHeight += rowHeight;
-					x = 0;
-					rowHeight = 0;
-					firstRowCell = cell;
-				}
-				[sectionData setFrame:CGRectMake(x, y, cellSize.width, cellSize.height) forCell:cell];
-				x += cellSize.width;
-				rowHeight = MAX(rowHeight, cellSize.height);
-			}
-			y += rowHeight;
-			if (sectionData.numberOfCells > firstRowCell) {
-				[self layoutRow:NSMakeRange(firstRowCell, sectionData.numberOfCells - firstRowCell)
-						 ofSize:CGSizeMake(x, rowHeight)
-						   left:rowsInsets.left
-					   maxWidth:maxRowsWidth
-					  inSection:section
-						   data:sectionData];
-			}
-			sectionData.totalHeight += rowHeight;
-			[_sectionData addObject:sectionData];
-//			NSLog(@"%@", sectionData);
-			y += rowsInsets.bottom + sectionData.footerHeight;
+			[_sectionData addObject:[self createSectionData:section]];
 		}
-		y += _meshFooterHeight;
-		self.contentSize = CGSizeMake(maxWidth, y);
-//		NSLog(@"Content Size %@", NSStringFromCGSize(self.contentSize));
+		_needsLayoutUpdate = YES;
+	}
+	if (_needsLayoutUpdate) {
+		[self updateLayout];
 	}
 	return _sectionData;
 }
 
+- (BAMeshSectionViews *)createSectionViews:(NSInteger)section {
+	BAMeshSectionViews *sectionViews = [[[BAMeshSectionViews alloc] init] autorelease];
+	sectionViews.hasHeader = YES;
+	sectionViews.hasFooter = YES;
+	sectionViews.numberOfCells = [self numberOfCellsInSection:section];
+	return sectionViews;
+}
+
 - (NSMutableArray *)sectionViews {
 	if (!_sectionViews) {
 		const NSInteger numberOfSections = [self numberOfSections];
 		_sectionViews = [[NSMutableArray alloc] initWithCapacity:numberOfSections];
 		for (NSInteger section = 0; section < numberOfSections; section++) {
-			BAMeshSectionViews *sectionViews = [[[BAMeshSectionViews alloc] init] autorelease];
-			sectionViews.hasHeader = YES;
-			sectionViews.hasFooter = YES;
-			sectionViews.numberOfCells = [self numberOfCellsInSection:section];
-			[_sectionViews addObject:sectionViews];
+			[_sectionViews addObject:[self createSectionViews:section]];
 		}
+		_visibleSections = NSMakeRange(0, 0);
 	}
 	return _sectionViews;
 }
 
-- (void)updateVisibleCells {
-	[self sectionData]; // updates content size
-	const CGRect contentRect = CGRectMake(0, self.contentOffset.y,
-										  self.contentSize.width,
-										  MIN(self.contentSize.height, self.bounds.size.height));
-//	NSLog(@"Content Rect: %@", NSStringFromCGRect(contentRect));
-	const NSInteger numberOfSections = [self numberOfSections];
-	for (NSInteger section = 0; section < numberOfSections; section++) {
-		BAMeshSectionData *sectionData = [[self sectionData] objectAtIndex:section];
-		BAMeshSectionViews *sectionViews = [[self sectionViews] objectAtIndex:section];
-		const CGRect sectionRect = CGRectMake(0, sectionData.y, self.contentSize.width, sectionData.totalHeight);
-//		NSLog(@"Section Rect: %@", NSStringFromCGRect(sectionRect));
-		if (CGRectIntersectsRect(contentRect, sectionRect)) {
-			// section is (partially?) visible
-			if (sectionViews.hasHeader) {
-				CGRect headerRect = CGRectMake(0, sectionData.y, self.contentSize.width, sectionData.headerHeight);
-				if (CGRectIntersectsRect(contentRect, headerRect)) {
-					if (sectionViews.headerView) {
-						sectionViews.headerView.frame = headerRect;
-					} else {
-						if ([self.delegate respondsToSelector:@selector(meshView:viewForHeaderInSection:)]) {
-							sectionViews.headerView = [self.delegate meshView:self viewForHeaderInSection:section];
-						}
-						if (sectionViews.headerView) {
-							sectionViews.headerView.frame = headerRect;
-							[self insertSubview:sectionViews.headerView atIndex:0];
-						} else {
-							sectionViews.hasHeader = NO;
-						}
-					}
-				} else {
-					if (sectionViews.headerView) {
-						[sectionViews.headerView removeFromSuperview];
-						sectionViews.headerView = nil;
-					}
-				}
+- (NSRange)sectionsFromY:(CGFloat)minY toY:(CGFloat)maxY {
+	const NSInteger numberOfSections = [[self sectionData] count]; // updates offsets
+	const CGFloat *offsets = _sectionOffsets;
+	// first section which ends below min y
+	NSInteger low = 0;
+	NSInteger high = numberOfSections;
+	while (low < high) {
+		const NSInteger mid = (low + high) / 2;
+		if (offsets[mid + 1] > minY) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	const NSInteger firstSection = low;
+	// first section which starts at or below max y
+	high = numberOfSections;
+	while (low < high) {
+		const NSInteger mid = (low + high) / 2;
+		if (offsets[mid] >= maxY) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return NSMakeRange(firstSection, low - firstSection);
+}
+
+- (NSRange)sectionsInRect:(CGRect)rect {
+	return [self sectionsFromY:CGRectGetMinY(rect) toY:CGRectGetMaxY(rect)];
+}
+
+- (CGRect)visibleContentRect {
+	return CGRectMake(0, self.contentOffset.y,
+					  self.contentSize.width,
+					  MIN(self.contentSize.height, self.bounds.size.height));
+}
+
+- (void)updateHeaderInSection:(NSInteger)section
+						data:(BAMeshSectionData *)sectionData
+					   views:(BAMeshSectionViews *)sectionViews
+				 contentRect:(CGRect)contentRect
+{
+	if (!sectionViews.hasHeader) {
+		return;
+	}
+	CGRect headerRect = CGRectMake(0, sectionData.y, self.contentSize.width, sectionData.headerHeight);
+	if (CGRectIntersectsRect(contentRect, headerRect)) {
+		if (sectionViews.headerView) {
+			BAMeshSetViewFrame(sectionViews.headerView, headerRect);
+		} else {
+			if ([self.delegate respondsToSelector:@selector(meshView:viewForHeaderInSection:)]) {
+				sectionViews.headerView = [self.delegate meshView:self viewForHeaderInSection:section];
 			}
-			for (NSInteger cell = 0; cell < sectionViews.numberOfCells; cell++) {
-				CGRect cellFrame = [sectionData cellFrame:cell];
-				BAMeshViewCell *cellView = [sectionViews cellView:cell];
-				if (CGRectIntersectsRect(contentRect, cellFrame)) {
-					if (cellView) {
-						cellView.frame = cellFrame;
-					} else {
-						NSIndexPath *indexPath = [NSIndexPath indexPathForCell:cell inSection:section];
-						cellView = [self.dataSource meshView:self cellAtIndexPath:indexPath];
-						if (!cellView) {
-							[NSException raise:@"BAMeshViewError" format:@"Failed to create a cell"];
-						}
-						cellView.indexPath = indexPath;
-						UITapGestureRecognizer *tap = [[[UITapGestureRecognizer alloc] initWithTarget:self
-																							   action:@selector(handleTapOnCell:)]
-													   autorelease];
-						[cellView addGestureRecognizer:tap];
-						cellView.frame = cellFrame;
-						[self insertSubview:cellView atIndex:0];
-						[sectionViews setView:cellView forCell:cell];
-					}
-				} else {
-					if (cellView) {
-						[cellView removeFromSuperview];
-						if (cellView.reuseIdentifier) {
-							[cellView prepareForReuse];
-							[[self reusableCells] addObject:cellView];
-						}
-						[sectionViews setView:nil forCell:cell];
-					}
-				}
+			if (sectionViews.headerView) {
+				sectionViews.headerView.frame = headerRect;
+				[self insertSubview:sectionViews.headerView atIndex:0];
+			} else {
+				sectionViews.hasHeader = NO;
 			}
-			[self compactReusableCells];
-			if (sectionViews.hasFooter) {
-				CGRect footerRect = CGRectMake(0, sectionData.y + sectionData.totalHeight - sectionData.footerHeight,
-											   self.contentSize.width, sectionData.footerHeight);
-				if (CGRectIntersectsRect(contentRect, footerRect)) {
-					if (sectionViews.footerView) {
-						sectionViews.footerView.frame = footerRect;
-					} else {
-						if ([self.delegate respondsToSelector:@selector(meshView:viewForFooterInSection:)]) {
-							sectionViews.footerView = [self.delegate meshView:self viewForFooterInSection:section];
-						}
-						if (sectionViews.footerView) {
-							sectionViews.footerView.frame = footerRect;
-							[self insertSubview:sectionViews.footerView atIndex:0];
-						} else {
-							sectionViews.hasFooter = NO;
-						}
-					}
-				} else {
-					if (sectionViews.footerView) {
-						[sectionViews.footerView removeFromSuperview];
-						sectionViews.footerView = nil;
-					}
+		}
+	} else {
+		if (sectionViews.headerView) {
+			[sectionViews.headerView removeFromSuperview];
+			sectionViews.headerView = nil;
+		}
+	}
+}
+
+- (void)updateFooterInSection:(NSInteger)section
+						data:(BAMeshSectionData *)sectionData
+					   views:(BAMeshSectionViews *)sectionViews
+				 contentRect:(CGRect)contentRect
+{
+	if (!sectionViews.hasFooter) {
+		return;
+	}
+	CGRect footerRect = CGRectMake(0, sectionData.y + sectionData.totalHeight - sectionData.footerHeight,
+								   self.contentSize.width, sectionData.footerHeight);
+	if (CGRectIntersectsRect(contentRect, footerRect)) {
+		if (sectionViews.footerView) {
+			BAMeshSetViewFrame(sectionViews.footerView, footerRect);
+		} else {
+			if ([self.delegate respondsToSelector:@selector(meshView:viewForFooterInSection:)]) {
+				sectionViews.footerView = [self.delegate meshView:self viewForFooterInSection:section];
+			}
+			if (sectionViews.footerView) {
+				sectionViews.footerView.frame = footerRect;
+				[self insertSubview:sectionViews.footerView atIndex:0];
+			} else {
+				sectionViews.hasFooter = NO;
+			}
+		}
+	} else {
+		if (sectionViews.footerView) {
+			[sectionViews.footerView removeFromSuperview];
+			sectionViews.footerView = nil;
+		}
+	}
+}
+
+- (void)updateCellsInSection:(NSInteger)section
+						data:(BAMeshSectionData *)sectionData
+					   views:(BAMeshSectionViews *)sectionViews
+				 contentRect:(CGRect)contentRect
+{
+	// only cells which had views and cells of rows intersecting content are visited
+	NSRange cells = [sectionData cellsInRect:contentRect];
+	if (sectionViews.visibleCells.length > 0) {
+		cells = (cells.length > 0) ? NSUnionRange(cells, sectionViews.visibleCells) : sectionViews.visibleCells;
+	}
+	NSInteger firstVisibleCell = NSNotFound;
+	NSInteger lastVisibleCell = NSNotFound;
+	for (NSInteger cell = cells.location; cell < cells.location + cells.length; cell++) {
+		CGRect cellFrame = [sectionData cellFrame:cell];
+		BAMeshViewCell *cellView = [sectionViews cellView:cell];
+		if (CGRectIntersectsRect(contentRect, cellFrame)) {
+			if (cellView) {
+				[sectionViews setFrame:cellFrame ofCell:cell];
+			} else {
+				NSIndexPath *indexPath = [NSIndexPath indexPathForCell:cell inSection:section];
+				cellView = [self.dataSource meshView:self cellAtIndexPath:indexPath];
+				if (!cellView) {
+					[NSException raise:@"BAMeshViewError" format:@"Failed to create a cell"];
+				}
+				cellView.indexPath = indexPath;
+				if ([self.dataSource respondsToSelector:@selector(meshView:renderModelForCellAtIndexPath:)]) {
+					cellView.renderModel = [self takeRenderModelForCellAtIndexPath:indexPath];
 				}
+				[self insertSubview:cellView atIndex:0];
+				[sectionViews setView:cellView forCell:cell];
+				[sectionViews setFrame:cellFrame ofCell:cell];
+			}
+			if (firstVisibleCell == NSNotFound) {
+				firstVisibleCell = cell;
 			}
+			lastVisibleCell = cell;
 		} else {
+			if (cellView) {
+				[cellView removeFromSuperview];
+				if (cellView.reuseIdentifier) {
+					[cellView prepareForReuse];
+					[[self reusableCells] enqueueReusableView:cellView withIdentifier:cellView.reuseIdentifier];
+				}
+				[sectionViews setView:nil forCell:cell];
+			}
+		}
+	}
+	sectionViews.visibleCells = (firstVisibleCell == NSNotFound) ?
+	NSMakeRange(0, 0) : NSMakeRange(firstVisibleCell, lastVisibleCell - firstVisibleCell + 1);
+}
+
+- (void)updateVisibleCells {
+	NSArray *allSectionData = [self sectionData]; // updates content size
+	NSArray *allSectionViews = [self sectionViews];
+	const CGRect contentRect = [self visibleContentRect];
+//	NSLog(@"Content Rect: %@", NSStringFromCGRect(contentRect));
+	const NSRange visibleSections = [self sectionsInRect:contentRect];
+	for (NSInteger section = _visibleSections.location; section < _visibleSections.location + _visibleSections.length; section++) {
+		if (!NSLocationInRange(section, visibleSections)) {
 			// section is not visible
+			BAMeshSectionViews *sectionViews = [allSectionViews objectAtIndex:section];
 			[sectionViews removeViewsWithReusableCells:[self reusableCells]];
-			[self compactReusableCells];
+		}
+	}
+	for (NSInteger section = visibleSections.location; section < visibleSections.location + visibleSections.length; section++) {
+		BAMeshSectionData *sectionData = [allSectionData objectAtIndex:section];
+		BAMeshSectionViews *sectionViews = [allSectionViews objectAtIndex:section];
+		[self updateHeaderInSection:section data:sectionData views:sectionViews contentRect:contentRect];
+		[self updateCellsInSection:section data:sectionData views:sectionViews contentRect:contentRect];
+		[self updateFooterInSection:section data:sectionData views:sectionViews contentRect:contentRect];
+	}
+	_visibleSections = visibleSections;
+	[self updatePrefetchingCellsInContentRect:contentRect];
+}
+
+- (void)cancelPrefetching {
+	if ([_prefetchedIndexPaths count] > 0 &&
+		[self.dataSource respondsToSelector:@selector(meshView:cancelPrefetchingCellsAtIndexPaths:)])
+	{
+		[self.dataSource meshView:self cancelPrefetchingCellsAtIndexPaths:[_prefetchedIndexPaths allObjects]];
+	}
+	[_prefetchedIndexPaths removeAllObjects];
+	_prefetchRect = CGRectNull;
+	[self cancelRenderModelsAtIndexPaths:nil];
+}
+
+// Render models
+
+- (void)prepareRenderModelsAtIndexPaths:(NSArray *)indexPaths {
+	if (!_renderModels) {
+		_renderModels = [[BARenderModelQueue alloc] init];
+		_renderModels.delegate = self;
+	}
+	[_renderModels prepareRenderModelsForKeys:indexPaths];
+}
+
+- (id)renderModelQueue:(BARenderModelQueue *)queue renderModelForKey:(id)key {
+	return [self.dataSource meshView:self renderModelForCellAtIndexPath:key];
+}
+
+- (void)cancelRenderModelsAtIndexPaths:(NSArray *)indexPaths {
+	if (!indexPaths) {
+		[_renderModels cancelAllRenderModels];
+		return;
+	}
+	[_renderModels cancelRenderModelsForKeys:indexPaths];
+}
+
+// Prepared model is used once, models of cells which were not prefetched are prepared here
+- (id)takeRenderModelForCellAtIndexPath:(NSIndexPath *)indexPath {
+	id renderModel = [_renderModels takeRenderModelForKey:indexPath];
+	if (renderModel) {
+		return renderModel;
+	}
+	[self cancelRenderModelsAtIndexPaths:[NSArray arrayWithObject:indexPath]];
+	return [self.dataSource meshView:self renderModelForCellAtIndexPath:indexPath];
+}
+
+- (void)addIndexPathsOfCellsInRect:(CGRect)rect exceptRect:(CGRect)exceptRect toSet:(NSMutableSet *)indexPaths {
+	const NSRange sections = [self sectionsInRect:rect];
+	for (NSInteger section = sections.location; section < sections.location + sections.length; section++) {
+		BAMeshSectionData *sectionData = [[self sectionData] objectAtIndex:section];
+		const NSRange cells = [sectionData cellsInRect:rect];
+		for (NSInteger cell = cells.location; cell < cells.location + cells.length; cell++) {
+			const CGRect cellFrame = [sectionData cellFrame:cell];
+			if (CGRectIntersectsRect(rect, cellFrame) && !CGRectIntersectsRect(exceptRect, cellFrame)) {
+				[indexPaths addObject:[NSIndexPath indexPathForCell:cell inSection:section]];
+			}
+		}
+	}
+}
+
+- (void)updatePrefetchingCellsInContentRect:(CGRect)contentRect {
+	const BOOL prefetchesCells = [self.dataSource respondsToSelector:@selector(meshView:prefetchCellsAtIndexPaths:)];
+	const BOOL preparesRenderModels = [self.dataSource respondsToSelector:@selector(meshView:renderModelForCellAtIndexPath:)];
+	if (!prefetchesCells && !preparesRenderModels) {
+		return;
+	}
+	// direction is kept while content offset does not change
+	const CGFloat offsetDelta = self.contentOffset.y - _lastContentOffsetY;
+	if (offsetDelta != 0) {
+		_scrollsUp = (offsetDelta < 0);
+		_lastContentOffsetY = self.contentOffset.y;
+	}
+	CGRect prefetchRect = CGRectNull;
+	const CGFloat distance = rint(_prefetchDistance * self.bounds.size.height);
+	if (distance > 0) {
+		prefetchRect = _scrollsUp ?
+		CGRectMake(0, contentRect.origin.y - distance, contentRect.size.width, distance) :
+		CGRectMake(0, CGRectGetMaxY(contentRect), contentRect.size.width, distance);
+		prefetchRect = CGRectIntersection(prefetchRect, CGRectMake(0, 0, self.contentSize.width, self.contentSize.height));
+	}
+	if (CGRectEqualToRect(prefetchRect, _prefetchRect)) {
+		return;
+	}
+	_prefetchRect = prefetchRect;
+	NSMutableSet *indexPaths = [NSMutableSet set];
+	if (!CGRectIsNull(prefetchRect)) {
+		[self addIndexPathsOfCellsInRect:prefetchRect exceptRect:contentRect toSet:indexPaths];
+	}
+	NSMutableSet *cancelledIndexPaths = [[_prefetchedIndexPaths mutableCopy] autorelease];
+	[cancelledIndexPaths minusSet:indexPaths];
+	// cells which came into view are loading for real now
+	NSMutableArray *cancelled = [NSMutableArray arrayWithCapacity:[cancelledIndexPaths count]];
+	for (NSIndexPath *indexPath in cancelledIndexPaths) {
+		const CGRect cellFrame = [self rectForCellAtIndexPath:indexPath];
+		if (!CGRectIntersectsRect(contentRect, cellFrame)) {
+			[cancelled addObject:indexPath];
+		}
+	}
+	[indexPaths minusSet:_prefetchedIndexPaths];
+	if (!_prefetchedIndexPaths) {
+		_prefetchedIndexPaths = [[NSMutableSet alloc] init];
+	}
+	[_prefetchedIndexPaths minusSet:cancelledIndexPaths];
+	[_prefetchedIndexPaths unionSet:indexPaths];
+	if ([cancelled count] > 0 && [self.dataSource respondsToSelector:@selector(meshView:cancelPrefetchingCellsAtIndexPaths:)]) {
+		[self.dataSource meshView:self cancelPrefetchingCellsAtIndexPaths:cancelled];
+	}
+	if ([cancelled count] > 0 && preparesRenderModels) {
+		[self cancelRenderModelsAtIndexPaths:cancelled];
+	}
+	if ([indexPaths count] > 0) {
+		NSArray *prefetched = [[indexPaths allObjects] sortedArrayUsingSelector:@selector(compare:)];
+		if (_scrollsUp) {
+			// nearest cells go first
+			prefetched = [[prefetched reverseObjectEnumerator] allObjects];
+		}
+		if (preparesRenderModels) {
+			[self prepareRenderModelsAtIndexPaths:prefetched];
+		}
+		if (prefetchesCells) {
+			[self.dataSource meshView:self prefetchCellsAtIndexPaths:prefetched];
 		}
 	}
 }
@@ -697,6 +1307,8 @@
 - (void)layoutSubviews {
 	CGFloat width = self.bounds.size.width;
 	width -= (self.contentInset.left + self.contentInset.right);
+	const CGFloat headerHeight = _meshHeaderHeight;
+	const CGFloat footerHeight = _meshFooterHeight;
 	if (self.meshHeaderView) {
 		_meshHeaderHeight = [self.meshHeaderView sizeThatFits:CGSizeMake(width, HUGE_VALF)].height;
 	} else {
@@ -708,9 +1320,11 @@
 		_meshFooterHeight = 0;
 	}
 	
-	// update content size when view frame changes
-	[_sectionData release];
-	_sectionData = nil;
+	// update content size when view frame changes; rows are packed again only if width changes
+	if (width != _layoutWidth || _meshHeaderHeight != headerHeight || _meshFooterHeight != footerHeight) {
+		_needsLayoutUpdate = YES;
+		_prefetchRect = CGRectNull; // cell frames could change
+	}
 	
 	[self updateVisibleCells];
 	
@@ -746,6 +1360,7 @@
 	} else {
 		_meshHeaderHeight = 0;
 	}
+	_needsLayoutUpdate = YES;
 	[self setNeedsLayout];
 }
 
@@ -768,6 +1383,7 @@
 	} else {
 		_meshFooterHeight = 0;
 	}
+	_needsLayoutUpdate = YES;
 	[self setNeedsLayout];
 }
 
@@ -782,13 +1398,6 @@
 	return [self.dataSource meshView:self numberOfCellsInSection:section];
 }
 
-- (CGSize)sizeForCell:(NSInteger)cell inSection:(NSInteger)section {
-	if ([self.delegate respondsToSelector:@selector(meshView:sizeForCellAtIndexPath:)]) {
-		return [self.delegate meshView:self sizeForCellAtIndexPath:[NSIndexPath indexPathForCell:cell inSection:section]];
-	}
-	return self.cellSize;
-}
-
 - (BAMeshRowLayout)rowsLayoutInSection:(NSInteger)section {
 	if ([self.delegate respondsToSelector:@selector(meshView:rowsLayoutInSection:)]) {
 		return [self.delegate meshView:self rowsLayoutInSection:section];
@@ -796,13 +1405,6 @@
 	return BAMeshRowLayoutSpread;
 }
 
-- (BAMeshCellAlignment)alignmentForCellAtIndexPath:(NSIndexPath *)indexPath {
-	if ([self.delegate respondsToSelector:@selector(meshView:alignmentForCellAtIndexPath:)]) {
-		return [self.delegate meshView:self alignmentForCellAtIndexPath:indexPath];
-	}
-	return BAMeshCellAlignmentCenter;
-}
-
 - (CGFloat)heightForHeaderInSection:(NSInteger)section {
 	if ([self.delegate respondsToSelector:@selector(meshView:heightForHeaderInSection:)]) {
 		return [self.delegate meshView:self heightForHeaderInSection:section];
@@ -855,40 +1457,47 @@
 }
 
 - (NSIndexPath *)indexPathForCellAtPoint:(CGPoint)point {
-	// Not Implemented Yet
-	return nil;
+	const NSRange sections = [self sectionsFromY:point.y toY:point.y];
+	if (sections.location >= [[self sectionData] count]) {
+		return nil;
+	}
+	BAMeshSectionData *sectionData = [[self sectionData] objectAtIndex:sections.location];
+	const NSInteger cell = [sectionData cellAtPoint:point];
+	return (cell >= 0) ? [NSIndexPath indexPathForCell:cell inSection:sections.location] : nil;
 }
 
 - (NSArray *)indexPathsForRowsInRect:(CGRect)rect {
-	// Not Implemented Yet
-	return nil;
+	if (CGRectIsNull(rect)) {
+		return nil;
+	}
+	NSMutableSet *indexPaths = [NSMutableSet set];
+	[self addIndexPathsOfCellsInRect:rect exceptRect:CGRectNull toSet:indexPaths];
+	return [[indexPaths allObjects] sortedArrayUsingSelector:@selector(compare:)];
 }
 
 - (NSArray *)visibleCells {
-	// Not Implemented Yet
-	return nil;
+	NSMutableArray *cells = [NSMutableArray array];
+	NSArray *allSectionViews = [self sectionViews]; // resets visible sections when recreated
+	for (NSInteger section = _visibleSections.location; section < _visibleSections.location + _visibleSections.length; section++) {
+		BAMeshSectionViews *sectionViews = [allSectionViews objectAtIndex:section];
+		const NSRange visibleCells = sectionViews.visibleCells;
+		for (NSInteger cell = visibleCells.location; cell < visibleCells.location + visibleCells.length; cell++) {
+			BAMeshViewCell *cellView = [sectionViews cellView:cell];
+			if (cellView) {
+				[cells addObject:cellView];
+			}
+		}
+	}
+	return cells;
 }
 
 - (NSArray *)indexPathsForVisibleCells {
-	// Not Implemented Yet
-	return nil;
+	return [[self visibleCells] valueForKey:@"indexPath"];
 }
 
 - (NSIndexSet *)indexesOfVisibleSections {
 	[self sectionData]; // updates content size
-	NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
-	const CGRect contentRect = CGRectMake(0, self.contentOffset.y,
-										  self.contentSize.width,
-										  MIN(self.contentSize.height, self.bounds.size.height));
-	const NSInteger numberOfSections = [self numberOfSections];
-	for (NSInteger section = 0; section < numberOfSections; section++) {
-		BAMeshSectionData *sectionData = [[self sectionData] objectAtIndex:section];
-		const CGRect sectionRect = CGRectMake(0, sectionData.y, self.contentSize.width, sectionData.totalHeight);
-		if (CGRectIntersectsRect(contentRect, sectionRect)) {
-			[sections addIndex:section];
-		}
-	}
-	return sections;
+	return [NSIndexSet indexSetWithIndexesInRange:[self sectionsInRect:[self visibleContentRect]]];
 }
 
 - (void)scrollToRowAtIndexPath:(NSIndexPath *)indexPath
@@ -928,11 +1537,23 @@
 	}
 }
 
+// Taps on cells are recognized by the mesh, the cell is looked up by location in layout
+- (BAMeshViewCell *)cellViewAtPoint:(CGPoint)point {
+	NSIndexPath *indexPath = [self indexPathForCellAtPoint:point];
+	return indexPath ? [self cellAtIndexPath:indexPath] : nil;
+}
+
+- (BOOL)tapShouldReceiveTouch:(UITouch *)touch {
+	// touches outside of cells like in headers and footers are left alone
+	BAMeshViewCell *cell = [self cellViewAtPoint:[touch locationInView:self]];
+	return cell && [touch.view isDescendantOfView:cell];
+}
+
 - (void)handleTapOnCell:(UIGestureRecognizer *)recognizer {
-	if (![recognizer.view isKindOfClass:[BAMeshViewCell class]]) {
+	BAMeshViewCell *cell = [self cellViewAtPoint:[recognizer locationInView:self]];
+	if (!cell) {
 		return;
 	}
-	BAMeshViewCell *cell = (BAMeshViewCell *)recognizer.view;
 	if (recognizer.state == UIGestureRecognizerStateBegan) {
 		cell.highlighted = YES;
 	} else if (recognizer.state == UIGestureRecognizerStateCancelled) {
@@ -40,4 +40,17 @@
 @property(nonatomic,getter=isSelected) BOOL selected;
 @property(nonatomic,getter=isHighlighted) BOOL highlighted;
 
+// Render model
+// 
+// Immutable object describing contents of the cell, prepared by the data source off the main thread
+// ahead of display. Setting it calls applyRenderModel:. When the cell displays asynchronously its
+// contents are drawn by the class on a background queue and shown in the content view when ready.
+
+@property(nonatomic,retain) id renderModel;
+@property(nonatomic) BOOL displaysAsynchronously; // default is NO
+
+- (void)applyRenderModel:(id)renderModel; // for subclasses, does nothing by default
++ (void)drawRenderModel:(id)renderModel inContext:(CGContextRef)context size:(CGSize)size; // called on a background queue
+- (void)setNeedsAsynchronousDisplay;
+
 @end
@@ -26,6 +26,7 @@
  or implied, of Dmitry Stadnik.
  */
 
+#import <QuartzCore/QuartzCore.h>
 #import "BAMeshViewCell.h"
 #import "BAMeshViewCell+Owner.h"
 
@@ -34,13 +35,19 @@
 	BOOL _highlighted;
 	BOOL _selected;
 	UIView *_contentView;
+	id _renderModel;
+	BOOL _displaysAsynchronously;
+	NSUInteger _displayGeneration; // results of earlier asynchronous displays are dropped
+	CGSize _displayedSize;
 }
 
 @synthesize reuseIdentifier = _reuseIdentifier;
 @synthesize indexPath = _indexPath;
+@synthesize displaysAsynchronously = _displaysAsynchronously;
 
 - (void)dealloc {
 	[_contentView release];
+	[_renderModel release];
     [_reuseIdentifier release];
 	[_indexPath release];
     [super dealloc];
@@ -56,6 +63,13 @@
 - (void)prepareForReuse {
 }
 
+- (void)layoutSubviews {
+	[super layoutSubviews];
+	if (_displaysAsynchronously && _renderModel && !CGSizeEqualToSize(_displayedSize, self.bounds.size)) {
+		[self setNeedsAsynchronousDisplay];
+	}
+}
+
 - (UIView *)contentView {
 	if (!_contentView) {
 		_contentView = [[UIView alloc] init];
@@ -86,4 +100,57 @@
 	_highlighted = highlighted;
 }
 
+- (id)renderModel {
+	return _renderModel;
+}
+
+- (void)setRenderModel:(id)renderModel {
+	if (_renderModel != renderModel) {
+		[_renderModel release];
+		_renderModel = [renderModel retain];
+		if (_displaysAsynchronously) {
+			// contents drawn for the previous model are not shown while the new one is drawn
+			_displayGeneration++;
+			_contentView.layer.contents = nil;
+		}
+	}
+	[self applyRenderModel:renderModel];
+	if (_displaysAsynchronously) {
+		[self setNeedsAsynchronousDisplay];
+	}
+}
+
+- (void)applyRenderModel:(id)renderModel {
+}
+
++ (void)drawRenderModel:(id)renderModel inContext:(CGContextRef)context size:(CGSize)size {
+}
+
+- (void)setNeedsAsynchronousDisplay {
+	const NSUInteger generation = ++_displayGeneration;
+	const CGSize size = self.bounds.size;
+	_displayedSize = size;
+	if (!_renderModel || size.width <= 0 || size.height <= 0) {
+		self.contentView.layer.contents = nil;
+		return;
+	}
+	id renderModel = _renderModel; // retained by the block
+	Class cellClass = [self class];
+	const BOOL opaque = self.opaque;
+	const CGFloat scale = [UIScreen mainScreen].scale;
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		UIGraphicsBeginImageContextWithOptions(size, opaque, scale);
+		[cellClass drawRenderModel:renderModel inContext:UIGraphicsGetCurrentContext() size:size];
+		UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+		UIGraphicsEndImageContext();
+		dispatch_async(dispatch_get_main_queue(), ^{
+			// generation is only read and changed on the main thread
+			if (generation == _displayGeneration) {
+				self.contentView.layer.contentsScale = scale;
+				self.contentView.layer.contents = (id)image.CGImage;
+			}
+		});
+	});
+}
+
 @end
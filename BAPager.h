@@ -49,6 +49,11 @@
 // Update current page indicators or what you have
 - (void)pager:(BAPager *)pager currentPageDidChangeTo:(NSInteger)index;
 
+// Expensive content of pages within preload radius beyond the loaded ones is prepared before they
+// come into view, off the main thread like in BARenderModelQueue. Get it with renderModelForPageAtIndex:
+// in pager:pageAtIndex:
+- (id)pager:(BAPager *)pager renderModelForPageAtIndex:(NSInteger)index;
+
 @end
 
 
@@ -58,10 +63,17 @@
 @property(nonatomic, assign) NSUInteger numberOfPages;
 @property(nonatomic, assign) NSInteger currentPageIndex;
 @property(nonatomic, assign) id<BAPagerDelegate> delegate;
+@property(nonatomic, assign) NSUInteger preloadRadius; // pages loaded in each direction from the current one, at least 1. default is 1
 
 // Similar to reloadData of table view
 - (void)reloadPages;
 
+// Dropped pages responding to reuseIdentifier with non-nil value are kept for reuse
+- (UIView *)dequeueReusablePageWithIdentifier:(NSString *)identifier;
+
+// Returns nil if render model is not prepared yet
+- (id)renderModelForPageAtIndex:(NSInteger)index;
+
 // You should call this method when scroll view bounds change, typically after rotation
 - (void)layoutPages;
 
@@ -27,13 +27,22 @@
  */
 
 #import "BAPager.h"
+#import "BAViewsCache.h"
+#import "BARenderModelQueue.h"
 #import "UIView+BACookie.h"
 
+@interface BAPager () <BARenderModelQueueDelegate>
+@end
+
 @implementation BAPager {
 @private
 	UIScrollView *_scrollView;
 	NSUInteger _numberOfPages;
 	NSInteger _currentPageIndex;
+	NSUInteger _preloadRadius;
+	NSMutableDictionary *_pages; // NSNumber -> UIView
+	BAViewsCache *_reusablePages;
+	BARenderModelQueue *_renderModels; // keyed by NSNumber of page index
 }
 
 @synthesize delegate = _delegate;
@@ -41,23 +50,58 @@
 - (void)dealloc {
 	self.delegate = nil;
 	self.scrollView = nil;
+	[_pages release];
+	[_reusablePages release];
+	[_renderModels cancelAllRenderModels];
+	_renderModels.delegate = nil;
+	[_renderModels release];
 	[super dealloc];
 }
 
 - (id)init {
 	if ((self = [super init])) {
 		_currentPageIndex = -1;
+		_preloadRadius = 1;
+		_pages = [[NSMutableDictionary alloc] init];
+		_reusablePages = [[BAViewsCache alloc] init];
+		_reusablePages.capacityPerType = MAX(2 * _preloadRadius, 2);
 	}
 	return self;
 }
 
-- (UIView *)addPageAtIndex:(NSInteger)index cache:(NSMutableDictionary *)cache {
+- (NSUInteger)preloadRadius {
+	return _preloadRadius;
+}
+
+- (void)setPreloadRadius:(NSUInteger)preloadRadius {
+	if (_preloadRadius == preloadRadius) {
+		return;
+	}
+	_preloadRadius = preloadRadius;
+	// keep pages on both sides around
+	_reusablePages.capacityPerType = MAX(2 * preloadRadius, 2);
+	[self reloadPages];
+}
+
+// Range of pages which have views
+- (NSRange)pagesWindow {
+	if (_numberOfPages == 0 || _currentPageIndex < 0) {
+		return NSMakeRange(0, 0);
+	}
+	const NSInteger radius = MAX(_preloadRadius, 1);
+	const NSInteger firstPage = MAX(_currentPageIndex - radius, 0);
+	const NSInteger lastPage = MIN(_currentPageIndex + radius, (NSInteger)_numberOfPages - 1);
+	return NSMakeRange(firstPage, lastPage - firstPage + 1);
+}
+
+- (UIView *)dequeueReusablePageWithIdentifier:(NSString *)identifier {
+	return [_reusablePages dequeueReusableViewWithIdentifier:identifier];
+}
+
+- (UIView *)addPageAtIndex:(NSInteger)index {
 	id key = [NSNumber numberWithInteger:index];
-	UIView *page = [cache objectForKey:key];
-	if (page) {
-		[[page retain] autorelease];
-		[cache removeObjectForKey:key];
-	} else {
+	UIView *page = [_pages objectForKey:key];
+	if (!page) {
 		page = [self.delegate pager:self pageAtIndex:index];
 		page.cookie = key;
 		NSInteger order = 0;
@@ -65,106 +109,112 @@
 			order = [self.delegate pager:self orderOfPageAtIndex:index];
 		}
 		[self.scrollView insertSubview:page atIndex:order];
+		if (page) {
+			[_pages setObject:page forKey:key];
+		}
 	}
 	return page;
 }
 
+- (void)dropPageAtIndex:(NSInteger)index {
+	id key = [NSNumber numberWithInteger:index];
+	UIView *page = [[[_pages objectForKey:key] retain] autorelease];
+	[_pages removeObjectForKey:key];
+	if (self.delegate && [self.delegate respondsToSelector:@selector(pager:dropPageAtIndex:)]) {
+		[self.delegate pager:self dropPageAtIndex:index];
+	}
+	[page removeFromSuperview];
+	page.cookie = nil;
+	if ([page respondsToSelector:@selector(reuseIdentifier)]) {
+		[_reusablePages enqueueReusableView:page withIdentifier:[(id)page reuseIdentifier]];
+	}
+}
+
 - (void)reloadPages {
 	if (!self.scrollView) {
 		return;
 	}
 
-	NSMutableDictionary *cache = [NSMutableDictionary dictionaryWithCapacity:[self.scrollView.subviews count]];
-	for (UIView *view in [NSArray arrayWithArray:self.scrollView.subviews]) {
-		id cookie = view.cookie;
-		if (cookie && [cookie isKindOfClass:[NSNumber class]]) {
-			[cache setObject:view forKey:cookie];
+	// pages which are left go first so they could be reused
+	const NSRange window = [self pagesWindow];
+	for (NSNumber *key in [_pages allKeys]) {
+		if (!NSLocationInRange([key integerValue], window)) {
+			[self dropPageAtIndex:[key integerValue]];
 		}
 	}
+	for (NSInteger index = window.location; index < window.location + window.length; index++) {
+		[self addPageAtIndex:index];
+	}
+	[self layoutPages];
+	[self prepareRenderModelsAroundPages:window];
+}
+
+- (void)layoutPages {
+	if (!self.scrollView) {
+		return;
+	}
+	
+	const NSRange window = [self pagesWindow];
 	const CGFloat pageWidth = self.scrollView.bounds.size.width;
 	const CGFloat pageHeight = self.scrollView.bounds.size.height;
-	CGFloat offset = 0;
 	CGFloat x = 0;
-	CGFloat width = pageWidth;
-	
-	if (_numberOfPages > 0 && _currentPageIndex >= 0) {
-
-		if (_currentPageIndex > 0) {
-			// add prev page
-			UIView *prevPage = [self addPageAtIndex:(_currentPageIndex - 1) cache:cache];
-			prevPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
-			offset = pageWidth;
-			x += pageWidth;
-			width += pageWidth;
-		}
-
-		// add curr page
-		UIView *currPage = [self addPageAtIndex:_currentPageIndex cache:cache];
-		currPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
+	for (NSInteger index = window.location; index < window.location + window.length; index++) {
+		UIView *page = [_pages objectForKey:[NSNumber numberWithInteger:index]];
+		page.frame = CGRectMake(x, 0, pageWidth, pageHeight);
 		x += pageWidth;
-
-		if (_currentPageIndex < (NSInteger)(_numberOfPages - 1)) {
-			// add next page
-			UIView *nextPage = [self addPageAtIndex:(_currentPageIndex + 1) cache:cache];
-			nextPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
-			width += pageWidth;
-		}
 	}
-	
+	const CGFloat offset = (window.length > 0) ? (_currentPageIndex - window.location) * pageWidth : 0;
 	self.scrollView.contentOffset = CGPointMake(offset, 0);
-	self.scrollView.contentSize = CGSizeMake(width, pageHeight);
-	[cache enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-		if (self.delegate && [self.delegate respondsToSelector:@selector(pager:dropPageAtIndex:)]) {
-			[self.delegate pager:self dropPageAtIndex:[key integerValue]];
-		}
-		[obj removeFromSuperview];
-	}];
+	self.scrollView.contentSize = CGSizeMake(MAX(x, pageWidth), pageHeight);
 }
 
-- (void)layoutPages {
-	if (!self.scrollView) {
+// Render models
+
+- (id)renderModelForPageAtIndex:(NSInteger)index {
+	return [_renderModels renderModelForKey:[NSNumber numberWithInteger:index]];
+}
+
+- (id)renderModelQueue:(BARenderModelQueue *)queue renderModelForKey:(id)key {
+	return [self.delegate pager:self renderModelForPageAtIndex:[key integerValue]];
+}
+
+- (void)cancelRenderModels {
+	[_renderModels cancelAllRenderModels];
+}
+
+// Models are prepared for pages within preload radius beyond loaded ones and kept for loaded ones
+- (void)prepareRenderModelsAroundPages:(NSRange)window {
+	if (![self.delegate respondsToSelector:@selector(pager:renderModelForPageAtIndex:)]) {
 		return;
 	}
-	
-	if (_numberOfPages > 0 && _currentPageIndex >= 0) {
-		const CGFloat pageWidth = self.scrollView.bounds.size.width;
-		const CGFloat pageHeight = self.scrollView.bounds.size.height;
-		CGFloat offset = 0;
-		CGFloat x = 0;
-		CGFloat width = pageWidth;
-
-		NSMutableDictionary *cache = [NSMutableDictionary dictionaryWithCapacity:[self.scrollView.subviews count]];
-		for (UIView *view in [NSArray arrayWithArray:self.scrollView.subviews]) {
-			id cookie = view.cookie;
-			if (cookie && [cookie isKindOfClass:[NSNumber class]]) {
-				[cache setObject:view forKey:cookie];
-			}
-		}
-		
-		if (_currentPageIndex > 0) {
-			// layout prev page
-			UIView *prevPage = [cache objectForKey:[NSNumber numberWithInt:(_currentPageIndex - 1)]];
-			prevPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
-			offset = pageWidth;
-			x += pageWidth;
-			width += pageWidth;
+	if (!_renderModels) {
+		_renderModels = [[BARenderModelQueue alloc] init];
+		_renderModels.delegate = self;
+	}
+	if (window.length == 0) {
+		[self cancelRenderModels];
+		return;
+	}
+	const NSInteger radius = MAX(_preloadRadius, 1);
+	const NSInteger firstPage = MAX((NSInteger)window.location - radius, 0);
+	const NSInteger lastPage = MIN((NSInteger)(window.location + window.length) - 1 + radius, (NSInteger)_numberOfPages - 1);
+	const NSRange preparedPages = NSMakeRange(firstPage, lastPage - firstPage + 1);
+	[_renderModels cancelRenderModelsPassingTest:^BOOL(id key) {
+		return !NSLocationInRange([key integerValue], preparedPages);
+	}];
+	// nearest pages go first
+	NSMutableArray *keys = [NSMutableArray arrayWithCapacity:2 * radius];
+	for (NSInteger distance = 1; distance <= radius; distance++) {
+		const NSInteger prevPage = (NSInteger)window.location - distance;
+		const NSInteger nextPage = (NSInteger)(window.location + window.length) - 1 + distance;
+		if (prevPage >= firstPage) {
+			[keys addObject:[NSNumber numberWithInteger:prevPage]];
 		}
-		
-		// layout curr page
-		UIView *currPage = [cache objectForKey:[NSNumber numberWithInt:_currentPageIndex]];
-		currPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
-		x += pageWidth;
-		
-		if (_currentPageIndex < (NSInteger)(_numberOfPages - 1)) {
-			// layout next page
-			UIView *nextPage = [cache objectForKey:[NSNumber numberWithInt:(_currentPageIndex + 1)]];
-			nextPage.frame = CGRectMake(x, 0, pageWidth, pageHeight);
-			width += pageWidth;
+		if (nextPage <= lastPage) {
+			[keys addObject:[NSNumber numberWithInteger:nextPage]];
 		}
-		
-		self.scrollView.contentOffset = CGPointMake(offset, 0);
-		self.scrollView.contentSize = CGSizeMake(width, pageHeight);
 	}
+	[_renderModels prepareRenderModelsForKeys:keys];
 }
 
 - (NSUInteger)numberOfPages {
@@ -176,6 +226,7 @@
 		return;
 	}
 	_numberOfPages = count;
+	[self cancelRenderModels]; // pages could change
 	if (_currentPageIndex >= (NSInteger)count) {
 		_currentPageIndex = count - 1;
 		if (self.delegate && [self.delegate respondsToSelector:@selector(pager:currentPageDidChangeTo:)]) {
@@ -213,6 +264,9 @@
 	if (_scrollView == scrollView) {
 		return;
 	}
+	for (NSNumber *key in [_pages allKeys]) {
+		[self dropPageAtIndex:[key integerValue]];
+	}
 	[_scrollView release];
 	_scrollView = [scrollView retain];
 	_scrollView.delegate = self;
@@ -222,10 +276,7 @@
 - (void)scrollViewDidEndDecelerating:(UIScrollView *)scrollView {
 	CGFloat offset = scrollView.contentOffset.x;
 	NSInteger localIndex = offset / scrollView.bounds.size.width;
-	if (self.currentPageIndex > 0) {
-		localIndex--;
-	}
-	self.currentPageIndex += localIndex;
+	self.currentPageIndex = [self pagesWindow].location + localIndex;
 	[super scrollViewDidEndDecelerating:scrollView];
 }
 
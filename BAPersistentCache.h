@@ -31,6 +31,12 @@
 
 #define kBAPersistentCacheRetainInterval (60 * 60 * 24 * 7)
 
+// Posted on the main thread after image is encoded and written
+extern NSString * const BAPersistentCacheDidStoreImageNotification;
+extern NSString * const BAPersistentCacheImageKeyKey; // NSString, includes variant
+extern NSString * const BAPersistentCacheImageBytesKey; // NSNumber, bytes on disk
+extern NSString * const BAPersistentCacheImageEncodingTimeKey; // NSNumber, seconds spent encoding
+
 @protocol BAPersistencePolicy <NSObject>
 
 - (BOOL)staleContentAtPath:(NSString *)path;
@@ -43,10 +49,14 @@
 	NSString *_path;
 	NSMutableDictionary *_policiesByKeyHashes;
 	id<BAPersistencePolicy> _defaultPolicy;
+	NSOperationQueue *_imageQueue;
+	NSMutableDictionary *_pendingImages;
+	CGFloat _imageCompressionQuality;
 }
 
 @property(nonatomic, readonly) NSString *path;
 @property(nonatomic, retain) id<BAPersistencePolicy> defaultPolicy;
+@property(nonatomic, assign) CGFloat imageCompressionQuality; // for opaque images, 0.9 by default
 
 + (BAPersistentCache *)persistentCache;
 + (id<BAPersistencePolicy>)keepForeverPolicy;
@@ -61,13 +71,27 @@
 
 - (BOOL)hasDataForKey:(NSString *)key;
 - (NSData *)dataForKey:(NSString *)key;
+- (NSData *)mappedDataForKey:(NSString *)key; // memory mapped when possible
 - (void)setData:(NSData *)data forKey:(NSString *)key;
 - (void)clearDataForKey:(NSString *)key;
 
+// Variants keep derived data like thumbnails next to the original data of the key. Variants
+// older than the original data or left after it was cleared are removed when they are read.
++ (NSString *)keyForKey:(NSString *)key variant:(NSString *)variant;
+- (BOOL)hasDataForKey:(NSString *)key variant:(NSString *)variant;
+- (NSData *)dataForKey:(NSString *)key variant:(NSString *)variant;
+- (void)setData:(NSData *)data forKey:(NSString *)key variant:(NSString *)variant;
+- (void)clearDataForKey:(NSString *)key variant:(NSString *)variant;
+
 - (id)objectForKey:(NSString *)key;
 - (void)setObject:(id)object forKey:(NSString *)key;
 
+// Images are encoded and written on a background thread, PNG is used for images with alpha and JPEG otherwise.
+// Prefer storing original bytes with setData:forKey: when they are available, they need no encoding.
 - (UIImage *)imageForKey:(NSString *)key;
 - (void)setImage:(UIImage *)image forKey:(NSString *)key;
+- (UIImage *)imageForKey:(NSString *)key variant:(NSString *)variant;
+- (void)setImage:(UIImage *)image forKey:(NSString *)key variant:(NSString *)variant;
+- (void)waitUntilImagesStored;
 
 @end
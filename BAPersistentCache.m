@@ -29,6 +29,13 @@
 #import "BAPersistentCache.h"
 #import "NSString+BACoding.h"
 
+#define kBAPersistentCacheDefaultImageCompressionQuality 0.9
+
+NSString * const BAPersistentCacheDidStoreImageNotification = @"BAPersistentCacheDidStoreImageNotification";
+NSString * const BAPersistentCacheImageKeyKey = @"BAPersistentCacheImageKeyKey";
+NSString * const BAPersistentCacheImageBytesKey = @"BAPersistentCacheImageBytesKey";
+NSString * const BAPersistentCacheImageEncodingTimeKey = @"BAPersistentCacheImageEncodingTimeKey";
+
 @interface BAPersistencePolicyKeepForever : NSObject <BAPersistencePolicy>
 
 @end
@@ -81,6 +88,7 @@
 
 @synthesize path = _path;
 @synthesize defaultPolicy = _defaultPolicy;
+@synthesize imageCompressionQuality = _imageCompressionQuality;
 
 + (BAPersistentCache *)persistentCache {
 	static BAPersistentCache *instance;
@@ -106,6 +114,9 @@
 	[_path release];
 	[_policiesByKeyHashes release];
 	[_defaultPolicy release];
+	[_imageQueue waitUntilAllOperationsAreFinished];
+	[_imageQueue release];
+	[_pendingImages release];
 	[super dealloc];
 }
 
@@ -121,6 +132,10 @@
 		}
 		_path = [defaultPath retain];
 		_defaultPolicy = [[[self class] keepForSomeTimePolicy:kBAPersistentCacheRetainInterval] retain];
+		_imageQueue = [[NSOperationQueue alloc] init];
+		[_imageQueue setMaxConcurrentOperationCount:1];
+		_pendingImages = [[NSMutableDictionary alloc] init];
+		_imageCompressionQuality = kBAPersistentCacheDefaultImageCompressionQuality;
 	}
 	return self;
 }
@@ -180,6 +195,11 @@
 	return [NSData dataWithContentsOfFile:path];
 }
 
+- (NSData *)mappedDataForKey:(NSString *)key {
+	NSString *path = [self pathForKey:key];
+	return [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:NULL];
+}
+
 - (void)setData:(id)data forKey:(NSString *)key {
 	NSString *path = [self pathForKey:key];
 	[data writeToFile:path atomically:YES];
@@ -193,6 +213,45 @@
 }
 
 
++ (NSString *)keyForKey:(NSString *)key variant:(NSString *)variant {
+	return variant ? [NSString stringWithFormat:@"%@#%@", key, variant] : key;
+}
+
+// Variants are derived from the original data and are not valid after it is replaced
+- (BOOL)isCurrentVariantKey:(NSString *)variantKey ofKey:(NSString *)key {
+	if (variantKey == key) {
+		return YES;
+	}
+	NSDate *variantDate = [self modificationDateForKey:variantKey];
+	if (!variantDate) {
+		return NO;
+	}
+	NSDate *date = [self modificationDateForKey:key];
+	if (!date || [variantDate compare:date] == NSOrderedAscending) {
+		[self clearDataForKey:variantKey];
+		return NO;
+	}
+	return YES;
+}
+
+- (BOOL)hasDataForKey:(NSString *)key variant:(NSString *)variant {
+	return [self isCurrentVariantKey:[[self class] keyForKey:key variant:variant] ofKey:key];
+}
+
+- (NSData *)dataForKey:(NSString *)key variant:(NSString *)variant {
+	NSString *variantKey = [[self class] keyForKey:key variant:variant];
+	return [self isCurrentVariantKey:variantKey ofKey:key] ? [self dataForKey:variantKey] : nil;
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key variant:(NSString *)variant {
+	[self setData:data forKey:[[self class] keyForKey:key variant:variant]];
+}
+
+- (void)clearDataForKey:(NSString *)key variant:(NSString *)variant {
+	[self clearDataForKey:[[self class] keyForKey:key variant:variant]];
+}
+
+
 - (id)objectForKey:(NSString *)key {
 	NSString *path = [self pathForKey:key];
 	return [NSKeyedUnarchiver unarchiveObjectWithFile:path];
@@ -205,14 +264,73 @@
 
 
 - (UIImage *)imageForKey:(NSString *)key {
+	// image could be still waiting to be written
+	UIImage *image = nil;
+	@synchronized(_pendingImages) {
+		image = [[[_pendingImages objectForKey:key] retain] autorelease];
+	}
+	if (image) {
+		return image;
+	}
 	NSString *path = [self pathForKey:key];
 	return [UIImage imageWithContentsOfFile:path];
 }
 
 - (void)setImage:(UIImage *)image forKey:(NSString *)key {
+	if (!image || !key) {
+		return;
+	}
+	key = [[key copy] autorelease];
+	@synchronized(_pendingImages) {
+		[_pendingImages setObject:image forKey:key];
+	}
 	NSString *path = [self pathForKey:key];
-	NSData *data = UIImageJPEGRepresentation(image, 1.0);
-	[data writeToFile:path atomically:YES];
+	const CGFloat quality = self.imageCompressionQuality;
+	[_imageQueue addOperationWithBlock:^{
+		const CFTimeInterval startTime = CFAbsoluteTimeGetCurrent();
+		const CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(image.CGImage);
+		const BOOL hasAlpha = !(alphaInfo == kCGImageAlphaNone ||
+								alphaInfo == kCGImageAlphaNoneSkipFirst ||
+								alphaInfo == kCGImageAlphaNoneSkipLast);
+		NSData *data = hasAlpha ? UIImagePNGRepresentation(image) : UIImageJPEGRepresentation(image, quality);
+		const CFTimeInterval encodingTime = CFAbsoluteTimeGetCurrent() - startTime;
+		[data writeToFile:path atomically:YES];
+		@synchronized(_pendingImages) {
+			// could be replaced by a newer image while encoding
+			if ([_pendingImages objectForKey:key] == image) {
+				[_pendingImages removeObjectForKey:key];
+			}
+		}
+		NSDictionary *userInfo = [NSDictionary dictionaryWithObjectsAndKeys:
+								  key, BAPersistentCacheImageKeyKey,
+								  [NSNumber numberWithUnsignedInteger:[data length]], BAPersistentCacheImageBytesKey,
+								  [NSNumber numberWithDouble:encodingTime], BAPersistentCacheImageEncodingTimeKey,
+								  nil];
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[[NSNotificationCenter defaultCenter] postNotificationName:BAPersistentCacheDidStoreImageNotification
+																object:self
+															  userInfo:userInfo];
+		});
+	}];
+}
+
+- (UIImage *)imageForKey:(NSString *)key variant:(NSString *)variant {
+	NSString *variantKey = [[self class] keyForKey:key variant:variant];
+	@synchronized(_pendingImages) {
+		UIImage *image = [[[_pendingImages objectForKey:variantKey] retain] autorelease];
+		if (image) {
+			return image;
+		}
+	}
+	return [self isCurrentVariantKey:variantKey ofKey:key] ? [self imageForKey:variantKey] : nil;
+}
+
+- (void)setImage:(UIImage *)image forKey:(NSString *)key variant:(NSString *)variant {
+	[self setImage:image forKey:[[self class] keyForKey:key variant:variant]];
+}
+
+- (void)waitUntilImagesStored {
+	[_imageQueue waitUntilAllOperationsAreFinished];
 }
 
 @end
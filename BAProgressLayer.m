@@ -27,6 +27,63 @@
  */
 
 #import "BAProgressLayer.h"
+#import "BARasterCache.h"
+
+// progress is drawn in steps so frames could be reused
+#define kProgressSteps 100
+
+static void BAProgressLayerDraw(CGContextRef ctx, CGSize size, float progress, BOOL failed,
+								CGColorRef progressColor, CGColorRef crossColor)
+{
+	const CGFloat lw = 3;
+	const CGFloat ps = MIN(size.width / 2, size.height / 2) - lw;
+	const CGPoint cp = CGPointMake(size.width / 2, size.height / 2);
+	
+	if (failed) {
+		
+		// progress plate
+		CGContextBeginPath(ctx);
+		CGContextAddArc(ctx, cp.x, cp.y, ps, 0, M_PI * 2, 0);
+		CGContextClosePath(ctx);
+		CGContextSetFillColorWithColor(ctx, progressColor);
+		CGContextFillPath(ctx);
+		
+		// cross
+		CGContextBeginPath(ctx);
+		CGFloat cd = ps * 0.35;
+		CGContextMoveToPoint(ctx, cp.x + cd, cp.y + cd);
+		CGContextAddLineToPoint(ctx, cp.x - cd, cp.y - cd);
+		CGContextMoveToPoint(ctx, cp.x - cd, cp.y + cd);
+		CGContextAddLineToPoint(ctx, cp.x + cd, cp.y - cd);
+		CGContextMoveToPoint(ctx, cp.x + cd, cp.y + cd);
+		CGContextClosePath(ctx);
+		CGContextSetLineWidth(ctx, 4);
+		CGContextSetLineCap(ctx, kCGLineCapRound);
+		CGContextSetStrokeColorWithColor(ctx, crossColor);
+		CGContextStrokePath(ctx);
+		
+	} else {
+		
+		// progress pie
+		if (progress > 0) {
+			CGContextBeginPath(ctx);
+			CGContextMoveToPoint(ctx, cp.x, cp.y);
+			CGContextAddArc(ctx, cp.x, cp.y, ps - lw - 1, -M_PI_2, -M_PI_2 + M_PI * 2 * progress, 0);
+			CGContextClosePath(ctx);
+			CGContextSetFillColorWithColor(ctx, progressColor);
+			CGContextFillPath(ctx);
+		}
+		
+		// progress border
+		CGContextBeginPath(ctx);
+		CGContextAddArc(ctx, cp.x, cp.y, ps, 0, M_PI * 2, 0);
+		CGContextClosePath(ctx);
+		CGContextSetStrokeColorWithColor(ctx, progressColor);
+		CGContextSetLineWidth(ctx, lw);
+		CGContextStrokePath(ctx);
+		
+	}
+}
 
 @implementation BAProgressLayer {
 @private
@@ -105,54 +162,26 @@
 }
 
 - (void)drawInContext:(CGContextRef)ctx {
-	const CGFloat lw = 3;
-	const CGFloat ps = MIN(self.bounds.size.width / 2, self.bounds.size.height / 2) - lw;
-	const CGPoint cp = CGPointMake(self.bounds.size.width / 2, self.bounds.size.height / 2);
-	
-	if (self.failed) {
-		
-		// progress plate
-		CGContextBeginPath(ctx);
-		CGContextAddArc(ctx, cp.x, cp.y, ps, 0, M_PI * 2, 0);
-		CGContextClosePath(ctx);
-		CGContextSetFillColorWithColor(ctx, self.progressColor);
-		CGContextFillPath(ctx);
-		
-		// cross
-		CGContextBeginPath(ctx);
-		CGFloat cd = ps * 0.35;
-		CGContextMoveToPoint(ctx, cp.x + cd, cp.y + cd);
-		CGContextAddLineToPoint(ctx, cp.x - cd, cp.y - cd);
-		CGContextMoveToPoint(ctx, cp.x - cd, cp.y + cd);
-		CGContextAddLineToPoint(ctx, cp.x + cd, cp.y - cd);
-		CGContextMoveToPoint(ctx, cp.x + cd, cp.y + cd);
-		CGContextClosePath(ctx);
-		CGContextSetLineWidth(ctx, 4);
-		CGContextSetLineCap(ctx, kCGLineCapRound);
-		CGContextSetStrokeColorWithColor(ctx, self.backgroundColor);
-		CGContextStrokePath(ctx);
-		
-	} else {
-		
-		// progress pie
-		if (self.progress > 0) {
-			CGContextBeginPath(ctx);
-			CGContextMoveToPoint(ctx, cp.x, cp.y);
-			CGContextAddArc(ctx, cp.x, cp.y, ps - lw - 1, -M_PI_2, -M_PI_2 + M_PI * 2 * self.progress, 0);
-			CGContextClosePath(ctx);
-			CGContextSetFillColorWithColor(ctx, self.progressColor);
-			CGContextFillPath(ctx);
-		}
-		
-		// progress border
-		CGContextBeginPath(ctx);
-		CGContextAddArc(ctx, cp.x, cp.y, ps, 0, M_PI * 2, 0);
-		CGContextClosePath(ctx);
-		CGContextSetStrokeColorWithColor(ctx, self.progressColor);
-		CGContextSetLineWidth(ctx, lw);
-		CGContextStrokePath(ctx);
-		
+	const BOOL failed = self.failed;
+	const int step = failed ? 0 : (int)ceilf(self.progress * kProgressSteps);
+	CGColorRef progressColor = self.progressColor;
+	CGColorRef crossColor = self.backgroundColor;
+	NSString *progressColorKey = [BARasterCache keyForColor:progressColor];
+	NSString *crossColorKey = [BARasterCache keyForColor:crossColor];
+	NSString *key = nil;
+	if (failed && progressColorKey && crossColorKey) {
+		key = [NSString stringWithFormat:@"BAProgressLayer failed %@ %@", progressColorKey, crossColorKey];
+	} else if (!failed && progressColorKey) {
+		key = [NSString stringWithFormat:@"BAProgressLayer %d %@", step, progressColorKey];
 	}
+	UIGraphicsPushContext(ctx);
+	[[BARasterCache sharedCache] drawImageForKey:key
+										  inRect:self.bounds
+										   scale:self.contentsScale
+									  usingBlock:^(CGContextRef context, CGSize size) {
+		BAProgressLayerDraw(context, size, (float)step / kProgressSteps, failed, progressColor, crossColor);
+	}];
+	UIGraphicsPopContext();
 }
 
 @end
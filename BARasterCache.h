@@ -0,0 +1,54 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <UIKit/UIKit.h>
+
+typedef void (^BARasterCacheDrawingBlock)(CGContextRef context, CGSize size);
+
+// Keeps bitmaps of reusable vector drawings
+// 
+// A piece is rendered once per key, size and scale and then composited as an image. Key should
+// describe everything that affects drawing apart from size and scale, colors included. Drawing
+// context has origin at the top left corner like contexts of views and layers do.
+
+@interface BARasterCache : NSObject
+
+@property(nonatomic, assign) NSUInteger countLimit; // default is 256
+@property(readonly) NSUInteger hitsCount;
+@property(readonly) NSUInteger missesCount;
+
++ (BARasterCache *)sharedCache;
++ (NSString *)keyForColor:(CGColorRef)color; // nil for pattern colors, they are not cached
+
+// Scale of 0 means scale of the main screen
+- (UIImage *)imageForKey:(NSString *)key size:(CGSize)size scale:(CGFloat)scale usingBlock:(BARasterCacheDrawingBlock)block;
+// Draws cached image in the current context, or draws with the block directly when key is nil
+- (void)drawImageForKey:(NSString *)key inRect:(CGRect)rect scale:(CGFloat)scale usingBlock:(BARasterCacheDrawingBlock)block;
+- (void)removeAllImages;
+
+@end
@@ -0,0 +1,136 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BARasterCache.h"
+
+#define kDefaultCountLimit 256
+
+@implementation BARasterCache {
+@private
+	NSCache *_images;
+	NSUInteger _hitsCount;
+	NSUInteger _missesCount;
+}
+
+@synthesize hitsCount = _hitsCount;
+@synthesize missesCount = _missesCount;
+
++ (BARasterCache *)sharedCache {
+	static BARasterCache *cache;
+	if (!cache) {
+		cache = [[BARasterCache alloc] init];
+	}
+	return cache;
+}
+
++ (NSString *)keyForColor:(CGColorRef)color {
+	if (!color) {
+		return @"none";
+	}
+	// components of different color spaces are not comparable
+	const CGColorSpaceModel model = CGColorSpaceGetModel(CGColorGetColorSpace(color));
+	if (model == kCGColorSpaceModelPattern) {
+		return nil;
+	}
+	const size_t count = CGColorGetNumberOfComponents(color);
+	const CGFloat *components = CGColorGetComponents(color);
+	NSMutableString *key = [NSMutableString stringWithCapacity:(count * 6 + 4)];
+	[key appendFormat:@"%d:", (int)model];
+	for (size_t i = 0; i < count; i++) {
+		[key appendFormat:(i > 0 ? @",%.3f" : @"%.3f"), components[i]];
+	}
+	return key;
+}
+
+- (id)init {
+	if ((self = [super init])) {
+		_images = [[NSCache alloc] init];
+		_images.countLimit = kDefaultCountLimit;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_images release];
+	[super dealloc];
+}
+
+- (NSUInteger)countLimit {
+	return _images.countLimit;
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit {
+	_images.countLimit = countLimit;
+}
+
+- (UIImage *)imageForKey:(NSString *)key size:(CGSize)size scale:(CGFloat)scale usingBlock:(BARasterCacheDrawingBlock)block {
+	if (!key || size.width <= 0 || size.height <= 0) {
+		return nil;
+	}
+	if (scale <= 0) {
+		scale = [UIScreen mainScreen].scale;
+	}
+	NSString *imageKey = [NSString stringWithFormat:@"%@ %gx%g@%g", key, size.width, size.height, scale];
+	UIImage *image = [_images objectForKey:imageKey];
+	if (image) {
+		_hitsCount++;
+		return image;
+	}
+	_missesCount++;
+	UIGraphicsBeginImageContextWithOptions(size, NO, scale);
+	if (block) {
+		block(UIGraphicsGetCurrentContext(), size);
+	}
+	image = UIGraphicsGetImageFromCurrentImageContext();
+	UIGraphicsEndImageContext();
+	if (image) {
+		[_images setObject:image forKey:imageKey];
+	}
+	return image;
+}
+
+- (void)drawImageForKey:(NSString *)key inRect:(CGRect)rect scale:(CGFloat)scale usingBlock:(BARasterCacheDrawingBlock)block {
+	if (key) {
+		[[self imageForKey:key size:rect.size scale:scale usingBlock:block] drawInRect:rect];
+		return;
+	}
+	CGContextRef context = UIGraphicsGetCurrentContext();
+	if (!context || !block || rect.size.width <= 0 || rect.size.height <= 0) {
+		return;
+	}
+	CGContextSaveGState(context);
+	CGContextTranslateCTM(context, rect.origin.x, rect.origin.y);
+	block(context, rect.size);
+	CGContextRestoreGState(context);
+}
+
+- (void)removeAllImages {
+	[_images removeAllObjects];
+}
+
+@end
@@ -0,0 +1,64 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <UIKit/UIKit.h>
+#import <QuartzCore/QuartzCore.h>
+#import "BAImageLoader.h"
+
+// Many small remote images fetched as one sprite sheet
+// 
+// Atlas loads and decodes its sheet once and views display slices of it by setting contents
+// of their layers to the shared sheet image with contentsRect of the slice. So there is one
+// request, one cache file, one decode and one bitmap for all the images in the atlas.
+// Rects of images are in pixels of the sheet image.
+
+extern NSString * const BARemoteImageAtlasDidLoadNotification; // object is atlas
+
+@interface BARemoteImageAtlas : NSObject <BADataLoaderDelegate>
+
+@property(nonatomic, readonly) NSURL *URL;
+@property(nonatomic, assign) CGFloat scale; // scale of the sheet image, 1 by default
+@property(nonatomic, readonly) UIImage *image; // decoded sheet, nil until loaded
+@property(nonatomic, readonly, getter=isLoaded) BOOL loaded;
+@property(nonatomic, readonly) NSError *error; // of the last load
+
+- (id)initWithURL:(NSURL *)URL;
+
+- (NSArray *)keys;
+- (void)setRect:(CGRect)rect forKey:(NSString *)key;
+- (void)setRectsWithDictionary:(NSDictionary *)rects; // NSString -> NSValue with CGRect
+- (BOOL)hasImageForKey:(NSString *)key;
+- (CGSize)imageSizeForKey:(NSString *)key; // in points
+- (CGRect)contentsRectForKey:(NSString *)key; // in unit coordinate space of the sheet
+
+- (void)load; // does nothing if already loaded or loading
+- (void)cancel;
+- (void)setContentsOfLayer:(CALayer *)layer forKey:(NSString *)key; // clears contents until loaded
+- (UIImage *)imageForKey:(NSString *)key; // separate image copied from the sheet; prefer layer contents
+
+@end
@@ -0,0 +1,210 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BARemoteImageAtlas.h"
+#import "BAImageDecoder.h"
+
+NSString * const BARemoteImageAtlasDidLoadNotification = @"BARemoteImageAtlasDidLoadNotification";
+
+@implementation BARemoteImageAtlas {
+@private
+	NSURL *_URL;
+	CGFloat _scale;
+	UIImage *_image;
+	NSError *_error;
+	NSMutableDictionary *_rects;
+	BAImageLoader *_loader;
+	NSOperation *_decodeOperation;
+}
+
+@synthesize URL = _URL;
+@synthesize scale = _scale;
+@synthesize image = _image;
+@synthesize error = _error;
+
+- (id)initWithURL:(NSURL *)URL {
+	if ((self = [super init])) {
+		_URL = [URL retain];
+		_scale = 1;
+		_rects = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[self cancel];
+	[_URL release];
+	[_image release];
+	[_error release];
+	[_rects release];
+	[super dealloc];
+}
+
+- (NSArray *)keys {
+	return [_rects allKeys];
+}
+
+- (void)setRect:(CGRect)rect forKey:(NSString *)key {
+	[_rects setObject:[NSValue valueWithCGRect:rect] forKey:key];
+}
+
+- (void)setRectsWithDictionary:(NSDictionary *)rects {
+	[_rects addEntriesFromDictionary:rects];
+}
+
+- (BOOL)hasImageForKey:(NSString *)key {
+	return key && [_rects objectForKey:key];
+}
+
+- (CGRect)rectForKey:(NSString *)key {
+	NSValue *value = key ? [_rects objectForKey:key] : nil;
+	return value ? [value CGRectValue] : CGRectZero;
+}
+
+- (CGSize)imageSizeForKey:(NSString *)key {
+	const CGRect rect = [self rectForKey:key];
+	return CGSizeMake(rect.size.width / _scale, rect.size.height / _scale);
+}
+
+- (CGRect)contentsRectForKey:(NSString *)key {
+	CGImageRef imageRef = _image.CGImage;
+	if (!imageRef) {
+		return CGRectMake(0, 0, 1, 1);
+	}
+	const CGFloat width = CGImageGetWidth(imageRef);
+	const CGFloat height = CGImageGetHeight(imageRef);
+	const CGRect rect = [self rectForKey:key];
+	return CGRectMake(rect.origin.x / width, rect.origin.y / height, rect.size.width / width, rect.size.height / height);
+}
+
+- (BOOL)isLoaded {
+	return !!_image;
+}
+
+- (void)resetLoader {
+	if (_loader) {
+		_loader.delegate = nil; // loader is retained by connection and can outlive us
+		[_loader release];
+		_loader = nil;
+	}
+}
+
+- (void)resetDecodeOperation {
+	if (_decodeOperation) {
+		[_decodeOperation cancel];
+		[_decodeOperation release];
+		_decodeOperation = nil;
+	}
+}
+
+- (void)cancel {
+	[self resetLoader];
+	[self resetDecodeOperation];
+}
+
+- (void)didLoadImage:(UIImage *)image error:(NSError *)error {
+	[_image release];
+	_image = [image retain];
+	[_error release];
+	_error = [error retain];
+	[[NSNotificationCenter defaultCenter] postNotificationName:BARemoteImageAtlasDidLoadNotification object:self];
+}
+
+- (void)startLoader {
+	NSURLRequest *request = [BADataLoader GETRequestWithURL:_URL];
+	_loader = [[BAImageLoader alloc] initWithRequest:request];
+	_loader.delegate = self;
+	[_loader startIgnoreCache:YES]; // cache was checked already
+}
+
+- (void)load {
+	if (_image || _loader || _decodeOperation || !_URL) {
+		return;
+	}
+	NSString *key = [_URL absoluteString];
+	UIImage *image = [[BAImageDecoder sharedDecoder] cachedImageForKey:key];
+	if (image) {
+		[self didLoadImage:image error:nil];
+		return;
+	}
+	_decodeOperation = [[[BAImageDecoder sharedDecoder] decodeImageFromCache:[BAPersistentCache persistentCache]
+																	  forKey:key
+																  completion:^(UIImage *cachedImage) {
+		[self resetDecodeOperation];
+		if (cachedImage) {
+			[self didLoadImage:cachedImage error:nil];
+		} else {
+			[self startLoader];
+		}
+	}] retain];
+}
+
+- (void)loader:(BADataLoader *)loader didFinishLoadingData:(NSData *)data fromCache:(BOOL)fromCache {
+	UIImage *image = ((BAImageLoader *)loader).image;
+	[self resetLoader];
+	if (!image) {
+		[self didLoadImage:nil error:nil];
+		return;
+	}
+	_decodeOperation = [[[BAImageDecoder sharedDecoder] decodeImage:image
+															 forKey:[_URL absoluteString]
+														 completion:^(UIImage *decodedImage) {
+		[self resetDecodeOperation];
+		[self didLoadImage:decodedImage error:nil];
+	}] retain];
+}
+
+- (void)loader:(BADataLoader *)loader didFailWithError:(NSError *)error {
+	[self resetLoader];
+	[self didLoadImage:nil error:error];
+}
+
+- (void)setContentsOfLayer:(CALayer *)layer forKey:(NSString *)key {
+	if (_image && [self hasImageForKey:key]) {
+		layer.contents = (id)_image.CGImage;
+		layer.contentsRect = [self contentsRectForKey:key];
+		layer.contentsScale = _scale;
+	} else {
+		layer.contents = nil;
+	}
+}
+
+- (UIImage *)imageForKey:(NSString *)key {
+	if (!_image || ![self hasImageForKey:key]) {
+		return nil;
+	}
+	CGImageRef imageRef = CGImageCreateWithImageInRect(_image.CGImage, [self rectForKey:key]);
+	if (!imageRef) {
+		return nil;
+	}
+	UIImage *image = [UIImage imageWithCGImage:imageRef scale:_scale orientation:UIImageOrientationUp];
+	CGImageRelease(imageRef);
+	return image;
+}
+
+@end
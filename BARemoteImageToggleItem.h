@@ -29,6 +29,7 @@
 #import <UIKit/UIKit.h>
 #import "BAToggleItem.h"
 #import "BARemoteImageView.h"
+#import "BARemoteImageAtlas.h"
 
 @interface BARemoteImageToggleItem : UIView <BAToggleItem> {
 @private
@@ -36,11 +37,21 @@
 	UIEdgeInsets _imageInsets;
 	BOOL _selected;
 	UIColor *_selectedOutlineColor;
+	BARemoteImageAtlas *_atlas;
+	NSString *_atlasKey;
+	UIView *_atlasView;
 }
 
 @property(nonatomic, readonly) BARemoteImageView *imageView;
 @property(nonatomic, assign) UIEdgeInsets imageInsets;
 @property(nonatomic, assign) BOOL selected;
 @property(nonatomic, retain) UIColor *selectedOutlineColor;
+// Largest size image is displayed at; images are decoded to fit it. Set before image URL.
+@property(nonatomic, assign) CGSize maximumImageSize;
+@property(nonatomic, readonly) BARemoteImageAtlas *atlas;
+@property(nonatomic, readonly) NSString *atlasKey;
+
+// Displays image of the key from atlas instead of remote image of the image view; atlas is loaded if needed.
+- (void)setAtlas:(BARemoteImageAtlas *)atlas key:(NSString *)key;
 
 @end
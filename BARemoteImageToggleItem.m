@@ -34,25 +34,40 @@
 @synthesize imageView = _imageView;
 @synthesize imageInsets = _imageInsets;
 @synthesize selectedOutlineColor = _selectedOutlineColor;
+@synthesize atlas = _atlas;
+@synthesize atlasKey = _atlasKey;
 
 - (void)dealloc {
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
 	[_imageView release];
 	[_selectedOutlineColor release];
+	[_atlas release];
+	[_atlasKey release];
+	[_atlasView release];
 	[super dealloc];
 }
 
 - (id)init {
 	if ((self = [super init])) {
 		_imageView = [[BARemoteImageView alloc] init];
+		_imageView.contentMode = UIViewContentModeScaleAspectFit; // same as the frame fitted in layout
 		[self addSubview:_imageView];
 	}
 	return self;
 }
 
+- (BOOL)hasImage {
+	return _atlas ? _atlas.loaded && [_atlas hasImageForKey:_atlasKey] : !!self.imageView.image;
+}
+
+- (CGSize)imageSize {
+	return _atlas ? [_atlas imageSizeForKey:_atlasKey] : self.imageView.image.size;
+}
+
 - (CGSize)sizeThatFits:(CGSize)size {
 	CGSize viewSize = { 0, 0 };
-	if (self.imageView.image) {
-		viewSize = self.imageView.image.size;
+	if ([self hasImage]) {
+		viewSize = [self imageSize];
 	}
 	CGSize maxViewSize = CGSizeMake(size.width - (self.imageInsets.left + self.imageInsets.right),
 									size.height - (self.imageInsets.top + self.imageInsets.bottom));
@@ -73,8 +88,8 @@
 - (void)layoutSubviews {
 	[super layoutSubviews];
 	CGRect r = UIEdgeInsetsInsetRect(self.bounds, self.imageInsets);
-	if (self.imageView.image) {
-		CGSize size = self.imageView.image.size;
+	if ([self hasImage]) {
+		CGSize size = [self imageSize];
 		if (r.size.width < size.width && size.width > 0 && r.size.width > 0) {
 			double scale = r.size.width / size.width;
 			size.width = roundf(r.size.width);
@@ -91,6 +106,50 @@
 	} else {
 		self.imageView.frame = r;
 	}
+	_atlasView.frame = self.imageView.frame;
+}
+
+- (void)atlasDidLoad:(NSNotification *)notification {
+	[_atlas setContentsOfLayer:_atlasView.layer forKey:_atlasKey];
+	[self setNeedsLayout];
+	[self setNeedsDisplay];
+}
+
+- (void)setAtlas:(BARemoteImageAtlas *)atlas key:(NSString *)key {
+	if (_atlas != atlas) {
+		if (_atlas) {
+			[[NSNotificationCenter defaultCenter] removeObserver:self
+															name:BARemoteImageAtlasDidLoadNotification
+														  object:_atlas];
+		}
+		[_atlas release];
+		_atlas = [atlas retain];
+		if (_atlas) {
+			[[NSNotificationCenter defaultCenter] addObserver:self
+													 selector:@selector(atlasDidLoad:)
+														 name:BARemoteImageAtlasDidLoadNotification
+													   object:_atlas];
+		}
+	}
+	[_atlasKey release];
+	_atlasKey = [key copy];
+	if (_atlas) {
+		self.imageView.remoteImageURL = nil;
+		self.imageView.image = nil;
+		if (!_atlasView) {
+			_atlasView = [[UIView alloc] init];
+			_atlasView.userInteractionEnabled = NO;
+			[self addSubview:_atlasView];
+		}
+		[_atlas setContentsOfLayer:_atlasView.layer forKey:_atlasKey];
+		[_atlas load];
+	} else {
+		[_atlasView removeFromSuperview];
+		[_atlasView release];
+		_atlasView = nil;
+	}
+	[self setNeedsLayout];
+	[self setNeedsDisplay];
 }
 
 - (void)drawRect:(CGRect)rect {
@@ -106,6 +165,14 @@
 	}
 }
 
+- (CGSize)maximumImageSize {
+	return self.imageView.decodedImageSize;
+}
+
+- (void)setMaximumImageSize:(CGSize)maximumImageSize {
+	self.imageView.decodedImageSize = maximumImageSize;
+}
+
 - (BOOL)selected {
 	return _selected;
 }
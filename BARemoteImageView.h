@@ -42,10 +42,15 @@
 
 @end
 
-@interface BARemoteImageView : UIImageView <BADataLoaderDelegate>
+@interface BARemoteImageView : UIImageView <BAImageLoaderDelegate>
 
 @property(nonatomic, retain) NSURL *remoteImageURL;
 @property(nonatomic, assign) BOOL animateImageUpdate;
+// Images are decoded to this size according to content mode; bounds size is used when it's zero.
+// Set the size or bounds before URL to avoid decoding images at full resolution.
+@property(nonatomic, assign) CGSize decodedImageSize;
+// Shows partially loaded images while loading from network; default is NO
+@property(nonatomic, assign) BOOL progressive;
 @property(nonatomic, assign) id<BARemoteImageViewDelegate> delegate;
 
 @end
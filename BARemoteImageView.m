@@ -27,14 +27,20 @@
 */
 
 #import "BARemoteImageView.h"
+#import "BAImageDecoder.h"
 
 @implementation BARemoteImageView {
 @private
 	NSURL *_remoteImageURL;
 	BAImageLoader *_loader;
+	NSOperation *_decodeOperation;
+	CGSize _decodedImageSize;
+	BOOL _progressive;
 }
 
 @synthesize animateImageUpdate = _animateImageUpdate;
+@synthesize decodedImageSize = _decodedImageSize;
+@synthesize progressive = _progressive;
 @synthesize delegate = _delegate;
 
 - (void)resetLoader {
@@ -45,8 +51,17 @@
 	}
 }
 
+- (void)resetDecodeOperation {
+	if (_decodeOperation) {
+		[_decodeOperation cancel];
+		[_decodeOperation release];
+		_decodeOperation = nil;
+	}
+}
+
 - (void)dealloc {
 	[self resetLoader];
+	[self resetDecodeOperation];
 	[_remoteImageURL release];
 	[super dealloc];
 }
@@ -88,31 +103,78 @@
 	_remoteImageURL = [remoteImageURL retain];
 
 	[self resetLoader];
+	[self resetDecodeOperation];
 	if (_remoteImageURL) {
-		// Check cache first so update is immediate; loader defers update
-		UIImage *image = [[BAPersistentCache persistentCache] imageForKey:[_remoteImageURL absoluteString]];
+		// Decoded images are ready to draw so update is immediate
+		NSString *key = [_remoteImageURL absoluteString];
+		const CGSize size = [self imageDecodeSize];
+		UIImage *image = [[BAImageDecoder sharedDecoder] cachedImageForKey:key size:size contentMode:self.contentMode];
 		if (image) {
 			[self updateRemoteImage:image animated:NO];
 		} else {
-			NSURLRequest *request = [BADataLoader GETRequestWithURL:_remoteImageURL];
-			_loader = [[BAImageLoader alloc] initWithRequest:request];
-			_loader.delegate = self;
-			[_loader startIgnoreCache:NO];
+			// Read and decode cached data off the main thread and go to network if there is none
+			_decodeOperation = [[[BAImageDecoder sharedDecoder] decodeImageFromCache:[BAPersistentCache persistentCache]
+																			  forKey:key
+																				size:size
+																		 contentMode:self.contentMode
+																		  completion:^(UIImage *cachedImage) {
+				[self resetDecodeOperation];
+				if (cachedImage) {
+					[self updateRemoteImage:cachedImage animated:NO];
+					[self didLoadRemoteImage];
+				} else {
+					[self startLoader];
+				}
+			}] retain];
 		}
 	}
 }
 
-- (void)loader:(BADataLoader *)loader didFinishLoadingData:(NSData *)data fromCache:(BOOL)fromCache {
-	UIImage *image = ((BAImageLoader *)loader).image;
-	if (image) {
-		[self updateRemoteImage:image animated:!fromCache];
+- (CGSize)imageDecodeSize {
+	return CGSizeEqualToSize(_decodedImageSize, CGSizeZero) ? self.bounds.size : _decodedImageSize;
+}
+
+- (void)startLoader {
+	NSURLRequest *request = [BADataLoader GETRequestWithURL:_remoteImageURL];
+	_loader = [[BAImageLoader alloc] initWithRequest:request];
+	_loader.delegate = self;
+	if (_progressive) {
+		_loader.progressive = YES;
+		_loader.partialImageSize = [self imageDecodeSize];
+		_loader.partialImageContentMode = self.contentMode;
 	}
-	[self resetLoader];
+	[_loader startIgnoreCache:YES]; // cache was checked already
+}
+
+- (void)loader:(BAImageLoader *)loader didUpdatePartialImage:(UIImage *)partialImage {
+	self.image = partialImage;
+}
+
+- (void)didLoadRemoteImage {
 	if (self.delegate && [self.delegate respondsToSelector:@selector(remoteImageViewDidLoad:)]) {
 		[self.delegate remoteImageViewDidLoad:self];
 	}
 }
 
+- (void)loader:(BADataLoader *)loader didFinishLoadingData:(NSData *)data fromCache:(BOOL)fromCache {
+	UIImage *image = ((BAImageLoader *)loader).image;
+	[self resetLoader];
+	if (image) {
+		// Decode from data so large images are subsampled instead of being decoded at full resolution
+		_decodeOperation = [[[BAImageDecoder sharedDecoder] decodeImageData:data
+																	 forKey:[_remoteImageURL absoluteString]
+																	   size:[self imageDecodeSize]
+																contentMode:self.contentMode
+																 completion:^(UIImage *decodedImage) {
+			[self resetDecodeOperation];
+			[self updateRemoteImage:(decodedImage ? decodedImage : image) animated:!fromCache];
+			[self didLoadRemoteImage];
+		}] retain];
+	} else {
+		[self didLoadRemoteImage];
+	}
+}
+
 - (void)loader:(BADataLoader *)loader didFailWithError:(NSError *)error {
 	[self resetLoader];
 	if (self.delegate && [self.delegate respondsToSelector:@selector(remoteImageView:didFailWithError:)]) {
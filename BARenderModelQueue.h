@@ -0,0 +1,59 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class BARenderModelQueue;
+
+
+@protocol BARenderModelQueueDelegate <NSObject>
+
+// Called on a background queue, should be thread safe and return an immutable object or nil
+- (id)renderModelQueue:(BARenderModelQueue *)queue renderModelForKey:(id)key;
+
+@end
+
+
+@interface BARenderModelQueue : NSObject
+
+// Render models are prepared on a queue as wide as number of processors and kept by key until they
+// are taken or cancelled. Keys are copied like dictionary keys. Main thread only.
+
+@property(nonatomic, assign) id<BARenderModelQueueDelegate> delegate; // retained while its operations run, released on the main thread
+
+// Keys should go nearest first, operations for the first ones get higher priority.
+// Keys which are prepared or being prepared are skipped.
+- (void)prepareRenderModelsForKeys:(NSArray *)keys;
+
+- (id)renderModelForKey:(id)key; // nil if not prepared yet
+- (id)takeRenderModelForKey:(id)key; // prepared model is removed
+- (void)cancelRenderModelsForKeys:(NSArray *)keys;
+- (void)cancelRenderModelsPassingTest:(BOOL (^)(id key))predicate;
+- (void)cancelAllRenderModels;
+
+@end
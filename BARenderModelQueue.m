@@ -0,0 +1,149 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BARenderModelQueue.h"
+
+@implementation BARenderModelQueue {
+@private
+	NSOperationQueue *_queue;
+	NSMutableDictionary *_renderModels; // key -> prepared render model
+	NSMutableDictionary *_operations; // key -> NSOperation
+	id<BARenderModelQueueDelegate> _delegate;
+}
+
+@synthesize delegate = _delegate;
+
+- (id)init {
+	if ((self = [super init])) {
+		_queue = [[NSOperationQueue alloc] init];
+		_queue.maxConcurrentOperationCount = MAX([[NSProcessInfo processInfo] activeProcessorCount], 1);
+		_renderModels = [[NSMutableDictionary alloc] init];
+		_operations = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_queue cancelAllOperations];
+	[_queue release];
+	[_renderModels release];
+	[_operations release];
+	[super dealloc];
+}
+
+- (void)prepareRenderModelsForKeys:(NSArray *)keys {
+	id<BARenderModelQueueDelegate> delegate = _delegate;
+	if (!delegate) {
+		return;
+	}
+	const NSInteger width = _queue.maxConcurrentOperationCount;
+	NSInteger order = 0;
+	for (id key in keys) {
+		if ([_renderModels objectForKey:key] || [_operations objectForKey:key]) {
+			continue;
+		}
+		NSBlockOperation *operation = [[[NSBlockOperation alloc] init] autorelease];
+		// nearest keys are ahead of farther ones queued earlier
+		if (order < width) {
+			operation.queuePriority = NSOperationQueuePriorityHigh;
+		} else if (order < 4 * width) {
+			operation.queuePriority = NSOperationQueuePriorityNormal;
+		} else {
+			operation.queuePriority = NSOperationQueuePriorityLow;
+		}
+		order++;
+		__block NSBlockOperation *blockOperation = operation; // operation retains the block
+		// Delegate owns views, so it is released on the main queue when the operation finishes,
+		// cancelled or not, instead of by the block on a worker thread
+		__block id<BARenderModelQueueDelegate> blockDelegate = [delegate retain];
+		__block BARenderModelQueue *queue = [self retain];
+		operation.completionBlock = ^{
+			dispatch_async(dispatch_get_main_queue(), ^{
+				[blockDelegate release];
+				[queue release];
+			});
+		};
+		[operation addExecutionBlock:^{
+			if ([blockOperation isCancelled]) {
+				return;
+			}
+			id renderModel = [blockDelegate renderModelQueue:queue renderModelForKey:key];
+			NSOperation *finishedOperation = blockOperation;
+			dispatch_async(dispatch_get_main_queue(), ^{
+				// cancelled or replaced operations leave no model
+				if ([queue->_operations objectForKey:key] != finishedOperation) {
+					return;
+				}
+				if (renderModel && ![finishedOperation isCancelled]) {
+					[queue->_renderModels setObject:renderModel forKey:key];
+				}
+				[queue->_operations removeObjectForKey:key];
+			});
+		}];
+		[_operations setObject:operation forKey:key];
+		[_queue addOperation:operation];
+	}
+}
+
+- (id)renderModelForKey:(id)key {
+	return [[[_renderModels objectForKey:key] retain] autorelease];
+}
+
+- (id)takeRenderModelForKey:(id)key {
+	id renderModel = [[[_renderModels objectForKey:key] retain] autorelease];
+	[_renderModels removeObjectForKey:key];
+	return renderModel;
+}
+
+- (void)cancelRenderModelsForKeys:(NSArray *)keys {
+	for (id key in keys) {
+		[[_operations objectForKey:key] cancel];
+		[_operations removeObjectForKey:key];
+		[_renderModels removeObjectForKey:key];
+	}
+}
+
+- (void)cancelRenderModelsPassingTest:(BOOL (^)(id key))predicate {
+	NSMutableSet *keys = [NSMutableSet setWithArray:[_operations allKeys]];
+	[keys addObjectsFromArray:[_renderModels allKeys]];
+	NSMutableArray *cancelledKeys = [NSMutableArray array];
+	for (id key in keys) {
+		if (predicate(key)) {
+			[cancelledKeys addObject:key];
+		}
+	}
+	[self cancelRenderModelsForKeys:cancelledKeys];
+}
+
+- (void)cancelAllRenderModels {
+	[_queue cancelAllOperations];
+	[_operations removeAllObjects];
+	[_renderModels removeAllObjects];
+}
+
+@end
@@ -27,10 +27,13 @@
  */
 
 #import <Foundation/Foundation.h>
+#import "BAJSONStringTable.h"
 
 @interface BARuntime : NSObject
 
 + (id)parseJSONData:(NSData *)data error:(NSError **)error;
+// Uses built-in parser which shares keys (and short values if enabled) through the table.
++ (id)parseJSONData:(NSData *)data stringTable:(BAJSONStringTable *)stringTable error:(NSError **)error;
 + (NSData *)serializeJSONToData:(id)JSONValue error:(NSError **)error;
 + (NSString *)serializeJSONToString:(id)JSONValue error:(NSError **)error;
 + (NSString *)serializeJSONToString:(id)JSONValue formatted:(BOOL)formatted error:(NSError **)error;
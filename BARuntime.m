@@ -27,8 +27,118 @@
  */
 
 #import "BARuntime.h"
+#import "BAJSONScanner.h"
 #import <objc/message.h>
 
+#define kBARuntimeMaxJSONDepth 512
+
+// Returns retained value
+static id BARuntimeNewJSONValue(BAJSONScanner *scanner, BAJSONStringTable *stringTable, NSUInteger depth) {
+	if (depth > kBARuntimeMaxJSONDepth) {
+		scanner->error = "Nesting is too deep";
+		return nil;
+	}
+	const BAJSONValueType type = BAJSONScannerPeek(scanner);
+	switch (type) {
+		case BAJSONValueTypeObject: {
+			scanner->p++;
+			NSMutableDictionary *dictionary = [[NSMutableDictionary alloc] init];
+			if (BAJSONScannerSkip(scanner, '}')) {
+				return dictionary;
+			}
+			do {
+				if (!BAJSONScannerScanString(scanner) || !BAJSONScannerExpect(scanner, ':')) {
+					[dictionary release];
+					return nil;
+				}
+				NSString *key = [stringTable newStringWithBytes:scanner->string length:scanner->stringLength];
+				if (!key) {
+					scanner->error = "Invalid UTF-8 in object key";
+					[dictionary release];
+					return nil;
+				}
+				id value = BARuntimeNewJSONValue(scanner, stringTable, depth + 1);
+				if (!value) {
+					[key release];
+					[dictionary release];
+					return nil;
+				}
+				[dictionary setObject:value forKey:key];
+				[key release];
+				[value release];
+			} while (BAJSONScannerSkip(scanner, ','));
+			if (!BAJSONScannerExpect(scanner, '}')) {
+				[dictionary release];
+				return nil;
+			}
+			return dictionary;
+		}
+		case BAJSONValueTypeArray: {
+			scanner->p++;
+			NSMutableArray *array = [[NSMutableArray alloc] init];
+			if (BAJSONScannerSkip(scanner, ']')) {
+				return array;
+			}
+			do {
+				id value = BARuntimeNewJSONValue(scanner, stringTable, depth + 1);
+				if (!value) {
+					[array release];
+					return nil;
+				}
+				[array addObject:value];
+				[value release];
+			} while (BAJSONScannerSkip(scanner, ','));
+			if (!BAJSONScannerExpect(scanner, ']')) {
+				[array release];
+				return nil;
+			}
+			return array;
+		}
+		case BAJSONValueTypeString: {
+			if (!BAJSONScannerScanString(scanner)) {
+				return nil;
+			}
+			NSString *string;
+			if (scanner->stringLength <= stringTable.maxValueLength) {
+				string = [stringTable newStringWithBytes:scanner->string length:scanner->stringLength];
+			} else {
+				string = [[NSString alloc] initWithBytes:scanner->string
+												  length:scanner->stringLength
+												encoding:NSUTF8StringEncoding];
+			}
+			if (!string) {
+				scanner->error = "Invalid UTF-8 in string";
+			}
+			return string;
+		}
+		case BAJSONValueTypeNumber:
+			if (!BAJSONScannerScanNumber(scanner)) {
+				return nil;
+			}
+			if (scanner->integer) {
+				return [[NSNumber alloc] initWithLongLong:scanner->integerValue];
+			}
+			return [[NSNumber alloc] initWithDouble:scanner->doubleValue];
+		case BAJSONValueTypeTrue:
+		case BAJSONValueTypeFalse:
+			if (!BAJSONScannerScanLiteral(scanner, type)) {
+				return nil;
+			}
+			return [[NSNumber alloc] initWithBool:(type == BAJSONValueTypeTrue)];
+		case BAJSONValueTypeNull:
+			if (!BAJSONScannerScanLiteral(scanner, type)) {
+				return nil;
+			}
+			return [[NSNull null] retain];
+		case BAJSONValueTypeNone:
+			break;
+	}
+	if (!scanner->error) {
+		scanner->error = (scanner->p >= scanner->end) ? "Unexpected end of data" : "Unexpected character";
+	}
+	return nil;
+}
+
 @implementation BARuntime
 
 + (id)parseJSONData:(NSData *)data error:(NSError **)error {
@@ -74,6 +184,29 @@
 	return nil;
 }
 
++ (id)parseJSONData:(NSData *)data stringTable:(BAJSONStringTable *)stringTable error:(NSError **)error {
+	if (!data || [data length] == 0) {
+		return nil;
+	}
+	if (!stringTable) {
+		return [self parseJSONData:data error:error];
+	}
+
+	BAJSONScanner scanner;
+	BAJSONScannerInit(&scanner, [data bytes], [data length]);
+	id JSONValue = BARuntimeNewJSONValue(&scanner, stringTable, 0);
+	if (JSONValue && !BAJSONScannerAtEnd(&scanner)) {
+		scanner.error = "Unexpected data after JSON value";
+		[JSONValue release];
+		JSONValue = nil;
+	}
+	if (!JSONValue && error) {
+		*error = BAJSONScannerError(&scanner);
+	}
+	BAJSONScannerDestroy(&scanner);
+	return [JSONValue autorelease];
+}
+
 + (NSData *)serializeJSONToData:(id)JSONValue error:(NSError **)error {
 	if (!JSONValue) {
 		return nil;
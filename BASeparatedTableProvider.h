@@ -46,6 +46,16 @@ typedef NSUInteger BACellSeparatorPositions;
 - (CGFloat)tableView:(UITableView *)tableView heightForTopSeparatorRowAtIndexPath:(NSIndexPath *)indexPath;
 - (CGFloat)tableView:(UITableView *)tableView heightForBottomSeparatorRowAtIndexPath:(NSIndexPath *)indexPath;
 
+@optional
+
+// Used by flattened provider instead of adding separator views to the cell; cell could draw them itself
+- (void)tableView:(UITableView *)tableView
+configureSeparatorsOfCell:(UITableViewCell *)cell
+		positions:(BACellSeparatorPositions)positions
+		topHeight:(CGFloat)topHeight
+	 bottomHeight:(CGFloat)bottomHeight
+forRowAtIndexPath:(NSIndexPath *)indexPath;
+
 @end
 
 
@@ -53,7 +63,15 @@ typedef NSUInteger BACellSeparatorPositions;
 
 @property(nonatomic, assign) id<BASeparatedTableProviderDelegate> delegate;
 
+// Flattened provider does not add separator rows; separators are shown at the top and bottom edges of
+// row cells and row heights include them, so cells for separator rows are not asked for. Content view
+// of the cell is inset by separator heights unless the delegate configures separators itself. Separator
+// positions and heights are cached per row until the table reloads rows of the section. Default is NO
+@property(nonatomic, assign) BOOL flattened;
+@property(nonatomic, retain) UIColor *separatorColor; // of separator views of flattened provider. default is light gray
+
 - (NSIndexPath *)separatedIndexPathForIndexPath:(NSIndexPath *)indexPath;
 - (NSArray *)separatedIndexPathsForIndexPaths:(NSArray *)indexPaths;
+- (void)invalidateSeparators;
 
 @end
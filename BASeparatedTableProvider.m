@@ -27,8 +27,40 @@
  */
 
 #import "BASeparatedTableProvider.h"
+#import "UIView+BACookie.h"
+
+static NSString * const kTopSeparatorCookie = @"BASeparatedTableProviderTopSeparator";
+static NSString * const kBottomSeparatorCookie = @"BASeparatedTableProviderBottomSeparator";
+
+typedef struct {
+	BOOL valid;
+	BACellSeparatorPositions positions;
+	CGFloat topHeight;
+	CGFloat bottomHeight;
+} BASeparatorInfo;
+
+@implementation BASeparatedTableProvider {
+@private
+	BOOL _flattened;
+	UIColor *_separatorColor;
+	NSMutableDictionary *_separators; // NSNumber of section -> NSMutableData:BASeparatorInfo
+}
+
+@synthesize separatorColor = _separatorColor;
 
-@implementation BASeparatedTableProvider
+- (id)init {
+	if ((self = [super init])) {
+		_separators = [[NSMutableDictionary alloc] init];
+		_separatorColor = [[UIColor lightGrayColor] retain];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_separators release];
+	[_separatorColor release];
+	[super dealloc];
+}
 
 - (id<BASeparatedTableProviderDelegate>)delegate {
 	return (id<BASeparatedTableProviderDelegate>)[super delegate];
@@ -36,9 +68,22 @@
 
 - (void)setDelegate:(id<BASeparatedTableProviderDelegate>)delegate {
 	[super setDelegate:delegate];
+	[self invalidateSeparators];
+}
+
+- (BOOL)flattened {
+	return _flattened;
+}
+
+- (void)setFlattened:(BOOL)flattened {
+	_flattened = flattened;
+	[self invalidateSeparators];
 }
 
 - (NSIndexPath *)separatedIndexPathForIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		return indexPath;
+	}
 	return [NSIndexPath indexPathForRow:((indexPath.row * 3) + 1) inSection:indexPath.section];
 }
 
@@ -46,6 +91,9 @@
 	if (!indexPaths) {
 		return nil;
 	}
+	if (_flattened) {
+		return indexPaths;
+	}
 	NSMutableArray *separatedIndexPaths = [NSMutableArray arrayWithCapacity:([indexPaths count] * 3)];
 	for (NSIndexPath *indexPath in indexPaths) {
 		[separatedIndexPaths addObject:[NSIndexPath indexPathForRow:((indexPath.row * 3) + 0) inSection:indexPath.section]];
@@ -55,16 +103,98 @@
 	return separatedIndexPaths;
 }
 
+- (void)invalidateSeparators {
+	[_separators removeAllObjects];
+}
+
+// Positions and heights of separators are queried once per row
+- (BASeparatorInfo)separatorInfoForTableView:(UITableView *)tableView row:(NSIndexPath *)sourceIndexPath {
+	NSNumber *key = [NSNumber numberWithInteger:sourceIndexPath.section];
+	NSMutableData *sectionInfo = [_separators objectForKey:key];
+	if (!sectionInfo) {
+		sectionInfo = [NSMutableData data];
+		[_separators setObject:sectionInfo forKey:key];
+	}
+	const NSUInteger row = sourceIndexPath.row;
+	if ([sectionInfo length] < (row + 1) * sizeof(BASeparatorInfo)) {
+		[sectionInfo setLength:(row + 1) * sizeof(BASeparatorInfo)]; // zeroed
+	}
+	BASeparatorInfo *info = (BASeparatorInfo *)[sectionInfo mutableBytes] + row;
+	if (!info->valid) {
+		info->positions = [self.delegate tableView:tableView separatorPositionsForRow:sourceIndexPath];
+		info->topHeight = (info->positions & BACellSeparatorPositionTop) ?
+		[self.delegate tableView:tableView heightForTopSeparatorRowAtIndexPath:sourceIndexPath] : 0;
+		info->bottomHeight = (info->positions & BACellSeparatorPositionBottom) ?
+		[self.delegate tableView:tableView heightForBottomSeparatorRowAtIndexPath:sourceIndexPath] : 0;
+		info->valid = YES;
+	}
+	return *info;
+}
+
+- (UIView *)separatorViewOfCell:(UITableViewCell *)cell cookie:(NSString *)cookie {
+	for (UIView *subview in cell.subviews) {
+		if (subview.cookie == cookie) {
+			return subview;
+		}
+	}
+	UIView *separatorView = [[[UIView alloc] init] autorelease];
+	separatorView.cookie = cookie;
+	separatorView.userInteractionEnabled = NO;
+	[cell addSubview:separatorView];
+	return separatorView;
+}
+
+- (void)addSeparatorsToCell:(UITableViewCell *)cell info:(BASeparatorInfo)info {
+	const CGFloat width = cell.bounds.size.width;
+	const CGFloat height = cell.bounds.size.height;
+	UIView *topView = [self separatorViewOfCell:cell cookie:kTopSeparatorCookie];
+	topView.hidden = (info.topHeight <= 0);
+	topView.backgroundColor = self.separatorColor;
+	topView.frame = CGRectMake(0, 0, width, info.topHeight);
+	topView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleBottomMargin;
+	UIView *bottomView = [self separatorViewOfCell:cell cookie:kBottomSeparatorCookie];
+	bottomView.hidden = (info.bottomHeight <= 0);
+	bottomView.backgroundColor = self.separatorColor;
+	bottomView.frame = CGRectMake(0, height - info.bottomHeight, width, info.bottomHeight);
+	bottomView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleTopMargin;
+	[self insetContentOfCell:cell info:info];
+}
+
+// Content view is placed between separator views so they do not cover it
+- (void)insetContentOfCell:(UITableViewCell *)cell info:(BASeparatorInfo)info {
+	CGRect contentFrame = cell.contentView.frame;
+	contentFrame.origin.y = info.topHeight;
+	contentFrame.size.height = MAX(0, cell.bounds.size.height - info.topHeight - info.bottomHeight);
+	cell.contentView.frame = contentFrame;
+}
+
 
 
 // Table Data Source
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
+	// rows are reloaded
+	[_separators removeObjectForKey:[NSNumber numberWithInteger:section]];
 	NSInteger rowsCount = [self.delegate tableView:tableView numberOfRowsInSection:section];
-	return rowsCount * 3;
+	return _flattened ? rowsCount : rowsCount * 3;
 }
 
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		UITableViewCell *cell = [self.delegate tableView:tableView cellForRowAtIndexPath:indexPath];
+		const BASeparatorInfo info = [self separatorInfoForTableView:tableView row:indexPath];
+		if ([self.delegate respondsToSelector:@selector(tableView:configureSeparatorsOfCell:positions:topHeight:bottomHeight:forRowAtIndexPath:)]) {
+			[self.delegate tableView:tableView
+		   configureSeparatorsOfCell:cell
+						   positions:info.positions
+						   topHeight:info.topHeight
+						bottomHeight:info.bottomHeight
+				   forRowAtIndexPath:indexPath];
+		} else {
+			[self addSeparatorsToCell:cell info:info];
+		}
+		return cell;
+	}
 	NSIndexPath *sourceIndexPath = [NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section];
 	switch (indexPath.row % 3) {
 		case 0: return [self.delegate tableView:tableView topSeparatorCellForRowAtIndexPath:sourceIndexPath];
@@ -96,6 +226,12 @@
 //}
 
 - (BOOL)tableView:(UITableView *)tableView canEditRowAtIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		if ([self.delegate respondsToSelector:@selector(tableView:canEditRowAtIndexPath:)]) {
+			return [self.delegate tableView:tableView canEditRowAtIndexPath:indexPath];
+		}
+		return NO;
+	}
 	if ((indexPath.row % 3 == 1) && [self.delegate respondsToSelector:@selector(tableView:canEditRowAtIndexPath:)]) {
 		NSIndexPath *sourceIndexPath = [NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section];
 		return [self.delegate tableView:tableView canEditRowAtIndexPath:sourceIndexPath];
@@ -113,6 +249,12 @@
 commitEditingStyle:(UITableViewCellEditingStyle)editingStyle
 forRowAtIndexPath:(NSIndexPath *)indexPath
 {
+	if (_flattened) {
+		if ([self.delegate respondsToSelector:@selector(tableView:commitEditingStyle:forRowAtIndexPath:)]) {
+			[self.delegate tableView:tableView commitEditingStyle:editingStyle forRowAtIndexPath:indexPath];
+		}
+		return;
+	}
 	if ((indexPath.row % 3 == 1) && [self.delegate respondsToSelector:@selector(tableView:commitEditingStyle:forRowAtIndexPath:)]) {
 		NSIndexPath *sourceIndexPath = [NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section];
 		[self.delegate tableView:tableView commitEditingStyle:editingStyle forRowAtIndexPath:sourceIndexPath];
@@ -125,30 +267,43 @@ forRowAtIndexPath:(NSIndexPath *)indexPath
 
 // Table Delegate
 
-//- (void)tableView:(UITableView *)tableView willDisplayCell:(UITableViewCell *)cell forRowAtIndexPath:(NSIndexPath *)indexPath;
+- (void)tableView:(UITableView *)tableView willDisplayCell:(UITableViewCell *)cell forRowAtIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		// cell has its final size and layout only now
+		if (![self.delegate respondsToSelector:@selector(tableView:configureSeparatorsOfCell:positions:topHeight:bottomHeight:forRowAtIndexPath:)]) {
+			[self insetContentOfCell:cell info:[self separatorInfoForTableView:tableView row:indexPath]];
+		}
+		if ([self.delegate respondsToSelector:@selector(tableView:willDisplayCell:forRowAtIndexPath:)]) {
+			[self.delegate tableView:tableView willDisplayCell:cell forRowAtIndexPath:indexPath];
+		}
+		return;
+	}
+	if ((indexPath.row % 3 == 1) && [self.delegate respondsToSelector:@selector(tableView:willDisplayCell:forRowAtIndexPath:)]) {
+		NSIndexPath *sourceIndexPath = [NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section];
+		[self.delegate tableView:tableView willDisplayCell:cell forRowAtIndexPath:sourceIndexPath];
+	}
+}
 
 - (CGFloat)tableView:(UITableView *)tableView heightForRowAtIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		const BASeparatorInfo info = [self separatorInfoForTableView:tableView row:indexPath];
+		CGFloat height = info.topHeight + info.bottomHeight;
+		if ([self.delegate respondsToSelector:@selector(tableView:heightForRowAtIndexPath:)]) {
+			height += [self.delegate tableView:tableView heightForRowAtIndexPath:indexPath];
+		}
+		return height;
+	}
 	NSIndexPath *sourceIndexPath = [NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section];
 	switch (indexPath.row % 3) {
-		case 0: {
-			const BACellSeparatorPositions positions = [self.delegate tableView:tableView separatorPositionsForRow:sourceIndexPath];
-			if (positions & BACellSeparatorPositionTop) {
-				return [self.delegate tableView:tableView heightForTopSeparatorRowAtIndexPath:sourceIndexPath];
-			}
-			return 0;
-		}
+		case 0:
+			return [self separatorInfoForTableView:tableView row:sourceIndexPath].topHeight;
 		case 1: 
 			if ([self.delegate respondsToSelector:@selector(tableView:heightForRowAtIndexPath:)]) {
 				return [self.delegate tableView:tableView heightForRowAtIndexPath:sourceIndexPath];
 			}
 			return 0;
-		case 2: {
-			const BACellSeparatorPositions positions = [self.delegate tableView:tableView separatorPositionsForRow:sourceIndexPath];
-			if (positions & BACellSeparatorPositionBottom) {
-				return [self.delegate tableView:tableView heightForBottomSeparatorRowAtIndexPath:sourceIndexPath];
-			}
-			return 0;
-		}
+		case 2:
+			return [self separatorInfoForTableView:tableView row:sourceIndexPath].bottomHeight;
 	}
 	return 0;
 }
@@ -165,6 +320,12 @@ forRowAtIndexPath:(NSIndexPath *)indexPath
 //- (NSIndexPath *)tableView:(UITableView *)tableView willDeselectRowAtIndexPath:(NSIndexPath *)indexPath;
 
 - (void)tableView:(UITableView *)tableView didSelectRowAtIndexPath:(NSIndexPath *)indexPath {
+	if (_flattened) {
+		if ([self.delegate respondsToSelector:@selector(tableView:didSelectRowAtIndexPath:)]) {
+			[self.delegate tableView:tableView didSelectRowAtIndexPath:indexPath];
+		}
+		return;
+	}
 	if ((indexPath.row % 3 == 1) && [self.delegate respondsToSelector:@selector(tableView:didSelectRowAtIndexPath:)]) {
 		[self.delegate tableView:tableView
 		 didSelectRowAtIndexPath:[NSIndexPath indexPathForRow:(indexPath.row / 3) inSection:indexPath.section]];
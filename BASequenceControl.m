@@ -27,6 +27,7 @@
  */
 
 #import "BASequenceControl.h"
+#import "BATextMeasurer.h"
 
 @interface BASequenceControl()
 
@@ -182,7 +183,7 @@
 				}
 				[image drawInRect:CGRectMake(right - sw - p, 0, p + sw, h)];
 				NSString *title = [self titleForSegmentAtIndex:segment];
-				const CGSize titleSize = [title sizeWithFont:titleFont];
+				const CGSize titleSize = [[BATextMeasurer sharedMeasurer] sizeOfText:title withFont:titleFont];
 				const CGFloat titleWidth = MIN(sw - p, titleSize.width);
 				CGRect titleFrame = CGRectMake(rint(right - sw + (sw - p - titleWidth) / 2),
 											   rint((h - titleSize.height) / 2),
@@ -0,0 +1,57 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <UIKit/UIKit.h>
+
+// Measures text and keeps sizes in a cache
+// 
+// Sizes are keyed by text, font, constraint, number of lines and line break mode; least recently
+// used ones are evicted when capacity is reached. Measurer could be used from any thread, so heights
+// of rows could be computed ahead of layout on a background queue. Zero number of lines means
+// no limit; width and height are not constrained when they are CGFLOAT_MAX.
+
+@interface BATextMeasurer : NSObject
+
+@property NSUInteger capacity; // in sizes. default is 1000
+@property(readonly) NSUInteger hitsCount;
+@property(readonly) NSUInteger missesCount;
+@property(readonly) NSTimeInterval measuringTime; // spent measuring missed sizes
+
++ (BATextMeasurer *)sharedMeasurer;
+
+- (CGSize)sizeOfText:(NSString *)text withFont:(UIFont *)font; // single line
+- (CGSize)sizeOfText:(NSString *)text
+			withFont:(UIFont *)font
+   constrainedToSize:(CGSize)size
+	   numberOfLines:(NSInteger)numberOfLines
+	   lineBreakMode:(UILineBreakMode)lineBreakMode;
+
+- (void)removeAllSizes;
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,278 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BATextMeasurer.h"
+
+#define kDefaultCapacity 1000
+
+// Cached size, also serves as a key; list is ordered from most to least recently used
+
+@interface BATextMeasurement : NSObject {
+@public
+	NSString *_text;
+	UIFont *_font;
+	CGSize _constraint;
+	NSInteger _numberOfLines;
+	UILineBreakMode _lineBreakMode;
+	NSUInteger _hash;
+	CGSize _size;
+	BATextMeasurement *_prev; // not retained
+	BATextMeasurement *_next; // not retained
+}
+
+- (id)initWithText:(NSString *)text
+			  font:(UIFont *)font
+		constraint:(CGSize)constraint
+	 numberOfLines:(NSInteger)numberOfLines
+	 lineBreakMode:(UILineBreakMode)lineBreakMode;
+
+@end
+
+@implementation BATextMeasurement
+
+- (id)initWithText:(NSString *)text
+			  font:(UIFont *)font
+		constraint:(CGSize)constraint
+	 numberOfLines:(NSInteger)numberOfLines
+	 lineBreakMode:(UILineBreakMode)lineBreakMode
+{
+	if ((self = [super init])) {
+		_text = [text copy];
+		_font = [font retain];
+		_constraint = constraint;
+		_numberOfLines = numberOfLines;
+		_lineBreakMode = lineBreakMode;
+		_hash = [_text hash] ^ [_font hash] ^ ((NSUInteger)numberOfLines << 8) ^ (NSUInteger)lineBreakMode;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_text release];
+	[_font release];
+	[super dealloc];
+}
+
+- (NSUInteger)hash {
+	return _hash;
+}
+
+- (BOOL)isEqual:(id)object {
+	if (![object isKindOfClass:[BATextMeasurement class]]) {
+		return NO;
+	}
+	BATextMeasurement *other = object;
+	return _hash == other->_hash &&
+	CGSizeEqualToSize(_constraint, other->_constraint) &&
+	_numberOfLines == other->_numberOfLines &&
+	_lineBreakMode == other->_lineBreakMode &&
+	[_font isEqual:other->_font] &&
+	[_text isEqualToString:other->_text];
+}
+
+@end
+
+
+@implementation BATextMeasurer {
+@private
+	NSUInteger _capacity;
+	NSMutableSet *_measurements;
+	BATextMeasurement *_first; // most recently used
+	BATextMeasurement *_last;
+	NSUInteger _hitsCount;
+	NSUInteger _missesCount;
+	NSTimeInterval _measuringTime;
+}
+
++ (BATextMeasurer *)sharedMeasurer {
+	static BATextMeasurer *measurer;
+	static dispatch_once_t once; // could be called from any thread
+	dispatch_once(&once, ^{
+		measurer = [[BATextMeasurer alloc] init];
+	});
+	return measurer;
+}
+
+- (id)init {
+	if ((self = [super init])) {
+		_capacity = kDefaultCapacity;
+		_measurements = [[NSMutableSet alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[_measurements release];
+	[super dealloc];
+}
+
+- (NSUInteger)capacity {
+	@synchronized(self) {
+		return _capacity;
+	}
+}
+
+- (void)setCapacity:(NSUInteger)capacity {
+	@synchronized(self) {
+		_capacity = capacity;
+		[self evictMeasurements];
+	}
+}
+
+- (NSUInteger)hitsCount {
+	@synchronized(self) {
+		return _hitsCount;
+	}
+}
+
+- (NSUInteger)missesCount {
+	@synchronized(self) {
+		return _missesCount;
+	}
+}
+
+- (NSTimeInterval)measuringTime {
+	@synchronized(self) {
+		return _measuringTime;
+	}
+}
+
+- (void)resetStatistics {
+	@synchronized(self) {
+		_hitsCount = 0;
+		_missesCount = 0;
+		_measuringTime = 0;
+	}
+}
+
+- (void)removeAllSizes {
+	@synchronized(self) {
+		_first = nil;
+		_last = nil;
+		[_measurements removeAllObjects];
+	}
+}
+
+// List operations are called while locked
+
+- (void)unlinkMeasurement:(BATextMeasurement *)measurement {
+	if (measurement->_prev) {
+		measurement->_prev->_next = measurement->_next;
+	} else {
+		_first = measurement->_next;
+	}
+	if (measurement->_next) {
+		measurement->_next->_prev = measurement->_prev;
+	} else {
+		_last = measurement->_prev;
+	}
+	measurement->_prev = nil;
+	measurement->_next = nil;
+}
+
+- (void)linkFirstMeasurement:(BATextMeasurement *)measurement {
+	measurement->_next = _first;
+	if (_first) {
+		_first->_prev = measurement;
+	}
+	_first = measurement;
+	if (!_last) {
+		_last = measurement;
+	}
+}
+
+- (void)evictMeasurements {
+	while ([_measurements count] > _capacity && _last) {
+		BATextMeasurement *measurement = _last;
+		[self unlinkMeasurement:measurement];
+		[_measurements removeObject:measurement];
+	}
+}
+
+- (CGSize)sizeOfText:(NSString *)text withFont:(UIFont *)font {
+	return [self sizeOfText:text
+				   withFont:font
+		  constrainedToSize:CGSizeMake(CGFLOAT_MAX, CGFLOAT_MAX)
+			  numberOfLines:1
+			  lineBreakMode:UILineBreakModeWordWrap];
+}
+
+- (CGSize)sizeOfText:(NSString *)text
+			withFont:(UIFont *)font
+   constrainedToSize:(CGSize)size
+	   numberOfLines:(NSInteger)numberOfLines
+	   lineBreakMode:(UILineBreakMode)lineBreakMode
+{
+	if (!text || !font) {
+		return CGSizeZero;
+	}
+	BATextMeasurement *measurement = [[BATextMeasurement alloc] initWithText:text
+																		 font:font
+																   constraint:size
+																numberOfLines:numberOfLines
+																lineBreakMode:lineBreakMode];
+	@synchronized(self) {
+		BATextMeasurement *cachedMeasurement = [_measurements member:measurement];
+		if (cachedMeasurement) {
+			_hitsCount++;
+			[self unlinkMeasurement:cachedMeasurement];
+			[self linkFirstMeasurement:cachedMeasurement];
+			[measurement release];
+			return cachedMeasurement->_size;
+		}
+		_missesCount++;
+	}
+	
+	// measured outside of the lock so threads do not wait for each other
+	const NSTimeInterval startTime = [NSDate timeIntervalSinceReferenceDate];
+	CGSize textSize;
+	if (numberOfLines == 1) {
+		textSize = [text sizeWithFont:font forWidth:size.width lineBreakMode:lineBreakMode];
+	} else {
+		CGSize constraint = size;
+		if (numberOfLines > 0) {
+			constraint.height = MIN(constraint.height, numberOfLines * font.lineHeight);
+		}
+		textSize = [text sizeWithFont:font constrainedToSize:constraint lineBreakMode:lineBreakMode];
+	}
+	const NSTimeInterval time = [NSDate timeIntervalSinceReferenceDate] - startTime;
+	measurement->_size = textSize;
+	
+	@synchronized(self) {
+		_measuringTime += time;
+		if (![_measurements member:measurement]) {
+			[_measurements addObject:measurement];
+			[self linkFirstMeasurement:measurement];
+			[self evictMeasurements];
+		}
+	}
+	[measurement release];
+	return textSize;
+}
+
+@end
@@ -29,6 +29,8 @@
 #import <UIKit/UIKit.h>
 #import "BAToggleItem.h"
 
+@class BAViewsCache;
+
 typedef enum {
 //	BAToggleBarTailStateToggleAnimated,
 	BAToggleBarTailStateToggle,
@@ -46,6 +48,8 @@ typedef enum {
 @optional
 - (UIView<BAToggleItem> *)toggleBar:(BAToggleBar *)toggleBar viewForItem:(id)item atIndex:(NSInteger)index;
 - (UIView *)toggleBarSeparatorView:(BAToggleBar *)toggleBar;
+// Used by virtualized bar to measure items without creating views for them
+- (CGSize)toggleBar:(BAToggleBar *)toggleBar sizeForItem:(id)item atIndex:(NSInteger)index;
 
 @end
 
@@ -61,6 +65,15 @@ typedef enum {
 	NSMutableArray *_itemViews; // [UIView<BAToggleItem>]
 	NSMutableArray *_items;
 	NSInteger _selectedItemIndex;
+	BOOL _virtualized;
+	BAViewsCache *_reusableViews;
+	NSMutableDictionary *_visibleItemViews; // NSNumber -> UIView<BAToggleItem>
+	NSMutableDictionary *_visibleSeparatorViews; // NSNumber of item after separator -> UIView
+	CGFloat *_itemXs;
+	CGFloat *_itemWidths;
+	CGFloat _measuredHeight; // negative when items are not measured
+	CGSize _separatorSize;
+	BOOL _hasSeparators;
 }
 
 @property(nonatomic, assign) BOOL centered;
@@ -73,6 +86,12 @@ typedef enum {
 @property(nonatomic, assign) NSInteger selectedItemIndex;
 @property(nonatomic, assign) IBOutlet id<BAToggleBarDelegate> delegate;
 
+// Virtualized bar measures items once and creates views only for items in and around the visible
+// part of the bar. Views which scroll away are reused; item views responding to reuseIdentifier
+// could be dequeued by the delegate. Separators are assumed to be of the same size. Default is NO
+@property(nonatomic, assign) BOOL virtualized;
+
 - (void)setSelectedItemIndex:(NSInteger)selectedItemIndex revealingItem:(BOOL)revealingItem;
+- (UIView<BAToggleItem> *)dequeueReusableItemViewWithIdentifier:(NSString *)identifier;
 
 @end
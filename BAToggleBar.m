@@ -28,13 +28,19 @@
 
 #import "BAToggleBar.h"
 #import "BAToggleItemLabel.h"
+#import "BAViewsCache.h"
+#import "UIView+BACookie.h"
 
 #define kToggleTailWidth 30
 #define kToggleAnimationDuration 1
+#define kVirtualizedMarginRatio 0.5 // of bar width on each side
+
+static NSString * const kDefaultItemViewIdentifier = @"BAToggleBarDefaultItem";
+static NSString * const kSeparatorViewIdentifier = @"BAToggleBarSeparator";
 
 @interface BAToggleBar ()
 
-@property(nonatomic, readonly) NSArray *itemViews;
+- (NSUInteger)indexOfItemView:(UIView *)view;
 
 @end
 
@@ -48,7 +54,7 @@
 
 - (BOOL)touchesShouldBegin:(NSSet *)touches withEvent:(UIEvent *)event inContentView:(UIView *)view {
 	BAToggleBar *toggleBar = (BAToggleBar *)self.superview;
-	NSUInteger itemViewIndex = [toggleBar.itemViews indexOfObject:view];
+	NSUInteger itemViewIndex = [toggleBar indexOfItemView:view];
 	if (itemViewIndex != NSNotFound) {
 		[toggleBar setSelectedItemIndex:itemViewIndex revealingItem:NO];
 	}
@@ -62,7 +68,6 @@
 
 @synthesize centered = _centered;
 @synthesize spacing = _spacing;
-@synthesize itemViews = _itemViews;
 @synthesize delegate = _delegate;
 
 - (void)setupView {
@@ -91,6 +96,7 @@
 
 	_itemViews = [[NSMutableArray alloc] init];
 	_items = [[NSMutableArray alloc] init];
+	_measuredHeight = -1;
 }
 
 - (id)initWithFrame:(CGRect)aRect {
@@ -111,6 +117,11 @@
 	[_rightTailView release];
 	[_itemViews release];
 	[_items release];
+	[_reusableViews release];
+	[_visibleItemViews release];
+	[_visibleSeparatorViews release];
+	free(_itemXs);
+	free(_itemWidths);
     [super dealloc];
 }
 
@@ -282,13 +293,46 @@
 }
 
 - (void)updateItemsState {
+	if (_virtualized) {
+		[_visibleItemViews enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+			UIView<BAToggleItem> *itemView = obj;
+			itemView.selected = ([key integerValue] == _selectedItemIndex);
+		}];
+		return;
+	}
 	for (NSUInteger index = 0; index < [_itemViews count]; index++) {
 		UIView<BAToggleItem> *itemView = [_itemViews objectAtIndex:index];
 		itemView.selected = (index == _selectedItemIndex);
 	}
 }
 
+- (NSUInteger)indexOfItemView:(UIView *)view {
+	if (_virtualized) {
+		for (NSNumber *key in _visibleItemViews) {
+			if ([_visibleItemViews objectForKey:key] == view) {
+				return [key unsignedIntegerValue];
+			}
+		}
+		return NSNotFound;
+	}
+	return [_itemViews indexOfObject:view];
+}
+
+- (CGRect)frameOfItemAtIndex:(NSInteger)index {
+	if (_virtualized) {
+		if (_measuredHeight < 0) {
+			[self layoutItemViews];
+		}
+		return CGRectMake(_itemXs[index], 0, _itemWidths[index], self.bounds.size.height);
+	}
+	return [[_itemViews objectAtIndex:index] frame];
+}
+
 - (void)layoutItemViews {
+	if (_virtualized) {
+		[self layoutVirtualizedItems];
+		return;
+	}
 	const CGFloat width = self.bounds.size.width;
 	const CGFloat height = self.bounds.size.height;
 	CGFloat x = 0;
@@ -345,6 +389,9 @@
 //	}
 	_rightTailView.frame = rightFrame;
 	[self updateTailViews:NO];
+	if (_virtualized) {
+		[self layoutVirtualizedItems];
+	}
 }
 
 - (BAToggleItemLabel *)createDefaultItemView:(id)item {
@@ -367,12 +414,20 @@
 		[_items addObjectsFromArray:items];
 	}
 
+	if (_virtualized) {
+		[self recycleVisibleViews];
+	}
 	NSArray *oldSubviews = [[NSArray alloc] initWithArray:_scrollView.subviews];
 	for (UIView *subiew in oldSubviews) {
 		[subiew removeFromSuperview];
 	}
 	[oldSubviews release];
 	[_itemViews removeAllObjects];
+	if (_virtualized) {
+		_measuredHeight = -1;
+		[self layoutItemViews];
+		return;
+	}
 
 	for (NSUInteger itemIndex = 0; itemIndex < [_items count]; itemIndex++) {
 		if (itemIndex > 0 && self.delegate && [self.delegate respondsToSelector:@selector(toggleBarSeparatorView:)]) {
@@ -396,6 +451,222 @@
 	[self layoutItemViews];
 }
 
+#pragma mark -
+#pragma mark virtualized items
+
+- (BOOL)virtualized {
+	return _virtualized;
+}
+
+- (void)setVirtualized:(BOOL)virtualized {
+	if (_virtualized == virtualized) {
+		return;
+	}
+	if (_virtualized) {
+		[self recycleVisibleViews];
+	}
+	_virtualized = virtualized;
+	if (virtualized && !_reusableViews) {
+		_reusableViews = [[BAViewsCache alloc] init];
+		_visibleItemViews = [[NSMutableDictionary alloc] init];
+		_visibleSeparatorViews = [[NSMutableDictionary alloc] init];
+	}
+	self.items = [self items];
+}
+
+- (UIView<BAToggleItem> *)dequeueReusableItemViewWithIdentifier:(NSString *)identifier {
+	return (UIView<BAToggleItem> *)[_reusableViews dequeueReusableViewWithIdentifier:identifier];
+}
+
+- (UIView<BAToggleItem> *)createItemViewAtIndex:(NSInteger)index {
+	id item = [_items objectAtIndex:index];
+	UIView<BAToggleItem> *itemView = nil;
+	if (self.delegate && [self.delegate respondsToSelector:@selector(toggleBar:viewForItem:atIndex:)]) {
+		itemView = [self.delegate toggleBar:self viewForItem:item atIndex:index];
+	}
+	if (!itemView) {
+		BAToggleItemLabel *label = (BAToggleItemLabel *)[self dequeueReusableItemViewWithIdentifier:kDefaultItemViewIdentifier];
+		if (label) {
+			label.text = [item description];
+			itemView = label;
+		} else {
+			itemView = [self createDefaultItemView:item];
+		}
+		itemView.cookie = kDefaultItemViewIdentifier; // marks views which are reused by the bar itself
+	}
+	return itemView;
+}
+
+- (void)recycleItemView:(UIView<BAToggleItem> *)itemView {
+	[itemView removeFromSuperview];
+	if ([itemView.cookie isEqual:kDefaultItemViewIdentifier]) {
+		[_reusableViews enqueueReusableView:itemView withIdentifier:kDefaultItemViewIdentifier];
+	} else if ([itemView respondsToSelector:@selector(reuseIdentifier)]) {
+		[_reusableViews enqueueReusableView:itemView withIdentifier:[(id)itemView reuseIdentifier]];
+	}
+}
+
+- (void)recycleSeparatorView:(UIView *)separatorView {
+	[separatorView removeFromSuperview];
+	[_reusableViews enqueueReusableView:separatorView withIdentifier:kSeparatorViewIdentifier];
+}
+
+- (void)recycleVisibleViews {
+	for (UIView<BAToggleItem> *itemView in [_visibleItemViews allValues]) {
+		[self recycleItemView:itemView];
+	}
+	[_visibleItemViews removeAllObjects];
+	for (UIView *separatorView in [_visibleSeparatorViews allValues]) {
+		[self recycleSeparatorView:separatorView];
+	}
+	[_visibleSeparatorViews removeAllObjects];
+}
+
+// Sizes are cached until items or height change
+- (void)measureItemsWithHeight:(CGFloat)height {
+	const NSInteger count = [_items count];
+	_itemXs = realloc(_itemXs, MAX(count, 1) * sizeof(CGFloat));
+	_itemWidths = realloc(_itemWidths, MAX(count, 1) * sizeof(CGFloat));
+	_hasSeparators = NO;
+	if (count > 1 && self.delegate && [self.delegate respondsToSelector:@selector(toggleBarSeparatorView:)]) {
+		UIView *separatorView = [self.delegate toggleBarSeparatorView:self];
+		if (separatorView) {
+			_hasSeparators = YES;
+			_separatorSize = separatorView.bounds.size;
+			[self recycleSeparatorView:separatorView];
+		}
+	}
+	const BOOL hasSizes = [self.delegate respondsToSelector:@selector(toggleBar:sizeForItem:atIndex:)];
+	for (NSInteger index = 0; index < count; index++) {
+		if (hasSizes) {
+			_itemWidths[index] = [self.delegate toggleBar:self sizeForItem:[_items objectAtIndex:index] atIndex:index].width;
+		} else {
+			UIView<BAToggleItem> *itemView = [self createItemViewAtIndex:index];
+			_itemWidths[index] = [itemView sizeThatFits:CGSizeMake(CGFLOAT_MAX / 2, height)].width;
+			[self recycleItemView:itemView];
+		}
+	}
+	_measuredHeight = height;
+}
+
+- (void)layoutVirtualizedItems {
+	const CGFloat width = self.bounds.size.width;
+	const CGFloat height = self.bounds.size.height;
+	if (_measuredHeight != height) {
+		[self measureItemsWithHeight:height];
+	}
+	const NSInteger count = [_items count];
+	CGFloat x = 0;
+	if (self.leftTailImage) {
+		x += kToggleTailWidth;
+	}
+	for (NSInteger index = 0; index < count; index++) {
+		if (index > 0 && _hasSeparators) {
+			x += _separatorSize.width + self.spacing;
+		}
+		_itemXs[index] = x;
+		x += _itemWidths[index] + self.spacing;
+	}
+	if (self.rightTailImage) {
+		x += kToggleTailWidth;
+	}
+	x -= self.spacing;
+	if (x < width && self.centered) {
+		const CGFloat offset = roundf((width - x) / 2);
+		x = width;
+		for (NSInteger index = 0; index < count; index++) {
+			_itemXs[index] += offset;
+		}
+	}
+	[_scrollView setContentSize:CGSizeMake(x, height)];
+	[self updateTailViews:NO];
+	[self updateVisibleItemViews];
+}
+
+// Items intersecting visible part of the bar with margins have views
+- (NSRange)visibleItems {
+	const NSInteger count = [_items count];
+	if (count == 0 || _measuredHeight < 0) {
+		return NSMakeRange(0, 0);
+	}
+	const CGFloat margin = rint(_scrollView.bounds.size.width * kVirtualizedMarginRatio);
+	const CGFloat minX = _scrollView.contentOffset.x - margin;
+	const CGFloat maxX = _scrollView.contentOffset.x + _scrollView.bounds.size.width + margin;
+	// first item which ends after min x
+	NSInteger low = 0;
+	NSInteger high = count;
+	while (low < high) {
+		const NSInteger mid = (low + high) / 2;
+		if (_itemXs[mid] + _itemWidths[mid] > minX) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	const NSInteger firstItem = low;
+	// first item which starts at or after max x
+	high = count;
+	while (low < high) {
+		const NSInteger mid = (low + high) / 2;
+		if (_itemXs[mid] >= maxX) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return NSMakeRange(firstItem, low - firstItem);
+}
+
+- (void)updateVisibleItemViews {
+	const NSRange items = [self visibleItems];
+	for (NSNumber *key in [_visibleItemViews allKeys]) {
+		if (!NSLocationInRange([key integerValue], items)) {
+			[self recycleItemView:[_visibleItemViews objectForKey:key]];
+			[_visibleItemViews removeObjectForKey:key];
+		}
+	}
+	for (NSNumber *key in [_visibleSeparatorViews allKeys]) {
+		if (!NSLocationInRange([key integerValue], items)) {
+			[self recycleSeparatorView:[_visibleSeparatorViews objectForKey:key]];
+			[_visibleSeparatorViews removeObjectForKey:key];
+		}
+	}
+	const CGFloat height = self.bounds.size.height;
+	for (NSInteger index = items.location; index < items.location + items.length; index++) {
+		NSNumber *key = [NSNumber numberWithInteger:index];
+		const CGRect itemFrame = CGRectMake(_itemXs[index], 0, _itemWidths[index], height);
+		UIView<BAToggleItem> *itemView = [_visibleItemViews objectForKey:key];
+		if (!itemView) {
+			itemView = [self createItemViewAtIndex:index];
+			itemView.selected = (index == _selectedItemIndex);
+			[_scrollView addSubview:itemView];
+			[_visibleItemViews setObject:itemView forKey:key];
+		}
+		if (!CGRectEqualToRect(itemView.frame, itemFrame)) {
+			itemView.frame = itemFrame;
+		}
+		if (index > 0 && _hasSeparators) {
+			const CGRect separatorFrame = CGRectMake(_itemXs[index] - self.spacing - _separatorSize.width,
+													 (height - _separatorSize.height) / 2,
+													 _separatorSize.width, _separatorSize.height);
+			UIView *separatorView = [_visibleSeparatorViews objectForKey:key];
+			if (!separatorView) {
+				separatorView = [_reusableViews dequeueReusableViewWithIdentifier:kSeparatorViewIdentifier];
+				if (!separatorView) {
+					separatorView = [self.delegate toggleBarSeparatorView:self];
+				}
+				if (separatorView) {
+					[_scrollView addSubview:separatorView];
+					[_visibleSeparatorViews setObject:separatorView forKey:key];
+				}
+			}
+			if (!CGRectEqualToRect(separatorView.frame, separatorFrame)) {
+				separatorView.frame = separatorFrame;
+			}
+		}
+	}
+}
+
 - (NSInteger)selectedItemIndex {
 	return _selectedItemIndex;
 }
@@ -410,8 +681,7 @@
 	_selectedItemIndex = selectedItemIndex;
 	[self updateItemsState];
 	if (revealingItem && _selectedItemIndex >= 0) {
-		UIView *view = [_itemViews objectAtIndex:_selectedItemIndex];
-		[_scrollView scrollRectToVisible:view.frame animated:YES];
+		[_scrollView scrollRectToVisible:[self frameOfItemAtIndex:_selectedItemIndex] animated:YES];
 	}
 	if (self.delegate) {
 		id item = (selectedItemIndex < 0) ? nil : [_items objectAtIndex:_selectedItemIndex];
@@ -424,6 +694,9 @@
 }
 
 - (void)scrollViewDidScroll:(UIScrollView *)scrollView {
+	if (_virtualized) {
+		[self updateVisibleItemViews];
+	}
 //	if (self.leftTailState != BAToggleBarTailStateToggleAnimated) {
 //		[self updateLeftTailView:YES];
 //	}
@@ -28,6 +28,7 @@
 
 #import <QuartzCore/QuartzCore.h>
 #import "BAToggleItemLabel.h"
+#import "BATextMeasurer.h"
 
 #define kDefaultPadding 10
 
@@ -62,7 +63,12 @@
 - (CGSize)sizeThatFits:(CGSize)size {
 	size.width -= (self.insets.left + self.insets.right);
 	size.height -= (self.insets.top + self.insets.bottom);
-	size = [super sizeThatFits:size];
+	if (self.numberOfLines == 1) {
+		// labels of the bar are measured for every layout
+		size = [[BATextMeasurer sharedMeasurer] sizeOfText:self.text withFont:self.font];
+	} else {
+		size = [super sizeThatFits:size];
+	}
 	size.width += (self.insets.left + self.insets.right);
 	size.height += (self.insets.top + self.insets.bottom);
 	return size;
@@ -71,9 +77,11 @@
 - (void)drawRect:(CGRect)rect {
 	if (self.selected && self.selectedBackgroundColor) {
 		CGSize textSize = UIEdgeInsetsInsetRect(self.bounds, self.insets).size;
-		textSize = [self.text sizeWithFont:self.font
-						 constrainedToSize:textSize
-							 lineBreakMode:self.lineBreakMode];
+		textSize = [[BATextMeasurer sharedMeasurer] sizeOfText:self.text
+													  withFont:self.font
+											 constrainedToSize:textSize
+												 numberOfLines:0
+												 lineBreakMode:self.lineBreakMode];
 		[self.selectedBackgroundColor set];
 		CGContextRef ctx = UIGraphicsGetCurrentContext();
 		CGRect plateRect = CGRectMake((self.bounds.size.width - textSize.width) / 2,
@@ -37,13 +37,28 @@
 
 @interface BAViewsCache : NSObject
 
-@property(readonly) NSUInteger capacityPerType;
+// Views are kept in buckets by reuse identifier, so enqueue and dequeue take constant time.
+// Views over capacity of their bucket are dropped. Capacity for identifiers which are not set
+// explicitly is capacityPerType.
+
+@property NSUInteger capacityPerType; // default is 8
+@property(readonly) NSUInteger hitsCount;
+@property(readonly) NSUInteger missesCount;
 
 + (BAViewsCache *)sharedCache;
 
 - (UIView<BAReusableView> *)dequeueReusableViewWithIdentifier:(NSString *)reuseIdentifier;
 - (void)enqueueReusableView:(UIView<BAReusableView> *)view;
+- (void)enqueueReusableView:(UIView *)view withIdentifier:(NSString *)reuseIdentifier; // for views with own identifiers
 - (void)removeReusableView:(UIView<BAReusableView> *)view;
 - (void)clear;
 
+- (NSUInteger)capacityForIdentifier:(NSString *)reuseIdentifier;
+- (void)setCapacity:(NSUInteger)capacity forIdentifier:(NSString *)reuseIdentifier;
+- (NSUInteger)countOfViewsWithIdentifier:(NSString *)reuseIdentifier;
+
+// Creates views with the block until there are count of them or capacity is reached
+- (void)prewarmViewsWithIdentifier:(NSString *)reuseIdentifier count:(NSUInteger)count usingBlock:(UIView *(^)(void))block;
+- (void)resetStatistics;
+
 @end
@@ -30,19 +30,31 @@
 
 @implementation BAViewsCache {
 	NSMutableDictionary *_allViews; // reuseIdentifier -> NSMutableArray:UIView
+	NSMutableDictionary *_capacities; // reuseIdentifier -> NSNumber
 	NSUInteger _capacityPerType;
+	NSUInteger _hitsCount;
+	NSUInteger _missesCount;
 }
 
 @synthesize capacityPerType = _capacityPerType;
+@synthesize hitsCount = _hitsCount;
+@synthesize missesCount = _missesCount;
 
 - (id)init {
 	if ((self = [super init])) {
 		_allViews = [[NSMutableDictionary alloc] init];
+		_capacities = [[NSMutableDictionary alloc] init];
 		_capacityPerType = 8;
 	}
 	return self;
 }
 
+- (void)dealloc {
+	[_allViews release];
+	[_capacities release];
+    [super dealloc];
+}
+
 + (BAViewsCache *)sharedCache {
 	static BAViewsCache *cache;
 	if (!cache) {
@@ -60,23 +72,30 @@
 	if (view) {
 		[[view retain] autorelease];
 		[views removeLastObject];
+		_hitsCount++;
 		return view;
 	}
+	_missesCount++;
 	return nil;
 }
 
 - (void)enqueueReusableView:(UIView<BAReusableView> *)view {
-	if (![view reuseIdentifier]) {
+	[self enqueueReusableView:view withIdentifier:[view reuseIdentifier]];
+}
+
+- (void)enqueueReusableView:(UIView *)view withIdentifier:(NSString *)reuseIdentifier {
+	if (!view || !reuseIdentifier) {
+		return;
+	}
+	NSMutableArray *views = [_allViews objectForKey:reuseIdentifier];
+	if ([views count] >= [self capacityForIdentifier:reuseIdentifier]) {
 		return;
 	}
-	NSMutableArray *views = [_allViews objectForKey:[view reuseIdentifier]];
 	if (views) {
-		if ([views count] < self.capacityPerType) {
-			[views addObject:view];
-		}
+		[views addObject:view];
 	} else {
 		views = [NSMutableArray arrayWithObject:view];
-		[_allViews setObject:views forKey:[view reuseIdentifier]];
+		[_allViews setObject:views forKey:reuseIdentifier];
 	}
 }
 
@@ -94,4 +113,43 @@
 	[_allViews removeAllObjects];
 }
 
+- (NSUInteger)capacityForIdentifier:(NSString *)reuseIdentifier {
+	NSNumber *capacity = reuseIdentifier ? [_capacities objectForKey:reuseIdentifier] : nil;
+	return capacity ? [capacity unsignedIntegerValue] : self.capacityPerType;
+}
+
+- (void)setCapacity:(NSUInteger)capacity forIdentifier:(NSString *)reuseIdentifier {
+	if (!reuseIdentifier) {
+		return;
+	}
+	[_capacities setObject:[NSNumber numberWithUnsignedInteger:capacity] forKey:reuseIdentifier];
+	NSMutableArray *views = [_allViews objectForKey:reuseIdentifier];
+	if ([views count] > capacity) {
+		[views removeObjectsInRange:NSMakeRange(capacity, [views count] - capacity)];
+	}
+}
+
+- (NSUInteger)countOfViewsWithIdentifier:(NSString *)reuseIdentifier {
+	return reuseIdentifier ? [[_allViews objectForKey:reuseIdentifier] count] : 0;
+}
+
+- (void)prewarmViewsWithIdentifier:(NSString *)reuseIdentifier count:(NSUInteger)count usingBlock:(UIView *(^)(void))block {
+	if (!reuseIdentifier || !block) {
+		return;
+	}
+	const NSUInteger targetCount = MIN(count, [self capacityForIdentifier:reuseIdentifier]);
+	while ([self countOfViewsWithIdentifier:reuseIdentifier] < targetCount) {
+		UIView *view = block();
+		if (!view) {
+			break;
+		}
+		[self enqueueReusableView:view withIdentifier:reuseIdentifier];
+	}
+}
+
+- (void)resetStatistics {
+	_hitsCount = 0;
+	_missesCount = 0;
+}
+
 @end
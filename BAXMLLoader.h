@@ -32,5 +32,8 @@
 @interface BAXMLLoader : BADataLoader
 
 @property(nonatomic, retain) BAXMLParserBase *parser;
+// If set then data is parsed while it's being received rather than after it's loaded.
+// Data read from cache is still parsed at once. Default is NO.
+@property(nonatomic, assign) BOOL streaming;
 
 @end
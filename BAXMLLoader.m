@@ -31,13 +31,36 @@
 @implementation BAXMLLoader
 
 @synthesize parser = _parser;
+@synthesize streaming = _streaming;
 
 - (void)dealloc {
 	[_parser release];
+	_parser = nil; // super calls resetConnection
 	[super dealloc];
 }
 
+- (void)resetConnection {
+	[super resetConnection];
+	if ([_parser parsing]) {
+		[_parser abortParsing];
+	}
+}
+
+- (void)prepareDataChunk:(NSData *)chunk {
+	if (!_streaming) {
+		return;
+	}
+	if (self.receivedBytesCount == 0) {
+		// first chunk of a new response
+		[_parser beginParsing];
+	}
+	[_parser parseChunk:chunk];
+}
+
 - (BOOL)prepareData:(NSData *)data {
+	if ([_parser parsing]) {
+		return ![_parser finishParsing];
+	}
 	return ![_parser parse:data];
 }
 
@@ -28,15 +28,53 @@
 
 #import <Foundation/Foundation.h>
 
-@interface BAXMLParserBase : NSObject <NSXMLParserDelegate> {
-@private
-	NSMutableString *_bufferText;
-}
+// Subclasses implement NSXMLParserDelegate methods to handle parsing events.
+// 
+// Data could be parsed at once with -parse: or fed in chunks as it arrives with
+// -beginParsing, -parseChunk: and -finishParsing. Streaming is backed by libxml2 push
+// parser and delegate methods get nil parser in this mode; CDATA blocks are passed to
+// -parser:foundCDATA: whose default implementation reports them as characters.
+// 
+// Instead of tracking elements manually subclasses may register handlers for element
+// paths like @"rss/channel/item/title". Paths are absolute, element names are qualified
+// names. End handlers get text of the element and all its descendants with leading and
+// trailing whitespace trimmed. Text is collected only while inside such an element.
+
+// Backend used by -parse:. Native backend is a byte level tokenizer (see BAXMLTokenizer)
+// which is considerably faster than NSXMLParser but does not validate documents and
+// only decodes predefined and numeric entities. Documents declared in encodings other
+// than UTF-8 are always parsed with NSXMLParser. As with streaming delegate methods get
+// nil parser and parsing is stopped with -abortParsing.
+
+typedef enum {
+	BAXMLParserBackendFoundation = 0, // NSXMLParser
+	BAXMLParserBackendNative
+} BAXMLParserBackend;
+
+typedef void (^BAXMLStartElementHandler)(NSDictionary *attributes);
+typedef void (^BAXMLEndElementHandler)(NSString *text);
+
+@interface BAXMLParserBase : NSObject <NSXMLParserDelegate>
 
 - (void)enableBuffer;
 - (void)disableBuffer;
 - (NSString *)bufferText;
 
+@property(nonatomic, assign) BAXMLParserBackend backend; // initially set to defaultBackend
++ (BAXMLParserBackend)defaultBackend;
++ (void)setDefaultBackend:(BAXMLParserBackend)backend;
+
 - (NSError *)parse:(NSData *)data;
 
+- (void)beginParsing;
+- (BOOL)parseChunk:(NSData *)data; // returns NO once parsing has failed
+- (NSError *)finishParsing;
+- (void)abortParsing; // also stops -parse: with native backend
+@property(nonatomic, readonly) BOOL parsing; // YES between beginParsing and finish/abort
+
+// Either handler could be nil.
+- (void)addHandlerForPath:(NSString *)path start:(BAXMLStartElementHandler)start end:(BAXMLEndElementHandler)end;
+- (void)removeHandlerForPath:(NSString *)path;
+- (NSString *)currentPath;
+
 @end
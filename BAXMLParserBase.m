@@ -27,24 +27,560 @@
 */
 
 #import "BAXMLParserBase.h"
+#import "BAXMLTokenizer.h"
+#import "BAJSONStringTable.h"
+#include <libxml/parser.h>
 
-@implementation BAXMLParserBase
+static BAXMLParserBackend BAXMLParserDefaultBackend = BAXMLParserBackendFoundation;
+
+@interface BAXMLPathHandler : NSObject
+
+@property(nonatomic, copy) BAXMLStartElementHandler start;
+@property(nonatomic, copy) BAXMLEndElementHandler end;
+
+@end
+
+@implementation BAXMLPathHandler
+
+@synthesize start = _start;
+@synthesize end = _end;
 
 - (void)dealloc {
+	[_start release];
+	[_end release];
+	[super dealloc];
+}
+
+@end
+
+
+typedef struct {
+	BAXMLPathHandler *handler; // retained
+	NSUInteger depth;
+	NSUInteger textStart;
+} BAXMLActiveHandler;
+
+
+// Routes NSXMLParser events through the base class so paths and handlers are tracked
+// even if subclasses override delegate methods without calling super.
+
+@interface BAXMLParserForwarder : NSObject <NSXMLParserDelegate>
+
+@property(nonatomic, assign) BAXMLParserBase *target;
+
+@end
+
+
+@interface BAXMLParserBase ()
+
+- (void)parser:(NSXMLParser *)parser startElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributes;
+- (void)parser:(NSXMLParser *)parser endElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName;
+- (void)parser:(NSXMLParser *)parser text:(NSString *)text;
+- (BOOL)wantsText;
+- (void)streamFailedWithError:(NSError *)error;
+
+@end
+
+
+@implementation BAXMLParserForwarder
+
+@synthesize target = _target;
+
+- (BOOL)respondsToSelector:(SEL)aSelector {
+	return [super respondsToSelector:aSelector] || [_target respondsToSelector:aSelector];
+}
+
+- (id)forwardingTargetForSelector:(SEL)aSelector {
+	return _target;
+}
+
+- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributeDict
+{
+	[_target parser:parser startElement:elementName namespaceURI:namespaceURI qualifiedName:qName attributes:attributeDict];
+}
+
+- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
+{
+	[_target parser:parser endElement:elementName namespaceURI:namespaceURI qualifiedName:qName];
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string {
+	[_target parser:parser text:string];
+}
+
+@end
+
+
+#pragma mark -
+#pragma mark libxml2 callbacks
+
+static void BAXMLStreamStartElement(void *ctx, const xmlChar *name, const xmlChar **atts) {
+	BAXMLParserBase *parser = (BAXMLParserBase *)ctx;
+	NSString *elementName = [[NSString alloc] initWithUTF8String:(const char *)name];
+	NSMutableDictionary *attributes = [[NSMutableDictionary alloc] init];
+	if (atts) {
+		for (NSUInteger i = 0; atts[i]; i += 2) {
+			NSString *attributeName = [[NSString alloc] initWithUTF8String:(const char *)atts[i]];
+			NSString *attributeValue = atts[i + 1] ?
+			[[NSString alloc] initWithUTF8String:(const char *)atts[i + 1]] : [@"" retain];
+			if (attributeName && attributeValue) {
+				[attributes setObject:attributeValue forKey:attributeName];
+			}
+			[attributeName release];
+			[attributeValue release];
+		}
+	}
+	[parser parser:nil startElement:elementName namespaceURI:nil qualifiedName:nil attributes:attributes];
+	[attributes release];
+	[elementName release];
+}
+
+static void BAXMLStreamEndElement(void *ctx, const xmlChar *name) {
+	BAXMLParserBase *parser = (BAXMLParserBase *)ctx;
+	NSString *elementName = [[NSString alloc] initWithUTF8String:(const char *)name];
+	[parser parser:nil endElement:elementName namespaceURI:nil qualifiedName:nil];
+	[elementName release];
+}
+
+static void BAXMLStreamCharacters(void *ctx, const xmlChar *ch, int len) {
+	BAXMLParserBase *parser = (BAXMLParserBase *)ctx;
+	if (![parser wantsText]) {
+		return;
+	}
+	NSString *text = [[NSString alloc] initWithBytes:ch length:len encoding:NSUTF8StringEncoding];
+	if (text) {
+		[parser parser:nil text:text];
+	}
+	[text release];
+}
+
+static void BAXMLStreamCDATA(void *ctx, const xmlChar *value, int len) {
+	BAXMLParserBase *parser = (BAXMLParserBase *)ctx;
+	NSData *data = [[NSData alloc] initWithBytes:value length:len];
+	[parser parser:nil foundCDATA:data];
+	[data release];
+}
+
+static void BAXMLStreamError(void *ctx, const char *msg, ...) {
+	// errors are taken from the context when a chunk fails
+}
+
+
+@implementation BAXMLParserBase {
+@private
+	NSMutableString *_bufferText;
+	NSMutableDictionary *_pathHandlers; // path -> BAXMLPathHandler
+	NSMutableString *_path;
+	NSUInteger *_pathLengths; // path length before each open element
+	NSUInteger _depth;
+	NSUInteger _pathLengthsCapacity;
+	NSMutableString *_handlerText; // reused between elements
+	BAXMLActiveHandler *_activeHandlers;
+	NSUInteger _activeHandlersCount;
+	NSUInteger _activeHandlersCapacity;
+	BOOL _forwardsCharacters;
+	xmlParserCtxtPtr _stream;
+	NSError *_streamError;
+	BOOL _streamParsing; // inside xmlParseChunk
+	BOOL _streamAborted; // context is freed once xmlParseChunk returns
+	BAXMLParserBackend _backend;
+	BOOL _nativeParsing;
+	BOOL _nativeAborted;
+}
+
+@synthesize backend = _backend;
+
++ (BAXMLParserBackend)defaultBackend {
+	return BAXMLParserDefaultBackend;
+}
+
++ (void)setDefaultBackend:(BAXMLParserBackend)backend {
+	BAXMLParserDefaultBackend = backend;
+}
+
+- (id)init {
+	if ((self = [super init])) {
+		_backend = [[self class] defaultBackend];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[self abortParsing];
+	while (_activeHandlersCount > 0) {
+		[_activeHandlers[--_activeHandlersCount].handler release];
+	}
 	[_bufferText release];
+	[_pathHandlers release];
+	[_path release];
+	free(_pathLengths);
+	[_handlerText release];
+	free(_activeHandlers);
 	[super dealloc];
 }
 
+- (void)resetPath {
+	if (!_path) {
+		_path = [[NSMutableString alloc] init];
+	}
+	[_path setString:@""];
+	_depth = 0;
+	while (_activeHandlersCount > 0) {
+		[_activeHandlers[--_activeHandlersCount].handler release];
+	}
+	[_handlerText setString:@""];
+	// skip creating strings for characters nobody is going to read
+	_forwardsCharacters = [self methodForSelector:@selector(parser:foundCharacters:)] !=
+	[BAXMLParserBase instanceMethodForSelector:@selector(parser:foundCharacters:)];
+}
+
 - (NSError *)parse:(NSData *)data {
+	if (_backend == BAXMLParserBackendNative && [[self class] isUTF8Data:data]) {
+		return [self parseNative:data];
+	}
+	[self resetPath];
+	BAXMLParserForwarder *forwarder = [[[BAXMLParserForwarder alloc] init] autorelease];
+	forwarder.target = self;
 	NSXMLParser *parser = [[[NSXMLParser alloc] initWithData:data] autorelease];
 	[parser setShouldProcessNamespaces:NO];
 	[parser setShouldReportNamespacePrefixes:NO];
 	[parser setShouldResolveExternalEntities:NO];
-	parser.delegate = self;
+	parser.delegate = forwarder;
 	[parser parse];
+	parser.delegate = nil;
 	return [parser parserError];
 }
 
+// Checks BOM and encoding in XML declaration.
++ (BOOL)isUTF8Data:(NSData *)data {
+	const uint8_t *bytes = [data bytes];
+	const NSUInteger length = [data length];
+	if (length >= 2 && ((bytes[0] == 0xFE && bytes[1] == 0xFF) || (bytes[0] == 0xFF && bytes[1] == 0xFE) ||
+						bytes[0] == 0 || bytes[1] == 0))
+	{
+		return NO;
+	}
+	const NSUInteger offset = (length >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) ? 3 : 0;
+	if (length < offset + 5 || memcmp(bytes + offset, "<?xml", 5) != 0) {
+		return YES;
+	}
+	const uint8_t *declarationEnd = memchr(bytes + offset, '>', MIN(length - offset, 256));
+	if (!declarationEnd) {
+		return YES;
+	}
+	NSString *declaration = [[[NSString alloc] initWithBytes:bytes + offset
+													  length:declarationEnd - (bytes + offset)
+													encoding:NSASCIIStringEncoding] autorelease];
+	NSRange range = [declaration rangeOfString:@"encoding"];
+	if (range.location == NSNotFound) {
+		return YES;
+	}
+	NSString *encoding = [[declaration substringFromIndex:NSMaxRange(range)]
+						  stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@" \t\r\n=\"'"]];
+	encoding = [[[encoding componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@" \t\r\n\"'?"]]
+				 objectAtIndex:0] lowercaseString];
+	return [encoding isEqualToString:@"utf-8"] || [encoding isEqualToString:@"utf8"] ||
+	[encoding isEqualToString:@"us-ascii"] || [encoding isEqualToString:@"ascii"];
+}
+
+- (NSError *)parseNative:(NSData *)data {
+	[self resetPath];
+	_nativeParsing = YES;
+	_nativeAborted = NO;
+	// element and attribute names repeat all over the document
+	BAJSONStringTable *names = [[BAJSONStringTable alloc] initWithCapacity:256];
+	NSDictionary *noAttributes = [NSDictionary dictionary];
+	BAXMLTokenizer tokenizer;
+	BAXMLTokenizerInit(&tokenizer, [data bytes], [data length]);
+	if ([self respondsToSelector:@selector(parserDidStartDocument:)]) {
+		[self parserDidStartDocument:nil];
+	}
+	BAXMLTokenType type;
+	while (!_nativeAborted && (type = BAXMLTokenizerNext(&tokenizer)) != BAXMLTokenNone) {
+		switch (type) {
+			case BAXMLTokenStartElement: {
+				NSString *name = [names newStringWithBytes:tokenizer.name.bytes length:tokenizer.name.length];
+				NSMutableDictionary *attributes = nil;
+				BAXMLSpan attributeName, attributeValue;
+				while (BAXMLTokenizerNextAttribute(&tokenizer, &attributeName, &attributeValue)) {
+					if (!attributes) {
+						attributes = [NSMutableDictionary dictionary];
+					}
+					NSString *key = [names newStringWithBytes:attributeName.bytes length:attributeName.length];
+					NSString *value = BAXMLCreateStringFromSpan(attributeValue, YES);
+					if (key && value) {
+						[attributes setObject:value forKey:key];
+					}
+					[key release];
+					[value release];
+				}
+				if (name && !tokenizer.error) {
+					[self parser:nil startElement:name namespaceURI:nil qualifiedName:nil
+					  attributes:(attributes ? attributes : noAttributes)];
+				}
+				[name release];
+				break;
+			}
+			case BAXMLTokenEndElement: {
+				NSString *name = [names newStringWithBytes:tokenizer.name.bytes length:tokenizer.name.length];
+				if (name) {
+					[self parser:nil endElement:name namespaceURI:nil qualifiedName:nil];
+				}
+				[name release];
+				break;
+			}
+			case BAXMLTokenText:
+				if ([self wantsText]) {
+					NSString *text = BAXMLCreateStringFromSpan(tokenizer.text, YES);
+					if (text) {
+						[self parser:nil text:text];
+					}
+					[text release];
+				}
+				break;
+			case BAXMLTokenCDATA: {
+				NSData *CDATABlock = [[NSData alloc] initWithBytesNoCopy:(void *)tokenizer.text.bytes
+																  length:tokenizer.text.length
+															freeWhenDone:NO];
+				[self parser:nil foundCDATA:CDATABlock];
+				[CDATABlock release];
+				break;
+			}
+			case BAXMLTokenNone:
+				break;
+		}
+	}
+	NSError *error = BAXMLTokenizerError(&tokenizer);
+	if (!error && _nativeAborted) {
+		// like NSXMLParser after abortParsing
+		error = [NSError errorWithDomain:NSXMLParserErrorDomain code:NSXMLParserDelegateAbortedParseError userInfo:nil];
+	}
+	BAXMLTokenizerDestroy(&tokenizer);
+	[names release];
+	_nativeParsing = NO;
+	if (error) {
+		if ([self respondsToSelector:@selector(parser:parseErrorOccurred:)]) {
+			[self parser:nil parseErrorOccurred:error];
+		}
+	} else if ([self respondsToSelector:@selector(parserDidEndDocument:)]) {
+		[self parserDidEndDocument:nil];
+	}
+	return error;
+}
+
+- (BOOL)parsing {
+	return !!_stream;
+}
+
+- (void)beginParsing {
+	[self abortParsing];
+	[self resetPath];
+	xmlSAXHandler handler;
+	memset(&handler, 0, sizeof(handler));
+	handler.startElement = BAXMLStreamStartElement;
+	handler.endElement = BAXMLStreamEndElement;
+	handler.characters = BAXMLStreamCharacters;
+	handler.cdataBlock = BAXMLStreamCDATA;
+	handler.error = BAXMLStreamError;
+	_stream = xmlCreatePushParserCtxt(&handler, self, NULL, 0, NULL);
+	xmlCtxtUseOptions(_stream, XML_PARSE_NONET);
+	if ([self respondsToSelector:@selector(parserDidStartDocument:)]) {
+		[self parserDidStartDocument:nil];
+	}
+}
+
+- (void)streamFailedWithError:(NSError *)error {
+	if (_streamError) {
+		return;
+	}
+	_streamError = [error retain];
+	if ([self respondsToSelector:@selector(parser:parseErrorOccurred:)]) {
+		[self parser:nil parseErrorOccurred:error];
+	}
+}
+
+- (BOOL)parseChunk:(NSData *)data terminate:(BOOL)terminate {
+	if (!_stream || _streamError) {
+		return NO;
+	}
+	const char *bytes = [data bytes];
+	NSUInteger length = [data length];
+	int result = 0;
+	// xmlParseChunk takes int sizes
+	_streamParsing = YES;
+	do {
+		const int chunkLength = (int)MIN(length, INT_MAX);
+		const BOOL lastChunk = terminate && (NSUInteger)chunkLength == length;
+		result = xmlParseChunk(_stream, bytes, chunkLength, lastChunk);
+		bytes += chunkLength;
+		length -= chunkLength;
+	} while (result == 0 && length > 0 && !_streamAborted);
+	_streamParsing = NO;
+	if (_streamAborted) {
+		// handler called -abortParsing
+		_streamAborted = NO;
+		[self abortParsing];
+		return NO;
+	}
+	if (result != 0) {
+		xmlErrorPtr xmlError = xmlCtxtGetLastError(_stream);
+		NSString *description = (xmlError && xmlError->message) ?
+		[[NSString stringWithUTF8String:xmlError->message] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] :
+		@"XML parsing failed";
+		NSError *error = [NSError errorWithDomain:NSXMLParserErrorDomain
+											 code:result
+										 userInfo:[NSDictionary dictionaryWithObject:description
+																			  forKey:NSLocalizedDescriptionKey]];
+		[self streamFailedWithError:error];
+		return NO;
+	}
+	return YES;
+}
+
+- (BOOL)parseChunk:(NSData *)data {
+	return [self parseChunk:data terminate:NO];
+}
+
+- (NSError *)finishParsing {
+	if (!_stream) {
+		return nil;
+	}
+	[self parseChunk:nil terminate:YES];
+	if (!_stream) {
+		return nil; // aborted by a handler
+	}
+	if (!_streamError && [self respondsToSelector:@selector(parserDidEndDocument:)]) {
+		[self parserDidEndDocument:nil];
+	}
+	NSError *error = [[_streamError retain] autorelease];
+	[self abortParsing];
+	return error;
+}
+
+- (void)abortParsing {
+	if (_nativeParsing) {
+		_nativeAborted = YES;
+	}
+	if (_stream && _streamParsing) {
+		// context is still used by xmlParseChunk
+		_streamAborted = YES;
+		xmlStopParser(_stream);
+		return;
+	}
+	if (_stream) {
+		xmlFreeParserCtxt(_stream);
+		_stream = NULL;
+	}
+	[_streamError release];
+	_streamError = nil;
+}
+
+- (void)addHandlerForPath:(NSString *)path start:(BAXMLStartElementHandler)start end:(BAXMLEndElementHandler)end {
+	if (!_pathHandlers) {
+		_pathHandlers = [[NSMutableDictionary alloc] init];
+	}
+	BAXMLPathHandler *handler = [[[BAXMLPathHandler alloc] init] autorelease];
+	handler.start = start;
+	handler.end = end;
+	[_pathHandlers setObject:handler forKey:path];
+}
+
+- (void)removeHandlerForPath:(NSString *)path {
+	[_pathHandlers removeObjectForKey:path];
+}
+
+- (NSString *)currentPath {
+	return [[_path copy] autorelease];
+}
+
+- (void)parser:(NSXMLParser *)parser startElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributes
+{
+	if (_depth == _pathLengthsCapacity) {
+		_pathLengthsCapacity = MAX(16, _pathLengthsCapacity * 2);
+		_pathLengths = realloc(_pathLengths, _pathLengthsCapacity * sizeof(NSUInteger));
+	}
+	_pathLengths[_depth++] = [_path length];
+	if ([_path length] > 0) {
+		[_path appendString:@"/"];
+	}
+	[_path appendString:elementName];
+
+	BAXMLPathHandler *handler = [_pathHandlers count] > 0 ? [_pathHandlers objectForKey:_path] : nil;
+	if (handler) {
+		if (handler.end) {
+			if (_activeHandlersCount == _activeHandlersCapacity) {
+				_activeHandlersCapacity = MAX(4, _activeHandlersCapacity * 2);
+				_activeHandlers = realloc(_activeHandlers, _activeHandlersCapacity * sizeof(BAXMLActiveHandler));
+			}
+			if (!_handlerText) {
+				_handlerText = [[NSMutableString alloc] init];
+			}
+			BAXMLActiveHandler *active = &_activeHandlers[_activeHandlersCount++];
+			active->handler = [handler retain];
+			active->depth = _depth;
+			active->textStart = [_handlerText length];
+		}
+		if (handler.start) {
+			handler.start(attributes);
+		}
+	}
+
+	if ([self respondsToSelector:@selector(parser:didStartElement:namespaceURI:qualifiedName:attributes:)]) {
+		[self parser:parser didStartElement:elementName namespaceURI:namespaceURI qualifiedName:qName attributes:attributes];
+	}
+}
+
+- (void)parser:(NSXMLParser *)parser endElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
+{
+	if (_activeHandlersCount > 0 && _activeHandlers[_activeHandlersCount - 1].depth == _depth) {
+		BAXMLActiveHandler active = _activeHandlers[--_activeHandlersCount];
+		// trim within the shared buffer so only the final string is copied
+		NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+		NSUInteger start = active.textStart;
+		NSUInteger end = [_handlerText length];
+		while (start < end && [whitespace characterIsMember:[_handlerText characterAtIndex:start]]) {
+			start++;
+		}
+		while (end > start && [whitespace characterIsMember:[_handlerText characterAtIndex:end - 1]]) {
+			end--;
+		}
+		NSString *text = [_handlerText substringWithRange:NSMakeRange(start, end - start)];
+		if (_activeHandlersCount == 0) {
+			[_handlerText setString:@""];
+		}
+		active.handler.end(text);
+		[active.handler release];
+	}
+
+	if ([self respondsToSelector:@selector(parser:didEndElement:namespaceURI:qualifiedName:)]) {
+		[self parser:parser didEndElement:elementName namespaceURI:namespaceURI qualifiedName:qName];
+	}
+
+	if (_depth > 0) {
+		_depth--;
+		[_path deleteCharactersInRange:NSMakeRange(_pathLengths[_depth], [_path length] - _pathLengths[_depth])];
+	}
+}
+
+- (BOOL)wantsText {
+	return _activeHandlersCount > 0 || _bufferText || _forwardsCharacters;
+}
+
+- (void)parser:(NSXMLParser *)parser text:(NSString *)text {
+	if (_activeHandlersCount > 0) {
+		[_handlerText appendString:text];
+	}
+	if (_bufferText || _forwardsCharacters) {
+		[self parser:parser foundCharacters:text];
+	}
+}
+
 - (void)enableBuffer {
 	[_bufferText release];
 	_bufferText = [[NSMutableString alloc] init];
@@ -67,7 +603,9 @@
 
 - (void)parser:(NSXMLParser *)parser foundCDATA:(NSData *)CDATABlock {
 	NSString *text = [[NSString alloc] initWithData:CDATABlock encoding:NSUTF8StringEncoding];
-	[self parser:parser foundCharacters:text];
+	if (text) {
+		[self parser:parser text:text];
+	}
 	[text release];
 }
 
@@ -0,0 +1,80 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Non-validating XML tokenizer working on raw UTF-8 bytes.
+// 
+// Tokens are reported as spans into the input and nothing is allocated until text is
+// asked for. Comments, processing instructions and DTDs are skipped; only predefined
+// and numeric entities are decoded. Input is expected to be complete and UTF-8 encoded.
+
+typedef struct {
+	const uint8_t *bytes;
+	size_t length;
+} BAXMLSpan;
+
+typedef enum {
+	BAXMLTokenNone = 0, // end of input or error
+	BAXMLTokenStartElement, // name; attributes are read with BAXMLTokenizerNextAttribute
+	BAXMLTokenEndElement, // name; also reported right after empty element tags
+	BAXMLTokenText, // raw text which may contain entity references
+	BAXMLTokenCDATA // raw text
+} BAXMLTokenType;
+
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	const uint8_t *start;
+	BAXMLSpan name;
+	BAXMLSpan text;
+	const uint8_t *attributes; // unread attributes of the current start tag
+	const uint8_t *attributesEnd;
+	BOOL emptyElement; // end element token is pending
+	BOOL stripsNamespacePrefixes; // report local names of elements and attributes
+	BAXMLSpan *openElements; // for matching end tags
+	NSUInteger depth;
+	NSUInteger openElementsCapacity;
+	BOOL rootClosed;
+	const char *error;
+} BAXMLTokenizer;
+
+void BAXMLTokenizerInit(BAXMLTokenizer *tokenizer, const void *bytes, size_t length);
+void BAXMLTokenizerDestroy(BAXMLTokenizer *tokenizer);
+BAXMLTokenType BAXMLTokenizerNext(BAXMLTokenizer *tokenizer);
+// Valid after start element token; value is raw and may contain entity references.
+BOOL BAXMLTokenizerNextAttribute(BAXMLTokenizer *tokenizer, BAXMLSpan *name, BAXMLSpan *value);
+BOOL BAXMLTokenizerAtEnd(BAXMLTokenizer *tokenizer); // YES if input was consumed without errors
+
+// Decodes entity references into out which should have at least span.length bytes.
+size_t BAXMLDecodeSpan(BAXMLSpan span, uint8_t *out);
+BOOL BAXMLSpanEquals(BAXMLSpan span, const char *string);
+BOOL BAXMLSpanIsWhitespace(BAXMLSpan span);
+NSString *BAXMLCreateStringFromSpan(BAXMLSpan span, BOOL decode); // retained
+
+NSError *BAXMLTokenizerError(BAXMLTokenizer *tokenizer);
@@ -0,0 +1,483 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+#import "BAXMLTokenizer.h"
+
+static inline BOOL BAXMLIsSpace(uint8_t c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline BAXMLSpan BAXMLSpanMake(const uint8_t *bytes, size_t length) {
+	BAXMLSpan span = { bytes, length };
+	return span;
+}
+
+static inline BOOL BAXMLTokenizerFail(BAXMLTokenizer *tokenizer, const char *error) {
+	if (!tokenizer->error) {
+		tokenizer->error = error;
+	}
+	return NO;
+}
+
+static inline BOOL BAXMLHasPrefix(const uint8_t *p, const uint8_t *end, const char *prefix, size_t length) {
+	return (size_t)(end - p) >= length && memcmp(p, prefix, length) == 0;
+}
+
+// Returns position of the string or NULL.
+static const uint8_t *BAXMLFind(const uint8_t *p, const uint8_t *end, const char *string, size_t length) {
+	while ((p = memchr(p, string[0], end - p))) {
+		if ((size_t)(end - p) < length) {
+			return NULL;
+		}
+		if (memcmp(p, string, length) == 0) {
+			return p;
+		}
+		p++;
+	}
+	return NULL;
+}
+
+static inline BAXMLSpan BAXMLLocalName(BAXMLTokenizer *tokenizer, BAXMLSpan name) {
+	if (!tokenizer->stripsNamespacePrefixes) {
+		return name;
+	}
+	const uint8_t *colon = memchr(name.bytes, ':', name.length);
+	if (!colon) {
+		return name;
+	}
+	return BAXMLSpanMake(colon + 1, name.length - (colon + 1 - name.bytes));
+}
+
+void BAXMLTokenizerInit(BAXMLTokenizer *tokenizer, const void *bytes, size_t length) {
+	memset(tokenizer, 0, sizeof(BAXMLTokenizer));
+	tokenizer->start = bytes;
+	tokenizer->p = bytes;
+	tokenizer->end = tokenizer->p + length;
+	if (length >= 3 && tokenizer->p[0] == 0xEF && tokenizer->p[1] == 0xBB && tokenizer->p[2] == 0xBF) {
+		tokenizer->p += 3;
+	}
+}
+
+void BAXMLTokenizerDestroy(BAXMLTokenizer *tokenizer) {
+	free(tokenizer->openElements);
+	tokenizer->openElements = NULL;
+	tokenizer->openElementsCapacity = 0;
+}
+
+static BOOL BAXMLTokenizerPush(BAXMLTokenizer *tokenizer, BAXMLSpan name) {
+	if (tokenizer->depth == tokenizer->openElementsCapacity) {
+		NSUInteger capacity = MAX(16, tokenizer->openElementsCapacity * 2);
+		BAXMLSpan *openElements = realloc(tokenizer->openElements, capacity * sizeof(BAXMLSpan));
+		if (!openElements) {
+			return BAXMLTokenizerFail(tokenizer, "Out of memory");
+		}
+		tokenizer->openElements = openElements;
+		tokenizer->openElementsCapacity = capacity;
+	}
+	tokenizer->openElements[tokenizer->depth++] = name;
+	return YES;
+}
+
+static void BAXMLTokenizerPop(BAXMLTokenizer *tokenizer) {
+	tokenizer->depth--;
+	if (tokenizer->depth == 0) {
+		tokenizer->rootClosed = YES;
+	}
+}
+
+static const uint8_t *BAXMLScanName(const uint8_t *p, const uint8_t *end) {
+	while (p < end && !BAXMLIsSpace(*p) && *p != '/' && *p != '>' && *p != '=') {
+		p++;
+	}
+	return p;
+}
+
+// Skips <!DOCTYPE ...> with its internal subset.
+static const uint8_t *BAXMLSkipDeclaration(const uint8_t *p, const uint8_t *end) {
+	NSUInteger brackets = 0;
+	uint8_t quote = 0;
+	for (; p < end; p++) {
+		const uint8_t c = *p;
+		if (quote) {
+			if (c == quote) {
+				quote = 0;
+			}
+		} else if (c == '"' || c == '\'') {
+			quote = c;
+		} else if (c == '[') {
+			brackets++;
+		} else if (c == ']' && brackets > 0) {
+			brackets--;
+		} else if (c == '>' && brackets == 0) {
+			return p + 1;
+		}
+	}
+	return NULL;
+}
+
+BAXMLTokenType BAXMLTokenizerNext(BAXMLTokenizer *tokenizer) {
+	if (tokenizer->error) {
+		return BAXMLTokenNone;
+	}
+	tokenizer->attributes = NULL;
+	tokenizer->attributesEnd = NULL;
+	if (tokenizer->emptyElement) {
+		tokenizer->emptyElement = NO;
+		BAXMLTokenizerPop(tokenizer);
+		return BAXMLTokenEndElement;
+	}
+	const uint8_t *end = tokenizer->end;
+	for (;;) {
+		const uint8_t *p = tokenizer->p;
+		if (p >= end) {
+			if (tokenizer->depth > 0) {
+				BAXMLTokenizerFail(tokenizer, "Unclosed element at end of data");
+			} else if (!tokenizer->rootClosed) {
+				BAXMLTokenizerFail(tokenizer, "No root element");
+			}
+			return BAXMLTokenNone;
+		}
+
+		if (*p != '<') {
+			const uint8_t *textEnd = memchr(p, '<', end - p);
+			if (!textEnd) {
+				textEnd = end;
+			}
+			tokenizer->text = BAXMLSpanMake(p, textEnd - p);
+			tokenizer->p = textEnd;
+			if (tokenizer->depth > 0) {
+				return BAXMLTokenText;
+			}
+			if (!BAXMLSpanIsWhitespace(tokenizer->text)) {
+				BAXMLTokenizerFail(tokenizer, "Text outside of root element");
+				return BAXMLTokenNone;
+			}
+			continue;
+		}
+
+		if (BAXMLHasPrefix(p, end, "<!--", 4)) {
+			const uint8_t *commentEnd = BAXMLFind(p + 4, end, "-->", 3);
+			if (!commentEnd) {
+				BAXMLTokenizerFail(tokenizer, "Unterminated comment");
+				return BAXMLTokenNone;
+			}
+			tokenizer->p = commentEnd + 3;
+			continue;
+		}
+		if (BAXMLHasPrefix(p, end, "<![CDATA[", 9)) {
+			const uint8_t *cdataEnd = BAXMLFind(p + 9, end, "]]>", 3);
+			if (!cdataEnd) {
+				BAXMLTokenizerFail(tokenizer, "Unterminated CDATA section");
+				return BAXMLTokenNone;
+			}
+			if (tokenizer->depth == 0) {
+				BAXMLTokenizerFail(tokenizer, "CDATA outside of root element");
+				return BAXMLTokenNone;
+			}
+			tokenizer->text = BAXMLSpanMake(p + 9, cdataEnd - (p + 9));
+			tokenizer->p = cdataEnd + 3;
+			return BAXMLTokenCDATA;
+		}
+		if (BAXMLHasPrefix(p, end, "<!", 2)) {
+			const uint8_t *declarationEnd = BAXMLSkipDeclaration(p + 2, end);
+			if (!declarationEnd) {
+				BAXMLTokenizerFail(tokenizer, "Unterminated declaration");
+				return BAXMLTokenNone;
+			}
+			tokenizer->p = declarationEnd;
+			continue;
+		}
+		if (BAXMLHasPrefix(p, end, "<?", 2)) {
+			const uint8_t *instructionEnd = BAXMLFind(p + 2, end, "?>", 2);
+			if (!instructionEnd) {
+				BAXMLTokenizerFail(tokenizer, "Unterminated processing instruction");
+				return BAXMLTokenNone;
+			}
+			tokenizer->p = instructionEnd + 2;
+			continue;
+		}
+
+		if (BAXMLHasPrefix(p, end, "</", 2)) {
+			const uint8_t *nameStart = p + 2;
+			p = BAXMLScanName(nameStart, end);
+			BAXMLSpan name = BAXMLSpanMake(nameStart, p - nameStart);
+			while (p < end && BAXMLIsSpace(*p)) {
+				p++;
+			}
+			if (p >= end || *p != '>' || name.length == 0) {
+				BAXMLTokenizerFail(tokenizer, "Malformed end tag");
+				return BAXMLTokenNone;
+			}
+			if (tokenizer->depth == 0) {
+				BAXMLTokenizerFail(tokenizer, "Unexpected end tag");
+				return BAXMLTokenNone;
+			}
+			BAXMLSpan openName = tokenizer->openElements[tokenizer->depth - 1];
+			if (openName.length != name.length || memcmp(openName.bytes, name.bytes, name.length) != 0) {
+				BAXMLTokenizerFail(tokenizer, "Mismatched end tag");
+				return BAXMLTokenNone;
+			}
+			tokenizer->name = BAXMLLocalName(tokenizer, name);
+			tokenizer->p = p + 1;
+			BAXMLTokenizerPop(tokenizer);
+			return BAXMLTokenEndElement;
+		}
+
+		// start tag
+		const uint8_t *nameStart = p + 1;
+		p = BAXMLScanName(nameStart, end);
+		BAXMLSpan name = BAXMLSpanMake(nameStart, p - nameStart);
+		if (name.length == 0) {
+			BAXMLTokenizerFail(tokenizer, "Malformed start tag");
+			return BAXMLTokenNone;
+		}
+		if (tokenizer->depth == 0 && tokenizer->rootClosed) {
+			BAXMLTokenizerFail(tokenizer, "Extra content at the end of the document");
+			return BAXMLTokenNone;
+		}
+		const uint8_t *attributes = p;
+		uint8_t quote = 0;
+		while (p < end && (quote || *p != '>')) {
+			if (quote) {
+				if (*p == quote) {
+					quote = 0;
+				}
+			} else if (*p == '"' || *p == '\'') {
+				quote = *p;
+			}
+			p++;
+		}
+		if (p >= end) {
+			BAXMLTokenizerFail(tokenizer, "Unterminated start tag");
+			return BAXMLTokenNone;
+		}
+		const BOOL emptyElement = (p > attributes && *(p - 1) == '/');
+		if (!BAXMLTokenizerPush(tokenizer, name)) {
+			return BAXMLTokenNone;
+		}
+		tokenizer->name = BAXMLLocalName(tokenizer, name);
+		tokenizer->attributes = attributes;
+		tokenizer->attributesEnd = emptyElement ? p - 1 : p;
+		tokenizer->emptyElement = emptyElement;
+		tokenizer->p = p + 1;
+		return BAXMLTokenStartElement;
+	}
+}
+
+BOOL BAXMLTokenizerNextAttribute(BAXMLTokenizer *tokenizer, BAXMLSpan *name, BAXMLSpan *value) {
+	const uint8_t *p = tokenizer->attributes;
+	const uint8_t *end = tokenizer->attributesEnd;
+	if (!p) {
+		return NO;
+	}
+	while (p < end && BAXMLIsSpace(*p)) {
+		p++;
+	}
+	if (p >= end) {
+		tokenizer->attributes = NULL;
+		return NO;
+	}
+	const uint8_t *nameStart = p;
+	p = BAXMLScanName(p, end);
+	*name = BAXMLLocalName(tokenizer, BAXMLSpanMake(nameStart, p - nameStart));
+	while (p < end && BAXMLIsSpace(*p)) {
+		p++;
+	}
+	if (name->length == 0 || p >= end || *p != '=') {
+		tokenizer->attributes = NULL;
+		return BAXMLTokenizerFail(tokenizer, "Malformed attribute");
+	}
+	p++;
+	while (p < end && BAXMLIsSpace(*p)) {
+		p++;
+	}
+	if (p >= end || (*p != '"' && *p != '\'')) {
+		tokenizer->attributes = NULL;
+		return BAXMLTokenizerFail(tokenizer, "Malformed attribute");
+	}
+	const uint8_t quote = *p++;
+	const uint8_t *valueEnd = memchr(p, quote, end - p);
+	if (!valueEnd) {
+		tokenizer->attributes = NULL;
+		return BAXMLTokenizerFail(tokenizer, "Malformed attribute");
+	}
+	*value = BAXMLSpanMake(p, valueEnd - p);
+	tokenizer->attributes = valueEnd + 1;
+	return YES;
+}
+
+BOOL BAXMLTokenizerAtEnd(BAXMLTokenizer *tokenizer) {
+	return !tokenizer->error && tokenizer->p >= tokenizer->end && tokenizer->depth == 0 && tokenizer->rootClosed;
+}
+
+static size_t BAXMLEncodeUTF8(uint32_t c, uint8_t *out) {
+	if (c < 0x80) {
+		out[0] = c;
+		return 1;
+	} else if (c < 0x800) {
+		out[0] = 0xC0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3F);
+		return 2;
+	} else if (c < 0x10000) {
+		out[0] = 0xE0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3F);
+		out[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (c >> 18);
+	out[1] = 0x80 | ((c >> 12) & 0x3F);
+	out[2] = 0x80 | ((c >> 6) & 0x3F);
+	out[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+// Returns length of the reference including '&' and ';' or 0 if it's not recognized.
+static size_t BAXMLDecodeReference(const uint8_t *p, const uint8_t *end, uint8_t *out, size_t *outLength) {
+	const uint8_t *semicolon = memchr(p, ';', MIN(end - p, 12));
+	if (!semicolon) {
+		return 0;
+	}
+	const size_t length = semicolon + 1 - p;
+	const uint8_t *name = p + 1;
+	const size_t nameLength = semicolon - name;
+	if (nameLength >= 2 && name[0] == '#') {
+		uint32_t c = 0;
+		BOOL hex = (name[1] == 'x' || name[1] == 'X');
+		const uint8_t *digits = name + (hex ? 2 : 1);
+		if (digits == semicolon) {
+			return 0;
+		}
+		for (const uint8_t *d = digits; d < semicolon; d++) {
+			uint32_t v;
+			if (*d >= '0' && *d <= '9') {
+				v = *d - '0';
+			} else if (hex && *d >= 'a' && *d <= 'f') {
+				v = *d - 'a' + 10;
+			} else if (hex && *d >= 'A' && *d <= 'F') {
+				v = *d - 'A' + 10;
+			} else {
+				return 0;
+			}
+			c = c * (hex ? 16 : 10) + v;
+			if (c > 0x10FFFF) {
+				return 0;
+			}
+		}
+		if (c == 0 || (c >= 0xD800 && c <= 0xDFFF)) {
+			return 0;
+		}
+		*outLength = BAXMLEncodeUTF8(c, out);
+		return length;
+	}
+	uint8_t c;
+	if (nameLength == 2 && memcmp(name, "lt", 2) == 0) {
+		c = '<';
+	} else if (nameLength == 2 && memcmp(name, "gt", 2) == 0) {
+		c = '>';
+	} else if (nameLength == 3 && memcmp(name, "amp", 3) == 0) {
+		c = '&';
+	} else if (nameLength == 4 && memcmp(name, "quot", 4) == 0) {
+		c = '"';
+	} else if (nameLength == 4 && memcmp(name, "apos", 4) == 0) {
+		c = '\'';
+	} else {
+		return 0;
+	}
+	out[0] = c;
+	*outLength = 1;
+	return length;
+}
+
+size_t BAXMLDecodeSpan(BAXMLSpan span, uint8_t *out) {
+	const uint8_t *p = span.bytes;
+	const uint8_t *end = p + span.length;
+	size_t length = 0;
+	while (p < end) {
+		const uint8_t c = *p;
+		if (c == '&') {
+			size_t referenceLength;
+			size_t consumed = BAXMLDecodeReference(p, end, out + length, &referenceLength);
+			if (consumed) {
+				p += consumed;
+				length += referenceLength;
+				continue;
+			}
+		} else if (c == '\r') {
+			// line ends are normalized to \n
+			out[length++] = '\n';
+			p += (p + 1 < end && p[1] == '\n') ? 2 : 1;
+			continue;
+		}
+		out[length++] = c;
+		p++;
+	}
+	return length;
+}
+
+BOOL BAXMLSpanEquals(BAXMLSpan span, const char *string) {
+	const size_t length = strlen(string);
+	return span.length == length && memcmp(span.bytes, string, length) == 0;
+}
+
+BOOL BAXMLSpanIsWhitespace(BAXMLSpan span) {
+	for (size_t i = 0; i < span.length; i++) {
+		if (!BAXMLIsSpace(span.bytes[i])) {
+			return NO;
+		}
+	}
+	return YES;
+}
+
+NSString *BAXMLCreateStringFromSpan(BAXMLSpan span, BOOL decode) {
+	if (!decode || (!memchr(span.bytes, '&', span.length) && !memchr(span.bytes, '\r', span.length))) {
+		return [[NSString alloc] initWithBytes:span.bytes length:span.length encoding:NSUTF8StringEncoding];
+	}
+	uint8_t buffer[256];
+	uint8_t *out = (span.length <= sizeof(buffer)) ? buffer : malloc(span.length);
+	if (!out) {
+		return nil;
+	}
+	const size_t length = BAXMLDecodeSpan(span, out);
+	NSString *string = [[NSString alloc] initWithBytes:out length:length encoding:NSUTF8StringEncoding];
+	if (out != buffer) {
+		free(out);
+	}
+	return string;
+}
+
+NSError *BAXMLTokenizerError(BAXMLTokenizer *tokenizer) {
+	if (!tokenizer->error) {
+		return nil;
+	}
+	NSString *description = [NSString stringWithFormat:@"%s at offset %lu",
+							 tokenizer->error, (unsigned long)(tokenizer->p - tokenizer->start)];
+	return [NSError errorWithDomain:NSXMLParserErrorDomain
+							   code:NSXMLParserInternalError
+						   userInfo:[NSDictionary dictionaryWithObject:description
+																forKey:NSLocalizedDescriptionKey]];
+}
@@ -9,9 +9,15 @@
 #include <BaseAppKit/BANetworkReachability.h>
 #include <BaseAppKit/BADataLoader.h>
 #include <BaseAppKit/BAJSONLoader.h>
+#include <BaseAppKit/BAJSONScanner.h>
+#include <BaseAppKit/BAJSONStringTable.h>
+#include <BaseAppKit/BAJSONDecoder.h>
+#include <BaseAppKit/BAJSONBinary.h>
+#include <BaseAppKit/BAXMLTokenizer.h>
 #include <BaseAppKit/BAXMLParserBase.h>
 #include <BaseAppKit/BAXMLLoader.h>
 #include <BaseAppKit/BAImageLoader.h>
+#include <BaseAppKit/BAImageDecoder.h>
 #include <BaseAppKit/BARemoteJSON.h>
 #include <BaseAppKit/BARuntime.h>
 
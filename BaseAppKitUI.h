@@ -7,9 +7,11 @@
 #include <BaseAppKit/UITableView+BALoading.h>
 #include <BaseAppKit/BAPager.h>
 #include <BaseAppKit/BARemoteImageView.h>
+#include <BaseAppKit/BARemoteImageAtlas.h>
 #include <BaseAppKit/BAPageControl.h>
 #include <BaseAppKit/BACustomPageControl.h>
 #include <BaseAppKit/BAGroupedPageControl.h>
+#include <BaseAppKit/BARasterCache.h>
 #include <BaseAppKit/BAProgressLayer.h>
 #include <BaseAppKit/BAProgressView.h>
 #include <BaseAppKit/BARefreshHeaderView.h>
@@ -21,13 +23,16 @@
 #include <BaseAppKit/BAActivityView.h>
 #include <BaseAppKit/BAKeyboardTracker.h>
 #include <BaseAppKit/BAGradientView.h>
+#include <BaseAppKit/BATextMeasurer.h>
 #include <BaseAppKit/BALabel.h>
 #include <BaseAppKit/BAEditableCell.h>
 #include <BaseAppKit/BASwitchCell.h>
 #include <BaseAppKit/BASequenceControl.h>
 #include <BaseAppKit/BASeparatedTableProvider.h>
 #include <BaseAppKit/BAViewsCache.h>
+#include <BaseAppKit/BARenderModelQueue.h>
 #include <BaseAppKit/BASimpleReusableView.h>
+#include <BaseAppKit/BAMeshLayout.h>
 #include <BaseAppKit/BAMeshViewCell.h>
 #include <BaseAppKit/BAMeshView.h>
 #include <BaseAppKit/BAScrollViewProxyDelegate.h>
@@ -0,0 +1,362 @@
+/*
+ Copyright 2012 Dmitry Stadnik. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY DMITRY STADNIK ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY STADNIK OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Dmitry Stadnik.
+ */
+
+// Command-line test and benchmark of BAMeshLayout.
+// 
+// Checks that incremental relayout matches full relayout, that concurrent section layout
+// matches serial one and that binary search hit testing agrees with a linear scan, then
+// times layout of large meshes. Usage: meshbench [cells] [max threads] [seed]
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "BAMeshLayout.h"
+
+typedef struct {
+	BAMeshSectionLayout layout;
+	BAMeshSize *sizes;
+	BAMeshCellAlignment *alignments;
+} Section;
+
+static unsigned long long randomState = 1;
+
+static unsigned int Random(void) {
+	randomState = randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (unsigned int)(randomState >> 33);
+}
+
+static double Now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static BAMeshSize RandomSize(int uniform) {
+	if (uniform) {
+		return (BAMeshSize){ 75, 75 };
+	}
+	return (BAMeshSize){ 20 + Random() % 140, 20 + Random() % 90 };
+}
+
+static void SectionInit(Section *section, long numberOfCells, int uniform) {
+	memset(section, 0, sizeof(Section));
+	BAMeshSectionLayout *layout = &section->layout;
+	section->sizes = malloc(numberOfCells * sizeof(BAMeshSize) + 1);
+	section->alignments = malloc(numberOfCells * sizeof(BAMeshCellAlignment) + 1);
+	for (long cell = 0; cell < numberOfCells; cell++) {
+		section->sizes[cell] = RandomSize(uniform);
+		section->alignments[cell] = Random() % 4;
+	}
+	layout->numberOfCells = numberOfCells;
+	layout->cellSizes = section->sizes;
+	layout->cellAlignments = uniform ? NULL : section->alignments;
+	layout->alignment = BAMeshCellAlignmentCenter;
+	layout->rowLayout = uniform ? BAMeshRowLayoutSpreadLeft : Random() % 8;
+	layout->rowsInsets = (BAMeshInsets){ Random() % 10, Random() % 10, Random() % 10, Random() % 10 };
+	layout->headerHeight = Random() % 2 ? 22 : 0;
+	layout->footerHeight = Random() % 2 ? 22 : 0;
+	layout->cellFrames = malloc(numberOfCells * sizeof(BAMeshRect) + 1);
+	layout->rowFirstCells = malloc(numberOfCells * sizeof(long) + 1);
+	layout->rowTops = malloc(numberOfCells * sizeof(BAMeshFloat) + 1);
+	layout->rowBottoms = malloc(numberOfCells * sizeof(BAMeshFloat) + 1);
+}
+
+static void SectionDestroy(Section *section) {
+	free(section->sizes);
+	free(section->alignments);
+	free(section->layout.cellFrames);
+	free(section->layout.rowFirstCells);
+	free(section->layout.rowTops);
+	free(section->layout.rowBottoms);
+}
+
+static int SectionsEqual(const BAMeshSectionLayout *a, const BAMeshSectionLayout *b) {
+	return a->numberOfRows == b->numberOfRows &&
+	a->totalHeight == b->totalHeight &&
+	a->y == b->y &&
+	memcmp(a->cellFrames, b->cellFrames, a->numberOfCells * sizeof(BAMeshRect)) == 0 &&
+	memcmp(a->rowFirstCells, b->rowFirstCells, a->numberOfRows * sizeof(long)) == 0 &&
+	memcmp(a->rowTops, b->rowTops, a->numberOfRows * sizeof(BAMeshFloat)) == 0 &&
+	memcmp(a->rowBottoms, b->rowBottoms, a->numberOfRows * sizeof(BAMeshFloat)) == 0;
+}
+
+static long LinearCellAtPoint(const BAMeshSectionLayout *layout, BAMeshFloat x, BAMeshFloat y) {
+	for (long cell = 0; cell < layout->numberOfCells; cell++) {
+		const BAMeshRect frame = layout->cellFrames[cell];
+		const BAMeshFloat cellY = frame.y + layout->y;
+		if (x >= frame.x && x < frame.x + frame.width && y >= cellY && y < cellY + frame.height) {
+			return cell;
+		}
+	}
+	return -1;
+}
+
+static int CellContainsPoint(const BAMeshSectionLayout *layout, long cell, BAMeshFloat x, BAMeshFloat y) {
+	const BAMeshRect frame = layout->cellFrames[cell];
+	const BAMeshFloat cellY = frame.y + layout->y;
+	return x >= frame.x && x < frame.x + frame.width && y >= cellY && y < cellY + frame.height;
+}
+
+static Section *CreateSections(long numberOfCells, long numberOfSections, int uniform) {
+	Section *sections = malloc(numberOfSections * sizeof(Section));
+	for (long section = 0; section < numberOfSections; section++) {
+		const long count = numberOfCells / numberOfSections + (section < numberOfCells % numberOfSections ? 1 : 0);
+		SectionInit(&sections[section], count, uniform);
+	}
+	return sections;
+}
+
+// Copies inputs, outputs are left for layout
+static Section *CopySections(const Section *sections, long numberOfSections) {
+	Section *copies = malloc(numberOfSections * sizeof(Section));
+	for (long section = 0; section < numberOfSections; section++) {
+		const long numberOfCells = sections[section].layout.numberOfCells;
+		SectionInit(&copies[section], numberOfCells, 0);
+		memcpy(copies[section].sizes, sections[section].sizes, numberOfCells * sizeof(BAMeshSize));
+		memcpy(copies[section].alignments, sections[section].alignments, numberOfCells * sizeof(BAMeshCellAlignment));
+		copies[section].layout.cellAlignments = sections[section].layout.cellAlignments ? copies[section].alignments : NULL;
+		copies[section].layout.alignment = sections[section].layout.alignment;
+		copies[section].layout.rowLayout = sections[section].layout.rowLayout;
+		copies[section].layout.rowsInsets = sections[section].layout.rowsInsets;
+		copies[section].layout.headerHeight = sections[section].layout.headerHeight;
+		copies[section].layout.footerHeight = sections[section].layout.footerHeight;
+	}
+	return copies;
+}
+
+static void DestroySections(Section *sections, long numberOfSections) {
+	for (long section = 0; section < numberOfSections; section++) {
+		SectionDestroy(&sections[section]);
+	}
+	free(sections);
+}
+
+// Incremental relayout after cell changes should give the same result as full relayout
+static int TestIncrementalLayout(int iterations) {
+	int failures = 0;
+	for (int i = 0; i < iterations; i++) {
+		const long numberOfCells = 1 + Random() % 300;
+		const BAMeshFloat width = 100 + Random() % 900;
+		Section incremental;
+		SectionInit(&incremental, numberOfCells, 0);
+		BAMeshLayoutSection(&incremental.layout, width);
+		const long changedCell = Random() % numberOfCells;
+		for (long cell = changedCell; cell < numberOfCells; cell += 1 + Random() % 8) {
+			incremental.sizes[cell] = RandomSize(0);
+		}
+		BAMeshLayoutSectionFromRow(&incremental.layout, width, BAMeshLayoutRowForChangedCell(&incremental.layout, changedCell));
+		Section *full = CopySections(&incremental, 1);
+		BAMeshLayoutSection(&full->layout, width);
+		if (!SectionsEqual(&incremental.layout, &full->layout)) {
+			failures++;
+		}
+		DestroySections(full, 1);
+		SectionDestroy(&incremental);
+	}
+	printf("incremental vs full relayout: %d mismatches in %d layouts\n", failures, iterations);
+	return failures;
+}
+
+// Binary search should find a cell wherever linear scan does
+static int TestHitTesting(int iterations, int pointsPerLayout) {
+	int failures = 0;
+	for (int i = 0; i < iterations; i++) {
+		Section section;
+		SectionInit(&section, 1 + Random() % 300, 0);
+		const BAMeshFloat width = 100 + Random() % 900;
+		BAMeshLayoutSection(&section.layout, width);
+		section.layout.y = Random() % 1000;
+		for (int p = 0; p < pointsPerLayout; p++) {
+			const BAMeshFloat x = Random() % (long)(width + 1) + (Random() % 4) * 0.25;
+			const BAMeshFloat y = section.layout.y + Random() % (long)(section.layout.totalHeight + 1) + (Random() % 4) * 0.25;
+			const long found = BAMeshLayoutCellAtPoint(&section.layout, x, y);
+			const long expected = LinearCellAtPoint(&section.layout, x, y);
+			if ((expected < 0) != (found < 0) || (found >= 0 && !CellContainsPoint(&section.layout, found, x, y))) {
+				failures++;
+			}
+		}
+		SectionDestroy(&section);
+	}
+	printf("hit testing vs linear scan: %d mismatches in %d points\n", failures, iterations * pointsPerLayout);
+	return failures;
+}
+
+typedef struct {
+	Section *sections;
+	long numberOfSections;
+	long next;
+	BAMeshFloat width;
+	pthread_mutex_t lock;
+} Work;
+
+static void *LayoutWorker(void *context) {
+	Work *work = context;
+	for (;;) {
+		pthread_mutex_lock(&work->lock);
+		const long section = work->next++;
+		pthread_mutex_unlock(&work->lock);
+		if (section >= work->numberOfSections) {
+			return NULL;
+		}
+		BAMeshLayoutSection(&work->sections[section].layout, work->width);
+	}
+}
+
+// Same scheme as concurrent layout of BAMeshView: sections are packed on a pool, then offsets are summed
+static BAMeshFloat LayoutConcurrently(Section *sections, long numberOfSections, BAMeshFloat width, int threadsCount) {
+	Work work = { sections, numberOfSections, 0, width, PTHREAD_MUTEX_INITIALIZER };
+	pthread_t threads[64];
+	for (int i = 1; i < threadsCount; i++) {
+		pthread_create(&threads[i], NULL, LayoutWorker, &work);
+	}
+	LayoutWorker(&work);
+	for (int i = 1; i < threadsCount; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	BAMeshFloat y = 0;
+	for (long section = 0; section < numberOfSections; section++) {
+		sections[section].layout.y = y;
+		y += sections[section].layout.totalHeight;
+	}
+	return y;
+}
+
+static int BenchConcurrentLayout(long numberOfCells, int maxThreads) {
+	const long numberOfSections = 200;
+	const BAMeshFloat width = 768;
+	Section *serial = CreateSections(numberOfCells, numberOfSections, 0);
+	const double start = Now();
+	BAMeshFloat y = 0;
+	for (long section = 0; section < numberOfSections; section++) {
+		BAMeshLayoutSection(&serial[section].layout, width);
+		serial[section].layout.y = y;
+		y += serial[section].layout.totalHeight;
+	}
+	const double serialTime = Now() - start;
+	printf("serial layout of %ld cells in %ld sections: %.2f ms\n", numberOfCells, numberOfSections, serialTime * 1e3);
+	int failures = 0;
+	for (int threadsCount = 1; threadsCount <= maxThreads; threadsCount *= 2) {
+		Section *concurrent = CopySections(serial, numberOfSections);
+		const double concurrentStart = Now();
+		LayoutConcurrently(concurrent, numberOfSections, width, threadsCount);
+		const double concurrentTime = Now() - concurrentStart;
+		int mismatches = 0;
+		for (long section = 0; section < numberOfSections; section++) {
+			if (!SectionsEqual(&serial[section].layout, &concurrent[section].layout)) {
+				mismatches++;
+			}
+		}
+		printf("concurrent layout with %d threads: %.2f ms, speedup %.2f, %d mismatching sections\n",
+			   threadsCount, concurrentTime * 1e3, serialTime / concurrentTime, mismatches);
+		failures += mismatches;
+		DestroySections(concurrent, numberOfSections);
+	}
+	DestroySections(serial, numberOfSections);
+	return failures;
+}
+
+static void BenchSection(long numberOfCells) {
+	const BAMeshFloat width = 768;
+	Section section;
+	SectionInit(&section, numberOfCells, 0);
+	double start = Now();
+	BAMeshLayoutSection(&section.layout, width);
+	printf("full layout of %ld cells: %.2f ms\n", numberOfCells, (Now() - start) * 1e3);
+
+	// single cell changes in the middle and at the end of the section
+	const long middleCell = numberOfCells / 2;
+	section.sizes[middleCell] = RandomSize(0);
+	start = Now();
+	BAMeshLayoutSectionFromRow(&section.layout, width, BAMeshLayoutRowForChangedCell(&section.layout, middleCell));
+	printf("relayout after single cell update in the middle: %.3f ms\n", (Now() - start) * 1e3);
+	section.sizes[numberOfCells - 1] = RandomSize(0);
+	start = Now();
+	BAMeshLayoutSectionFromRow(&section.layout, width, BAMeshLayoutRowForChangedCell(&section.layout, numberOfCells - 1));
+	printf("relayout after single cell update at the end: %.3f ms\n", (Now() - start) * 1e3);
+
+	// visible rect and hit test queries over one screen
+	const int queriesCount = 100000;
+	long found = 0;
+	start = Now();
+	for (int i = 0; i < queriesCount; i++) {
+		const BAMeshFloat y = Random() % (long)section.layout.totalHeight;
+		long firstRow, rowsCount, firstCell, cellsCount;
+		BAMeshLayoutRowsInRange(&section.layout, y, y + 1024, &firstRow, &rowsCount);
+		BAMeshLayoutCellsInRows(&section.layout, firstRow, rowsCount, &firstCell, &cellsCount);
+		found += cellsCount;
+	}
+	printf("visible range query: %.3f us\n", (Now() - start) * 1e6 / queriesCount);
+	start = Now();
+	for (int i = 0; i < queriesCount; i++) {
+		found += BAMeshLayoutCellAtPoint(&section.layout, Random() % (long)width, Random() % (long)section.layout.totalHeight);
+	}
+	printf("hit test: %.3f us\n", (Now() - start) * 1e6 / queriesCount);
+	const int linearQueriesCount = 200;
+	start = Now();
+	for (int i = 0; i < linearQueriesCount; i++) {
+		found += LinearCellAtPoint(&section.layout, Random() % (long)width, Random() % (long)section.layout.totalHeight);
+	}
+	printf("hit test by linear scan: %.3f us\n", (Now() - start) * 1e6 / linearQueriesCount);
+	if (found == 42) {
+		printf("\n"); // keeps queries from being optimized away
+	}
+	SectionDestroy(&section);
+}
+
+// Sizes known in bulk, as with meshView:getSizes:alignments:ofCellsInRange:inSection:
+static void BenchUniformSection(long numberOfCells) {
+	Section section;
+	SectionInit(&section, numberOfCells, 1);
+	const double start = Now();
+	for (long cell = 0; cell < numberOfCells; cell++) {
+		section.sizes[cell] = (BAMeshSize){ 75, 75 };
+	}
+	BAMeshLayoutSection(&section.layout, 768);
+	printf("uniform size layout of %ld cells: %.2f ms\n", numberOfCells, (Now() - start) * 1e3);
+	SectionDestroy(&section);
+}
+
+int main(int argc, const char *argv[]) {
+	const long numberOfCells = argc > 1 ? atol(argv[1]) : 100000;
+	long maxThreads = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+	maxThreads = maxThreads < 1 ? 1 : (maxThreads > 64 ? 64 : maxThreads);
+	randomState = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+
+	int failures = 0;
+	failures += TestIncrementalLayout(2000);
+	failures += TestHitTesting(2000, 300);
+	BenchSection(numberOfCells);
+	BenchUniformSection(numberOfCells / 2);
+	failures += BenchConcurrentLayout(numberOfCells, (int)maxThreads);
+	return failures ? 1 : 0;
+}